@@ -33,6 +33,8 @@ struct Experiment1Result {
     size_t data_size_mb;
     double binary_throughput;
     double btree_throughput;
+    double binary_mmap_throughput;
+    double btree_mmap_throughput;
 };
 
 void insert_random_data(Database<int, int>& db, size_t num_entries, RandomGenerator& rng) {
@@ -119,15 +121,42 @@ void run_experiment_for_size(size_t data_size_mb, CSVWriter& csv_writer, RandomG
     double btree_throughput = measure_query_throughput(db, query_keys, SearchMode::B_TREE_SEARCH, QUERY_BATCH_SIZE);
     std::cout << " " << btree_throughput << " queries/sec" << std::endl;
 
+    // Close database
+    db.close();
+
+    // Reopen the same SSTs with the mmap read backend
+    Database<int, int> mmap_db(db_name, MEMTABLE_SIZE_ENTRIES, BLOOM_FILTER_FPR, BUFFER_POOL_PAGES);
+    mmap_db.set_read_mode(SSTReadMode::MMAP);
+    if (!mmap_db.open()) {
+        std::cerr << "Failed to reopen database with mmap reads!" << std::endl;
+        return;
+    }
+
+    std::cout << "Warming up mmap..." << std::flush;
+    for (size_t i = 0; i < NUM_WARMUP_QUERIES; ++i) {
+        mmap_db.get(query_keys[i % query_keys.size()], dummy_value, SearchMode::B_TREE_SEARCH);
+    }
+    std::cout << " Done" << std::endl;
+
+    std::cout << "Measuring binary search throughput (mmap)..." << std::flush;
+    double binary_mmap_throughput = measure_query_throughput(mmap_db, query_keys, SearchMode::BINARY_SEARCH, QUERY_BATCH_SIZE);
+    std::cout << " " << binary_mmap_throughput << " queries/sec" << std::endl;
+
+    std::cout << "Measuring B-tree search throughput (mmap)..." << std::flush;
+    double btree_mmap_throughput = measure_query_throughput(mmap_db, query_keys, SearchMode::B_TREE_SEARCH, QUERY_BATCH_SIZE);
+    std::cout << " " << btree_mmap_throughput << " queries/sec" << std::endl;
+
+    mmap_db.close();
+
     // Write results to CSV
     csv_writer.write_row({std::to_string(data_size_mb),
                           std::to_string(binary_throughput),
-                          std::to_string(btree_throughput)});
-
-    summary_rows.push_back({data_size_mb, binary_throughput, btree_throughput});
+                          std::to_string(btree_throughput),
+                          std::to_string(binary_mmap_throughput),
+                          std::to_string(btree_mmap_throughput)});
 
-    // Close database
-    db.close();
+    summary_rows.push_back({data_size_mb, binary_throughput, btree_throughput,
+                            binary_mmap_throughput, btree_mmap_throughput});
 
     // Clean up
     cleanup_database(db_name);
@@ -141,20 +170,25 @@ void print_summary_table(const std::vector<Experiment1Result>& rows) {
     std::cout << "\nFinal throughput table (ops/sec):" << std::endl;
     std::cout << std::left << std::setw(15) << "Data Size MB"
               << std::right << std::setw(20) << "Binary Search"
-              << std::right << std::setw(20) << "B-Tree Search" << std::endl;
-    std::cout << std::string(55, '-') << std::endl;
+              << std::right << std::setw(20) << "B-Tree Search"
+              << std::right << std::setw(20) << "Binary (mmap)"
+              << std::right << std::setw(20) << "B-Tree (mmap)" << std::endl;
+    std::cout << std::string(95, '-') << std::endl;
 
     std::cout << std::fixed << std::setprecision(0);
     for (const auto& row : rows) {
         std::cout << std::left << std::setw(15) << row.data_size_mb
                   << std::right << std::setw(20) << row.binary_throughput
-                  << std::right << std::setw(20) << row.btree_throughput << std::endl;
+                  << std::right << std::setw(20) << row.btree_throughput
+                  << std::right << std::setw(20) << row.binary_mmap_throughput
+                  << std::right << std::setw(20) << row.btree_mmap_throughput << std::endl;
     }
     std::cout.unsetf(std::ios::floatfield);
 }
 
 int main() {
     std::cout << "=== Experiment 1: Binary Search vs B-Tree Search Throughput Comparison ===" << std::endl;
+    std::cout << "(each search is measured through the buffer pool and with mmap reads)" << std::endl;
     std::cout << "Configuration:" << std::endl;
     std::cout << "  Buffer pool: " << BUFFER_POOL_SIZE_MB << " MB (" << BUFFER_POOL_PAGES << " pages)" << std::endl;
     std::cout << "  Memtable: 1 MB (" << MEMTABLE_SIZE_ENTRIES << " entries)" << std::endl;
@@ -167,7 +201,8 @@ int main() {
 
     // Create CSV writer
     CSVWriter csv_writer("experiments/results/experiment1_results.csv");
-    csv_writer.write_header({"data_size_mb", "binary_search_throughput", "btree_search_throughput"});
+    csv_writer.write_header({"data_size_mb", "binary_search_throughput", "btree_search_throughput",
+                             "binary_search_mmap_throughput", "btree_search_mmap_throughput"});
 
     // Initialize random generator with fixed seed for reproducibility
     RandomGenerator rng(42);
@@ -17,11 +17,18 @@ constexpr size_t MEASUREMENT_INTERVAL_MB = 100; // Measure every 100 MB
 constexpr size_t QUERY_BATCH_SIZE = 10000; // Number of queries per measurement
 constexpr size_t SCAN_RANGE_SIZE = 1000; // Range size for scan queries
 
+// Each compaction strategy gets its own run over the same key sequence
+const std::vector<CompactionStyle> STRATEGIES = {
+    CompactionStyle::LEVELED, CompactionStyle::TIERED, CompactionStyle::LAZY_LEVELED
+};
+
 struct Experiment2Result {
+    std::string strategy;
     size_t data_size_mb;
     double insert_throughput;
     double get_throughput;
     double scan_throughput;
+    double write_amplification;
 };
 
 size_t calculate_entry_count_for_size_mb(size_t size_mb) {
@@ -122,42 +129,33 @@ void measure_throughput_at_interval(Database<int, int>& db, size_t current_size_
         std::cout << " N/A (no data yet)" << std::endl;
     }
 
+    double write_amp = db.get_write_amplification();
+    std::cout << "Write amplification: " << write_amp << std::endl;
+
     // Write results to CSV
-    csv_writer.write_row({std::to_string(current_size_mb),
+    std::string strategy = db.get_compaction_strategy().get_name();
+    csv_writer.write_row({strategy,
+                          std::to_string(current_size_mb),
                           std::to_string(insert_tp),
                           std::to_string(get_tp),
-                          std::to_string(scan_tp)});
-    summary_rows.push_back({current_size_mb, insert_tp, get_tp, scan_tp});
+                          std::to_string(scan_tp),
+                          std::to_string(write_amp)});
+    summary_rows.push_back({strategy, current_size_mb, insert_tp, get_tp, scan_tp, write_amp});
 }
 
-int main() {
-    std::cout << "=== Experiment 2: Throughput Over Time as Data Grows ===" << std::endl;
-    std::cout << "Configuration:" << std::endl;
-    std::cout << "  Buffer pool: " << BUFFER_POOL_SIZE_MB << " MB (" << BUFFER_POOL_PAGES << " pages)" << std::endl;
-    std::cout << "  Memtable: 1 MB (" << MEMTABLE_SIZE_ENTRIES << " entries)" << std::endl;
-    std::cout << "  Bloom filter: " << BITS_PER_ENTRY << " bits per entry (FPR ≈ " << BLOOM_FILTER_FPR << ")" << std::endl;
-    std::cout << "  Total data size: " << TOTAL_DATA_SIZE_MB << " MB" << std::endl;
-    std::cout << "  Measurement interval: " << MEASUREMENT_INTERVAL_MB << " MB" << std::endl;
-    std::cout << "  Query batch size: " << QUERY_BATCH_SIZE << " queries" << std::endl;
-    std::cout << std::endl;
-
-    // Ensure results directory exists
-    ensure_directory_exists("experiments/results");
-
+bool run_strategy(CompactionStyle style, CSVWriter& csv_writer, std::vector<Experiment2Result>& summary_rows) {
     // Clean up any existing database
     std::string db_name = "exp2_throughput";
     cleanup_database(db_name);
 
     // Create and open database
     Database<int, int> db(db_name, MEMTABLE_SIZE_ENTRIES, BLOOM_FILTER_FPR, BUFFER_POOL_PAGES);
+    db.set_compaction_strategy(make_compaction_strategy<int, int>(style));
     if (!db.open()) {
         std::cerr << "Failed to open database!" << std::endl;
-        return 1;
+        return false;
     }
-
-    // Create CSV writer
-    CSVWriter csv_writer("experiments/results/experiment2_results.csv");
-    csv_writer.write_header({"data_size_mb", "insert_throughput", "get_throughput", "scan_throughput"});
+    std::cout << "\n=== Compaction strategy: " << db.get_compaction_strategy().get_name() << " ===" << std::endl;
 
     // Initialize random generator with fixed seed for reproducibility
     RandomGenerator rng(83);
@@ -166,9 +164,6 @@ int main() {
     std::vector<int> inserted_keys;
     inserted_keys.reserve(calculate_entry_count_for_size_mb(TOTAL_DATA_SIZE_MB));
 
-    std::vector<Experiment2Result> summary_rows;
-    summary_rows.reserve(TOTAL_DATA_SIZE_MB / MEASUREMENT_INTERVAL_MB + 2);
-
     // Insert data and measure at intervals
     size_t total_entries = calculate_entry_count_for_size_mb(TOTAL_DATA_SIZE_MB);
     size_t entries_per_interval = calculate_entry_count_for_size_mb(MEASUREMENT_INTERVAL_MB);
@@ -213,6 +208,7 @@ int main() {
 
     // Final measurement (use last measured insert throughput)
     bool already_recorded_final = !summary_rows.empty() &&
+                                  summary_rows.back().strategy == db.get_compaction_strategy().get_name() &&
                                   summary_rows.back().data_size_mb == TOTAL_DATA_SIZE_MB;
     if (current_entries >= total_entries && last_insert_throughput > 0.0 && !already_recorded_final) {
         measure_throughput_at_interval(db, TOTAL_DATA_SIZE_MB, rng, csv_writer, inserted_keys, last_insert_throughput, summary_rows);
@@ -220,23 +216,57 @@ int main() {
 
     // Close database
     db.close();
+    cleanup_database(db_name);
+    return true;
+}
+
+int main() {
+    std::cout << "=== Experiment 2: Throughput Over Time as Data Grows ===" << std::endl;
+    std::cout << "Configuration:" << std::endl;
+    std::cout << "  Buffer pool: " << BUFFER_POOL_SIZE_MB << " MB (" << BUFFER_POOL_PAGES << " pages)" << std::endl;
+    std::cout << "  Memtable: 1 MB (" << MEMTABLE_SIZE_ENTRIES << " entries)" << std::endl;
+    std::cout << "  Bloom filter: " << BITS_PER_ENTRY << " bits per entry (FPR ≈ " << BLOOM_FILTER_FPR << ")" << std::endl;
+    std::cout << "  Total data size: " << TOTAL_DATA_SIZE_MB << " MB" << std::endl;
+    std::cout << "  Measurement interval: " << MEASUREMENT_INTERVAL_MB << " MB" << std::endl;
+    std::cout << "  Query batch size: " << QUERY_BATCH_SIZE << " queries" << std::endl;
+    std::cout << std::endl;
+
+    // Ensure results directory exists
+    ensure_directory_exists("experiments/results");
+
+    // Create CSV writer
+    CSVWriter csv_writer("experiments/results/experiment2_results.csv");
+    csv_writer.write_header({"strategy", "data_size_mb", "insert_throughput", "get_throughput", "scan_throughput",
+                             "write_amplification"});
+
+    std::vector<Experiment2Result> summary_rows;
+    summary_rows.reserve(STRATEGIES.size() * (TOTAL_DATA_SIZE_MB / MEASUREMENT_INTERVAL_MB + 2));
+    for (CompactionStyle style : STRATEGIES) {
+        if (!run_strategy(style, csv_writer, summary_rows)) {
+            return 1;
+        }
+    }
 
     std::cout << "\n=== Experiment Complete ===" << std::endl;
     std::cout << "Results written to: experiments/results/experiment2_results.csv" << std::endl;
 
     if (!summary_rows.empty()) {
         std::cout << "\nFinal throughput table (ops/sec):" << std::endl;
-        std::cout << std::left << std::setw(12) << "Data MB"
+        std::cout << std::left << std::setw(14) << "Strategy"
+                  << std::left << std::setw(12) << "Data MB"
                   << std::right << std::setw(18) << "Insert"
                   << std::right << std::setw(18) << "Get"
-                  << std::right << std::setw(18) << "Scan" << std::endl;
-        std::cout << std::string(66, '-') << std::endl;
-        std::cout << std::fixed << std::setprecision(0);
+                  << std::right << std::setw(18) << "Scan"
+                  << std::right << std::setw(12) << "Write amp" << std::endl;
+        std::cout << std::string(92, '-') << std::endl;
         for (const auto& row : summary_rows) {
-            std::cout << std::left << std::setw(12) << row.data_size_mb
+            std::cout << std::fixed << std::setprecision(0)
+                      << std::left << std::setw(14) << row.strategy
+                      << std::left << std::setw(12) << row.data_size_mb
                       << std::right << std::setw(18) << row.insert_throughput
                       << std::right << std::setw(18) << row.get_throughput
-                      << std::right << std::setw(18) << row.scan_throughput << std::endl;
+                      << std::right << std::setw(18) << row.scan_throughput
+                      << std::setprecision(2) << std::right << std::setw(12) << row.write_amplification << std::endl;
         }
         std::cout.unsetf(std::ios::floatfield);
     }
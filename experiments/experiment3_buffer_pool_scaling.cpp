@@ -0,0 +1,130 @@
+#include "../src/buffer/buffer_pool.h"
+#include "experiment_utils.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+constexpr size_t BUFFER_POOL_SIZE_MB = 64;
+constexpr size_t BUFFER_POOL_PAGES = (BUFFER_POOL_SIZE_MB * 1024 * 1024) / PAGE_SIZE;
+// Pages read, below the pool size since hashing does not fill shards evenly
+constexpr size_t WORKING_SET_PAGES = BUFFER_POOL_PAGES * 3 / 4;
+constexpr size_t FILE_COUNT = 64;
+constexpr size_t READS_PER_THREAD = 1000000;
+
+// Shard counts compared; 1 is the pool with a single latch
+const std::vector<size_t> SHARD_COUNTS = {1, 4, DEFAULT_BUFFER_POOL_SHARDS, 32};
+
+struct Experiment3Result {
+    size_t shards;
+    size_t threads;
+    double read_throughput;
+};
+
+std::vector<size_t> thread_counts() {
+    size_t cores = std::max<unsigned>(1, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t threads = 1; threads < cores; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(cores);
+    return counts;
+}
+
+// The whole working set is cached, so each read is a hit and the
+// throughput measures the pool alone
+double measure_read_throughput(BufferPool& pool, const std::vector<PageID>& pages, size_t threads) {
+    std::atomic<size_t> misses(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(1000 + t);
+            std::uniform_int_distribution<size_t> pick(0, pages.size() - 1);
+            char out[PAGE_SIZE];
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            size_t local_misses = 0;
+            for (size_t i = 0; i < READS_PER_THREAD; i++) {
+                if (!pool.get_page(pages[pick(rng)], out)) {
+                    local_misses++;
+                }
+            }
+            misses += local_misses;
+        });
+    }
+
+    Timer timer;
+    timer.start();
+    go = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    timer.stop();
+
+    if (misses.load() > 0) {
+        std::cerr << "Warning: " << misses.load() << " reads missed the pool" << std::endl;
+    }
+    return calculate_throughput(READS_PER_THREAD * threads, timer.elapsed_seconds());
+}
+
+int main() {
+    std::cout << "=== Experiment 3: Buffer Pool Read Throughput vs. Threads ===" << std::endl;
+    std::cout << "Configuration:" << std::endl;
+    std::cout << "  Buffer pool: " << BUFFER_POOL_SIZE_MB << " MB (" << BUFFER_POOL_PAGES << " pages), "
+              << WORKING_SET_PAGES << " pages cached" << std::endl;
+    std::cout << "  Reads per thread: " << READS_PER_THREAD << " uniformly random page hits" << std::endl;
+    std::cout << "  Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::endl;
+
+    std::vector<PageID> pages;
+    pages.reserve(WORKING_SET_PAGES);
+    for (size_t i = 0; i < WORKING_SET_PAGES; i++) {
+        pages.emplace_back("exp3_" + std::to_string(i % FILE_COUNT) + ".sst", (i / FILE_COUNT) * PAGE_SIZE);
+    }
+    char data[PAGE_SIZE];
+    std::memset(data, 0x5a, PAGE_SIZE);
+
+    ensure_directory_exists("experiments/results");
+    CSVWriter csv_writer("experiments/results/experiment3_results.csv");
+    csv_writer.write_header({"shards", "threads", "read_throughput"});
+
+    std::vector<Experiment3Result> results;
+    for (size_t shards : SHARD_COUNTS) {
+        BufferPool pool(2, 16, 8, BUFFER_POOL_PAGES, true, nullptr, 10, shards);
+        for (const PageID& page_id : pages) {
+            pool.put_page(page_id, data);
+        }
+        std::cout << "Shards: " << pool.get_shard_count() << " (" << pool.get_page_count() << " pages cached)" << std::endl;
+
+        for (size_t threads : thread_counts()) {
+            double throughput = measure_read_throughput(pool, pages, threads);
+            std::cout << "  " << threads << " thread(s): " << std::fixed << std::setprecision(0)
+                      << throughput << " reads/sec" << std::endl;
+            csv_writer.write_row({std::to_string(pool.get_shard_count()), std::to_string(threads),
+                                  std::to_string(throughput)});
+            results.push_back({pool.get_shard_count(), threads, throughput});
+        }
+    }
+
+    std::cout << "\n=== Experiment Complete ===" << std::endl;
+    std::cout << "Results written to: experiments/results/experiment3_results.csv" << std::endl;
+
+    // speedup of each run over one thread with the same shard count
+    std::cout << "\nSpeedup over one thread:" << std::endl;
+    std::cout << std::left << std::setw(10) << "Shards" << std::left << std::setw(10) << "Threads"
+              << std::right << std::setw(18) << "Reads/sec" << std::right << std::setw(10) << "Speedup" << std::endl;
+    double single_thread = 0.0;
+    for (const auto& row : results) {
+        if (row.threads == 1) {
+            single_thread = row.read_throughput;
+        }
+        std::cout << std::left << std::setw(10) << row.shards << std::left << std::setw(10) << row.threads
+                  << std::right << std::setw(18) << std::fixed << std::setprecision(0) << row.read_throughput
+                  << std::right << std::setw(10) << std::setprecision(2)
+                  << (single_thread > 0.0 ? row.read_throughput / single_thread : 0.0) << std::endl;
+    }
+    return 0;
+}
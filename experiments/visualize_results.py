@@ -36,10 +36,23 @@ def load_experiment1_data(csv_path):
 def load_experiment2_data(csv_path):
     """Load experiment 2 CSV data, handling duplicate rows."""
     df = pd.read_csv(csv_path)
+    # Older result files predate the per-strategy runs
+    if 'strategy' not in df.columns:
+        df.insert(0, 'strategy', 'leveled')
     # Remove duplicate data_size_mb entries, keeping the first occurrence
-    df = df.drop_duplicates(subset=['data_size_mb'], keep='first')
+    df = df.drop_duplicates(subset=['strategy', 'data_size_mb'], keep='first')
     return df
 
+STRATEGY_STYLES = {
+    'leveled': ('o', '-'),
+    'tiered': ('s', '--'),
+    'lazy-leveled': ('^', ':'),
+}
+
+def strategy_style(strategy):
+    """Marker and line style used for a compaction strategy."""
+    return STRATEGY_STYLES.get(strategy, ('x', '-.'))
+
 def plot_experiment1(data_dir='results'):
     """Plot experiment 1: Search comparison (binary search vs b-tree search)."""
     csv_path = Path(__file__).parent / data_dir / 'experiment1_results.csv'
@@ -54,6 +67,13 @@ def plot_experiment1(data_dir='results'):
     ax.plot(df['data_size_mb'], df['btree_search_throughput'],
             marker='o', markersize=8, linewidth=2,
             label='B-Tree Search', color='#ff7f0e')
+    if 'btree_search_mmap_throughput' in df.columns:
+        ax.plot(df['data_size_mb'], df['binary_search_mmap_throughput'],
+                marker='s', markersize=8, linewidth=2, linestyle='--',
+                label='Binary Search (mmap)', color='#1f77b4')
+        ax.plot(df['data_size_mb'], df['btree_search_mmap_throughput'],
+                marker='o', markersize=8, linewidth=2, linestyle='--',
+                label='B-Tree Search (mmap)', color='#ff7f0e')
 
     ax.set_xlabel('Input Data Size (MB)', fontsize=12)
     ax.set_ylabel('Throughput (ops/sec)', fontsize=12)
@@ -83,64 +103,42 @@ def plot_experiment1(data_dir='results'):
     plt.close()
 
 def plot_experiment2(data_dir='results'):
-    """Plot experiment 2: Throughput over time (insert, get, scan operations)."""
+    """Plot experiment 2: Throughput and write amplification per compaction strategy."""
     csv_path = Path(__file__).parent / data_dir / 'experiment2_results.csv'
     df = load_experiment2_data(csv_path)
 
-    # Create figure with 3 subplots
-    fig, axes = plt.subplots(3, 1, figsize=(10, 12))
-    fig.suptitle('Throughput Over Time (Insert, Get, and Scan Operations)',
+    panels = [
+        ('insert_throughput', 'Insert Operation (Throughput vs. Input data size)', 'Throughput (ops/sec)'),
+        ('get_throughput', 'Get Operation (Throughput vs. Input data size)', 'Throughput (ops/sec)'),
+        ('scan_throughput', 'Scan Operation (Throughput vs. Input data size)', 'Throughput (ops/sec)'),
+    ]
+    if 'write_amplification' in df.columns:
+        panels.append(('write_amplification', 'Write Amplification vs. Input data size', 'Bytes written / bytes flushed'))
+
+    fig, axes = plt.subplots(len(panels), 1, figsize=(10, 4 * len(panels)))
+    fig.suptitle('Throughput Over Time per Compaction Strategy',
                  fontsize=14, fontweight='bold', y=0.995)
 
     # Get data range for X-axis
-    x_data_points = df['data_size_mb'].values
-
-    # Plot 1: Insert operations (linear scale - throughput doesn't vary that much)
-    axes[0].plot(df['data_size_mb'], df['insert_throughput'],
-                 marker='s', markersize=6, linewidth=2,
-                 label='Insert Throughput', color='#2ca02c')
-    axes[0].set_xlabel('Input Data Size (MB)', fontsize=11)
-    axes[0].set_ylabel('Throughput (ops/sec)', fontsize=11)
-    axes[0].set_title('Insert Operation (Throughput vs. Input data size)',
-                      fontsize=12, fontweight='bold')
-    # Use linear scale for X-axis since data points are evenly spaced (100MB intervals)
-    axes[0].set_xticks(x_data_points)
-    axes[0].set_xticklabels([f'{int(x)}' for x in x_data_points], rotation=45, ha='right')
-    # Use linear Y-axis since insert throughput is relatively stable
-    axes[0].yaxis.set_major_formatter(ticker.FuncFormatter(lambda x, p: f'{x/1e6:.2f}M' if x >= 1e6 else f'{x/1e3:.0f}K'))
-    axes[0].grid(True, alpha=0.3, which='major')
-    axes[0].legend(loc='best', fontsize=10)
-
-    # Plot 2: Get operations (log Y-axis for better visibility of decline)
-    axes[1].plot(df['data_size_mb'], df['get_throughput'],
-                 marker='o', markersize=6, linewidth=2,
-                 label='Get Throughput', color='#d62728')
-    axes[1].set_xlabel('Input Data Size (MB)', fontsize=11)
-    axes[1].set_ylabel('Throughput (ops/sec)', fontsize=11)
-    axes[1].set_title('Get Operation (Throughput vs. Input data size)',
-                      fontsize=12, fontweight='bold')
-    # Use linear X-axis for consistency
-    axes[1].set_xticks(x_data_points)
-    axes[1].set_xticklabels([f'{int(x)}' for x in x_data_points], rotation=45, ha='right')
-    # Use linear Y-axis but format nicely
-    axes[1].yaxis.set_major_formatter(ticker.FuncFormatter(lambda x, p: f'{x/1e3:.0f}K'))
-    axes[1].grid(True, alpha=0.3, which='major')
-    axes[1].legend(loc='best', fontsize=10)
-
-    # Plot 3: Scan operations
-    axes[2].plot(df['data_size_mb'], df['scan_throughput'],
-                 marker='^', markersize=6, linewidth=2,
-                 label='Scan Throughput', color='#9467bd')
-    axes[2].set_xlabel('Input Data Size (MB)', fontsize=11)
-    axes[2].set_ylabel('Throughput (ops/sec)', fontsize=11)
-    axes[2].set_title('Scan Operation (Throughput vs. Input data size)',
-                      fontsize=12, fontweight='bold')
-    # Use linear X-axis for consistency
-    axes[2].set_xticks(x_data_points)
-    axes[2].set_xticklabels([f'{int(x)}' for x in x_data_points], rotation=45, ha='right')
-    axes[2].yaxis.set_major_formatter(ticker.FuncFormatter(lambda x, p: f'{x/1e3:.0f}K'))
-    axes[2].grid(True, alpha=0.3, which='major')
-    axes[2].legend(loc='best', fontsize=10)
+    x_data_points = sorted(df['data_size_mb'].unique())
+
+    for ax, (column, title, ylabel) in zip(axes, panels):
+        for strategy, rows in df.groupby('strategy', sort=False):
+            marker, linestyle = strategy_style(strategy)
+            ax.plot(rows['data_size_mb'], rows[column],
+                    marker=marker, markersize=6, linewidth=2, linestyle=linestyle,
+                    label=strategy)
+        ax.set_xlabel('Input Data Size (MB)', fontsize=11)
+        ax.set_ylabel(ylabel, fontsize=11)
+        ax.set_title(title, fontsize=12, fontweight='bold')
+        # Use linear scale for X-axis since data points are evenly spaced (100MB intervals)
+        ax.set_xticks(x_data_points)
+        ax.set_xticklabels([f'{int(x)}' for x in x_data_points], rotation=45, ha='right')
+        if column != 'write_amplification':
+            ax.yaxis.set_major_formatter(ticker.FuncFormatter(
+                lambda x, p: f'{x/1e6:.2f}M' if x >= 1e6 else f'{x/1e3:.0f}K'))
+        ax.grid(True, alpha=0.3, which='major')
+        ax.legend(loc='best', fontsize=10)
 
     plt.tight_layout()
     output_path = Path(__file__).parent / data_dir / 'experiment2_visualization.png'
@@ -155,16 +153,18 @@ def plot_experiment2_combined(data_dir='results'):
 
     fig, ax = plt.subplots(1, 1, figsize=(10, 6))
 
-    # Plot all three operations
-    ax.plot(df['data_size_mb'], df['insert_throughput'],
-            marker='s', markersize=6, linewidth=2,
-            label='Insert', color='#2ca02c')
-    ax.plot(df['data_size_mb'], df['get_throughput'],
-            marker='o', markersize=6, linewidth=2,
-            label='Get', color='#d62728')
-    ax.plot(df['data_size_mb'], df['scan_throughput'],
-            marker='^', markersize=6, linewidth=2,
-            label='Scan', color='#9467bd')
+    # Plot all three operations; line style tells the strategies apart
+    for strategy, rows in df.groupby('strategy', sort=False):
+        _, linestyle = strategy_style(strategy)
+        ax.plot(rows['data_size_mb'], rows['insert_throughput'],
+                marker='s', markersize=6, linewidth=2, linestyle=linestyle,
+                label=f'Insert ({strategy})', color='#2ca02c')
+        ax.plot(rows['data_size_mb'], rows['get_throughput'],
+                marker='o', markersize=6, linewidth=2, linestyle=linestyle,
+                label=f'Get ({strategy})', color='#d62728')
+        ax.plot(rows['data_size_mb'], rows['scan_throughput'],
+                marker='^', markersize=6, linewidth=2, linestyle=linestyle,
+                label=f'Scan ({strategy})', color='#9467bd')
 
     ax.set_xlabel('Input Data Size (MB)', fontsize=12)
     ax.set_ylabel('Throughput (ops/sec)', fontsize=12)
@@ -172,7 +172,7 @@ def plot_experiment2_combined(data_dir='results'):
                  fontsize=13, fontweight='bold')
 
     # Get data points for X-axis
-    x_data_points = df['data_size_mb'].values
+    x_data_points = sorted(df['data_size_mb'].unique())
 
     # Use linear X-axis since data points are evenly spaced (100MB intervals)
     ax.set_xticks(x_data_points)
@@ -6,24 +6,24 @@
 #include <cstring>
 #include <cmath>
 #include <set>
+#include <algorithm>
 
 BufferPool::BufferPool(size_t initial_global_depth, size_t max_depth, size_t bucket_size, size_t max_page_limit,
                        bool enable_eviction,
                        std::function<void(const PageID&, const char*)> write_back_cb,
-                       size_t flood_threshold)
-    : global_depth(initial_global_depth),
+                       size_t flood_threshold, size_t requested_shards)
+    : shard_count(std::max<size_t>(1, std::min(requested_shards, max_page_limit / MIN_PAGES_PER_BUFFER_POOL_SHARD))),
       initial_depth(initial_global_depth),
       max_global_depth(max_depth),
       pages_per_bucket(bucket_size),
-      current_page_count(0),
       max_pages(max_page_limit),
       flooding_threshold_pages(flood_threshold) {
 
-    size_t dir_size = 1 << global_depth;
-    directory.resize(dir_size);
-
-    for (size_t i = 0; i < dir_size; i++) {
-        directory[i] = std::make_shared<Bucket>(global_depth, pages_per_bucket);
+    // the page budget is split evenly, the first shards taking the remainder
+    shards = std::make_unique<Shard[]>(shard_count);
+    for (size_t i = 0; i < shard_count; i++) {
+        shards[i].max_pages = max_pages / shard_count + (i < max_pages % shard_count ? 1 : 0);
+        reset_shard(shards[i]);
     }
 
     eviction_enabled = enable_eviction;
@@ -90,16 +90,22 @@ size_t BufferPool::hash_page_id(const PageID& page_id) const {
     return xxhash(combined.c_str(), combined.length());
 }
 
-size_t BufferPool::get_bucket_index(size_t hash_value) const {
-    size_t mask = (1 << global_depth) - 1;
+// The low bits index the directory, so shards are picked by the high bits
+BufferPool::Shard& BufferPool::shard_for(size_t hash_value) const {
+    return shards[(static_cast<uint64_t>(hash_value) >> 32) % shard_count];
+}
+
+size_t BufferPool::get_bucket_index(const Shard& shard, size_t hash_value) const {
+    size_t mask = (1 << shard.global_depth) - 1;
     return hash_value & mask;
 }
 
-bool BufferPool::can_expand() const {
-    return global_depth < max_global_depth;
+bool BufferPool::can_expand(const Shard& shard) const {
+    return shard.global_depth < max_global_depth;
 }
 
-void BufferPool::double_directory() {
+void BufferPool::double_directory(Shard& shard) {
+    auto& directory = shard.directory;
     size_t old_size = directory.size();
     directory.resize(old_size * 2);
 
@@ -107,17 +113,18 @@ void BufferPool::double_directory() {
         directory[i + old_size] = directory[i];
     }
 
-    global_depth++;
+    shard.global_depth++;
 }
 
-void BufferPool::split_bucket(size_t bucket_index) {
+void BufferPool::split_bucket(Shard& shard, size_t bucket_index) {
+    auto& directory = shard.directory;
     auto old_bucket = directory[bucket_index];
 
-    if (old_bucket->local_depth == global_depth && can_expand()) {
-        double_directory();
+    if (old_bucket->local_depth == shard.global_depth && can_expand(shard)) {
+        double_directory(shard);
     }
 
-    if (!can_expand() && old_bucket->local_depth == global_depth) {
+    if (!can_expand(shard) && old_bucket->local_depth == shard.global_depth) {
         return;
     }
 
@@ -154,8 +161,10 @@ bool BufferPool::put_page(const PageID& page_id, const char* page_data) {
     }
 
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    auto bucket = directory[bucket_index];
+    Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    auto bucket = shard.directory[bucket_index];
 
     Page* existing_page = bucket->find_page(page_id);
     if (existing_page) {
@@ -165,23 +174,23 @@ bool BufferPool::put_page(const PageID& page_id, const char* page_data) {
         return true;
     }
 
-    if (current_page_count >= max_pages) {
+    if (shard.current_page_count >= shard.max_pages) {
         if (!eviction_enabled) {
             return false;
         }
-        if (!evict_one()) {
+        if (!evict_one(shard)) {
             return false;
         }
     }
 
     while (bucket->is_full()) {
-        if (!can_expand() && bucket->local_depth >= global_depth) {
+        if (!can_expand(shard) && bucket->local_depth >= shard.global_depth) {
             return false;
         }
 
-        split_bucket(bucket_index);
-        bucket_index = get_bucket_index(hash_val);
-        bucket = directory[bucket_index];
+        split_bucket(shard, bucket_index);
+        bucket_index = get_bucket_index(shard, hash_val);
+        bucket = shard.directory[bucket_index];
     }
 
     auto new_page = std::make_unique<Page>(page_id, page_data);
@@ -189,8 +198,8 @@ bool BufferPool::put_page(const PageID& page_id, const char* page_data) {
     bucket->pages.push_back(std::move(new_page));
     // Track in clock ring
     Page* raw = bucket->pages.back().get();
-    clock_ring.push_back(raw);
-    current_page_count++;
+    shard.clock_ring.push_back(raw);
+    shard.current_page_count++;
     return true;
 }
 
@@ -200,12 +209,15 @@ bool BufferPool::get_page(const PageID& page_id, char* page_data) {
     }
 
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    auto bucket = directory[bucket_index];
+    Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    auto& bucket = shard.directory[bucket_index];
 
     Page* page = bucket->find_page(page_id);
     if (page && page->is_valid) {
         page->reference_bit = true;
+        page->hit_count++;
         std::memcpy(page_data, page->data, PAGE_SIZE);
         return true;
     }
@@ -215,33 +227,70 @@ bool BufferPool::get_page(const PageID& page_id, char* page_data) {
 
 bool BufferPool::contains_page(const PageID& page_id) const {
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    return directory[bucket_index]->contains(page_id);
+    const Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    return shard.directory[bucket_index]->contains(page_id);
 }
 
 
 bool BufferPool::remove_page(const PageID& page_id) {
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    auto bucket = directory[bucket_index];
+    Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    auto bucket = shard.directory[bucket_index];
 
-    if (bucket->remove_page(page_id)) {
-        remove_from_clock_ring(nullptr);
-        current_page_count--;
+    // the ring slot must go before the page it points to
+    Page* page = bucket->find_page(page_id);
+    if (page) {
+        remove_from_clock_ring(shard, page);
+        bucket->remove_page(page_id);
+        shard.current_page_count--;
         return true;
     }
 
     return false;
 }
 
+size_t BufferPool::remove_file_pages(const std::string& filename, std::vector<std::pair<size_t, size_t>>* dropped) {
+    // every cached page has a ring slot, so one pass over each shard's ring finds them all
+    size_t removed = 0;
+    for (size_t i = 0; i < shard_count; i++) {
+        Shard& shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.latch);
+        size_t removed_here = 0;
+        for (Page*& slot : shard.clock_ring) {
+            if (slot == nullptr || slot->page_id.filename != filename) {
+                continue;
+            }
+            PageID page_id = slot->page_id;
+            if (dropped) {
+                dropped->push_back({page_id.offset, slot->hit_count});
+            }
+            slot = nullptr;
+            shard.directory[get_bucket_index(shard, hash_page_id(page_id))]->remove_page(page_id);
+            shard.current_page_count--;
+            removed_here++;
+        }
+        if (removed_here > 0) {
+            compact_clock_ring(shard);
+        }
+        removed += removed_here;
+    }
+    return removed;
+}
+
 void BufferPool::enable_eviction_policy(bool enable) {
     eviction_enabled = enable;
 }
 
 bool BufferPool::pin_page(const PageID& page_id) {
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    auto bucket = directory[bucket_index];
+    Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    auto bucket = shard.directory[bucket_index];
     Page* page = bucket->find_page(page_id);
     if (!page) return false;
     page->pin_count++;
@@ -250,8 +299,10 @@ bool BufferPool::pin_page(const PageID& page_id) {
 
 bool BufferPool::unpin_page(const PageID& page_id) {
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    auto bucket = directory[bucket_index];
+    Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    auto bucket = shard.directory[bucket_index];
     Page* page = bucket->find_page(page_id);
     if (!page) return false;
     if (page->pin_count == 0) return false;
@@ -261,15 +312,36 @@ bool BufferPool::unpin_page(const PageID& page_id) {
 
 bool BufferPool::mark_dirty(const PageID& page_id) {
     size_t hash_val = hash_page_id(page_id);
-    size_t bucket_index = get_bucket_index(hash_val);
-    auto bucket = directory[bucket_index];
+    Shard& shard = shard_for(hash_val);
+    std::lock_guard<std::mutex> lock(shard.latch);
+    size_t bucket_index = get_bucket_index(shard, hash_val);
+    auto bucket = shard.directory[bucket_index];
     Page* page = bucket->find_page(page_id);
     if (!page) return false;
     page->dirty = true;
     return true;
 }
 
-void BufferPool::remove_from_clock_ring(Page* page_ptr) {
+// Drops empty slots, keeping the hand on the page it pointed at (or the next
+// live one), so a pool that never fills does not pile up dead slots
+void BufferPool::compact_clock_ring(Shard& shard) {
+    auto& clock_ring = shard.clock_ring;
+    size_t kept = 0;
+    size_t hand = 0;
+    for (size_t i = 0; i < clock_ring.size(); ++i) {
+        if (i == shard.clock_hand) {
+            hand = kept;
+        }
+        if (clock_ring[i] != nullptr) {
+            clock_ring[kept++] = clock_ring[i];
+        }
+    }
+    clock_ring.resize(kept);
+    shard.clock_hand = kept == 0 ? 0 : hand % kept;
+}
+
+void BufferPool::remove_from_clock_ring(Shard& shard, Page* page_ptr) {
+    auto& clock_ring = shard.clock_ring;
     for (size_t i = 0; i < clock_ring.size(); ++i) {
         if (clock_ring[i] == page_ptr) {
             clock_ring[i] = nullptr;
@@ -279,7 +351,9 @@ void BufferPool::remove_from_clock_ring(Page* page_ptr) {
     }
 }
 
-bool BufferPool::evict_one() {
+bool BufferPool::evict_one(Shard& shard) {
+    auto& clock_ring = shard.clock_ring;
+    size_t& clock_hand = shard.clock_hand;
     if (clock_ring.empty()) return false;
 
     size_t scanned = 0;
@@ -287,6 +361,9 @@ bool BufferPool::evict_one() {
     size_t max_scans = ring_size * 2; // allow one full pass to clear refs, second to evict
 
     while (scanned < max_scans) {
+        if (clock_ring.empty()) {
+            return false;
+        }
         if (clock_hand >= clock_ring.size()) {
             clock_hand = 0;
         }
@@ -329,13 +406,13 @@ bool BufferPool::evict_one() {
 
         // Remove from its bucket
         size_t hash_val = hash_page_id(candidate->page_id);
-        size_t bucket_index = get_bucket_index(hash_val);
-        auto bucket = directory[bucket_index];
+        size_t bucket_index = get_bucket_index(shard, hash_val);
+        auto bucket = shard.directory[bucket_index];
         bucket->remove_page(candidate->page_id);
 
         // Remove from ring
         clock_ring.erase(clock_ring.begin() + clock_hand);
-        current_page_count--;
+        shard.current_page_count--;
         return true;
     }
 
@@ -344,15 +421,34 @@ bool BufferPool::evict_one() {
 
 // general helpers
 size_t BufferPool::get_directory_size() const {
-    return directory.size();
+    size_t size = 0;
+    for (size_t i = 0; i < shard_count; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].latch);
+        size += shards[i].directory.size();
+    }
+    return size;
 }
 
 size_t BufferPool::get_global_depth() const {
-    return global_depth;
+    size_t depth = 0;
+    for (size_t i = 0; i < shard_count; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].latch);
+        depth = std::max(depth, shards[i].global_depth);
+    }
+    return depth;
 }
 
 size_t BufferPool::get_page_count() const {
-    return current_page_count;
+    size_t count = 0;
+    for (size_t i = 0; i < shard_count; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].latch);
+        count += shards[i].current_page_count;
+    }
+    return count;
+}
+
+size_t BufferPool::get_shard_count() const {
+    return shard_count;
 }
 
 size_t BufferPool::get_max_pages() const {
@@ -360,50 +456,61 @@ size_t BufferPool::get_max_pages() const {
 }
 
 bool BufferPool::is_full() const {
-    return current_page_count >= max_pages;
+    return get_page_count() >= max_pages;
 }
 //
 
-void BufferPool::clear() {
-    directory.clear();
+void BufferPool::reset_shard(Shard& shard) {
+    shard.directory.clear();
     size_t dir_size = 1 << initial_depth;
-    directory.resize(dir_size);
+    shard.directory.resize(dir_size);
 
     for (size_t i = 0; i < dir_size; i++) {
-        directory[i] = std::make_shared<Bucket>(initial_depth, pages_per_bucket);
+        shard.directory[i] = std::make_shared<Bucket>(initial_depth, pages_per_bucket);
     }
 
-    global_depth = initial_depth;
-    current_page_count = 0;
-    clock_ring.clear();
-    clock_hand = 0;
+    shard.global_depth = initial_depth;
+    shard.current_page_count = 0;
+    shard.clock_ring.clear();
+    shard.clock_hand = 0;
 }
 
-void BufferPool::print_stats() const {
-    std::cout << "\n== Extendible Hashing Buffer Pool Statistics ===" << std::endl;
-    std::cout << "Global depth: " << global_depth << std::endl;
-    std::cout << "Directory size: " << directory.size() << std::endl;
-    std::cout << "Current pages: " << current_page_count << std::endl;
-    std::cout << "Max pages: " << max_pages << std::endl;
-    std::cout << "Pages per bucket: " << pages_per_bucket << std::endl;
-    std::cout << "Flooding threshold: " << flooding_threshold_pages << std::endl;
+void BufferPool::clear() {
+    for (size_t i = 0; i < shard_count; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].latch);
+        reset_shard(shards[i]);
+    }
+}
 
+void BufferPool::print_stats() const {
     size_t unique_buckets = 0;
     std::set<Bucket*> seen;
-
-    for (const auto& bucket : directory) {
-        if (seen.find(bucket.get()) == seen.end()) {
-            seen.insert(bucket.get());
-            unique_buckets++;
+    for (size_t i = 0; i < shard_count; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].latch);
+        for (const auto& bucket : shards[i].directory) {
+            if (seen.find(bucket.get()) == seen.end()) {
+                seen.insert(bucket.get());
+                unique_buckets++;
+            }
         }
     }
+    size_t page_count = get_page_count();
 
+    std::cout << "\n== Extendible Hashing Buffer Pool Statistics ===" << std::endl;
+    std::cout << "Shards: " << shard_count << std::endl;
+    std::cout << "Global depth: " << get_global_depth() << std::endl;
+    std::cout << "Directory size: " << get_directory_size() << std::endl;
+    std::cout << "Current pages: " << page_count << std::endl;
+    std::cout << "Max pages: " << max_pages << std::endl;
+    std::cout << "Pages per bucket: " << pages_per_bucket << std::endl;
+    std::cout << "Flooding threshold: " << flooding_threshold_pages << std::endl;
     std::cout << "Unique buckets: " << unique_buckets << std::endl;
-    std::cout << "Load factor: " << static_cast<double>(current_page_count) / (unique_buckets * pages_per_bucket) << std::endl;
+    std::cout << "Load factor: " << static_cast<double>(page_count) / (unique_buckets * pages_per_bucket) << std::endl;
 }
 
 // Sequential flooding protection methods
 std::string BufferPool::begin_scan() {
+    std::lock_guard<std::mutex> lock(scan_mutex);
     std::string scan_id = "scan_" + std::to_string(scan_id_counter++);
     active_scan_page_counts[scan_id] = 0;
     active_scan_pages[scan_id] = std::unordered_set<PageID>();
@@ -411,6 +518,7 @@ std::string BufferPool::begin_scan() {
 }
 
 void BufferPool::access_page_for_scan(const std::string& scan_id, const PageID& page_id) {
+    std::lock_guard<std::mutex> lock(scan_mutex);
     auto scan_it = active_scan_page_counts.find(scan_id);
     if (scan_it == active_scan_page_counts.end()) {
         return; // Invalid scan_id
@@ -429,29 +537,36 @@ void BufferPool::access_page_for_scan(const std::string& scan_id, const PageID&
 }
 
 void BufferPool::end_scan(const std::string& scan_id) {
-    auto scan_it = active_scan_page_counts.find(scan_id);
-    auto pages_it = active_scan_pages.find(scan_id);
+    size_t scanned_pages = 0;
+    std::unordered_set<PageID> pages;
+    {
+        std::lock_guard<std::mutex> lock(scan_mutex);
+        auto scan_it = active_scan_page_counts.find(scan_id);
+        auto pages_it = active_scan_pages.find(scan_id);
+
+        if (scan_it == active_scan_page_counts.end() || pages_it == active_scan_pages.end()) {
+            return; // Invalid scan_id
+        }
 
-    if (scan_it == active_scan_page_counts.end() || pages_it == active_scan_pages.end()) {
-        return; // Invalid scan_id
+        // Clean up scan tracking
+        scanned_pages = scan_it->second;
+        pages = std::move(pages_it->second);
+        active_scan_page_counts.erase(scan_it);
+        active_scan_pages.erase(pages_it);
     }
 
     // If this was a "long" scan, mark all accessed pages with low eviction priority
-    if (scan_it->second > flooding_threshold_pages) {
-        for (const PageID& page_id : pages_it->second) {
+    if (scanned_pages > flooding_threshold_pages) {
+        for (const PageID& page_id : pages) {
             size_t hash_val = hash_page_id(page_id);
-            size_t bucket_index = get_bucket_index(hash_val);
-            auto bucket = directory[bucket_index];
-            Page* page = bucket->find_page(page_id);
+            Shard& shard = shard_for(hash_val);
+            std::lock_guard<std::mutex> lock(shard.latch);
+            Page* page = shard.directory[get_bucket_index(shard, hash_val)]->find_page(page_id);
             if (page) {
                 page->eviction_priority = 1; // Mark as scan-low-priority
             }
         }
     }
-
-    // Clean up scan tracking
-    active_scan_page_counts.erase(scan_it);
-    active_scan_pages.erase(pages_it);
 }
 
 #endif
@@ -6,10 +6,16 @@
 #include <memory>
 #include <cstring>
 #include <functional>
+#include <mutex>
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 
 constexpr size_t PAGE_SIZE = 4096;
+// Shards a database's buffer pool is split into
+constexpr size_t DEFAULT_BUFFER_POOL_SHARDS = 8;
+// A pool is never split into shards smaller than this, so small pools keep one clock
+constexpr size_t MIN_PAGES_PER_BUFFER_POOL_SHARD = 16;
 
 struct PageID {
     std::string filename;
@@ -46,6 +52,7 @@ struct Page {
     size_t pin_count = 0;
     bool dirty = false;
     int eviction_priority = 0; // 0=normal, 1=scan-low-priority
+    size_t hit_count = 0;      // get_page hits since the page was cached
 
     Page(const PageID& id) : page_id(id), is_valid(false) {
         std::memset(data, 0, PAGE_SIZE);
@@ -100,24 +107,36 @@ struct Bucket {
     }
 };
 
+// Pages are spread over independent shards by the high bits of their hash.
+// Each shard is an extendible hash table with its own clock and latch, so
+// threads touching different shards never wait on each other; the low hash
+// bits pick the bucket within a shard. A pool may be shared between threads.
 class BufferPool {
 private:
-    std::vector<std::shared_ptr<Bucket>> directory;
-    size_t global_depth;
+    struct Shard {
+        mutable std::mutex latch;
+        std::vector<std::shared_ptr<Bucket>> directory;
+        size_t global_depth = 0;
+        size_t current_page_count = 0;
+        size_t max_pages = 0;
+        std::vector<Page*> clock_ring; // holds raw pointers to pages for clock traversal
+        size_t clock_hand = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shard_count;
     size_t initial_depth;
     size_t max_global_depth;
     size_t pages_per_bucket;
-    size_t current_page_count;
     size_t max_pages;
     size_t flooding_threshold_pages;
 
-    // Eviction state (global clock)
-    bool eviction_enabled = false;
+    // Eviction settings, shared by all shards
+    std::atomic<bool> eviction_enabled{false};
     std::function<void(const PageID&, const char*)> write_back;
-    std::vector<Page*> clock_ring; // holds raw pointers to pages for clock traversal
-    size_t clock_hand = 0;
 
     // Sequential flooding protection
+    std::mutex scan_mutex;
     std::unordered_map<std::string, size_t> active_scan_page_counts;
     std::unordered_map<std::string, std::unordered_set<PageID>> active_scan_pages;
     size_t scan_id_counter = 0;
@@ -125,27 +144,39 @@ private:
     size_t hash_page_id(const PageID& page_id) const;
     size_t xxhash(const char* data, size_t length, uint64_t seed = 0) const;
 
-    size_t get_bucket_index(size_t hash_value) const;
-    void split_bucket(size_t bucket_index);
+    Shard& shard_for(size_t hash_value) const;
 
-    void double_directory();
-    bool can_expand() const;
+    // The helpers below expect the shard's latch to be held
+    size_t get_bucket_index(const Shard& shard, size_t hash_value) const;
+    void split_bucket(Shard& shard, size_t bucket_index);
+
+    void double_directory(Shard& shard);
+    bool can_expand(const Shard& shard) const;
+    void reset_shard(Shard& shard);
 
     // Eviction internals
-    bool evict_one();
-    void remove_from_clock_ring(Page* page_ptr);
+    bool evict_one(Shard& shard);
+    void remove_from_clock_ring(Shard& shard, Page* page_ptr);
+    void compact_clock_ring(Shard& shard);
 
 public:
     BufferPool(size_t initial_global_depth, size_t max_depth, size_t bucket_size, size_t max_page_limit,
                bool enable_eviction = false,
                std::function<void(const PageID&, const char*)> write_back_cb = nullptr,
-               size_t flood_threshold = 10);
+               size_t flood_threshold = 10, size_t requested_shards = 1);
     ~BufferPool();
 
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
     bool put_page(const PageID& page_id, const char* page_data);
     bool get_page(const PageID& page_id, char* page_data);
     bool contains_page(const PageID& page_id) const;
     bool remove_page(const PageID& page_id);
+    // Drops every page of `filename` in one pass, e.g. once the file is
+    // deleted. `dropped`, if given, receives each page's offset and hit count.
+    size_t remove_file_pages(const std::string& filename,
+                             std::vector<std::pair<size_t, size_t>>* dropped = nullptr);
 
     // Eviction controls/API
     void enable_eviction_policy(bool enable);
@@ -158,9 +189,11 @@ public:
     void access_page_for_scan(const std::string& scan_id, const PageID& page_id);
     void end_scan(const std::string& scan_id);
 
+    // Summed over shards; the global depth is the deepest shard's
     size_t get_directory_size() const;
     size_t get_global_depth() const;
     size_t get_page_count() const;
+    size_t get_shard_count() const;
 
     size_t get_max_pages() const;
     bool is_full() const;
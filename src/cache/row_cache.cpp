@@ -0,0 +1,123 @@
+#ifndef ROW_CACHE_CPP
+#define ROW_CACHE_CPP
+
+#include "row_cache.h"
+#include <functional>
+#include <algorithm>
+
+template<typename K, typename V>
+RowCache<K, V>::RowCache(size_t capacity)
+    : shard_capacity(std::max<size_t>((capacity + ROW_CACHE_SHARDS - 1) / ROW_CACHE_SHARDS, 1)),
+      shards(std::make_unique<Shard[]>(ROW_CACHE_SHARDS)), hit_count(0), miss_count(0) {}
+
+// std::hash of an integer is often the integer itself; mix it so strided keys spread over all shards
+template<typename K, typename V>
+uint64_t RowCache<K, V>::mix(const K& key) {
+    return static_cast<uint64_t>(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ull;
+}
+
+template<typename K, typename V>
+typename RowCache<K, V>::Shard& RowCache<K, V>::shard_for(const K& key) const {
+    return shards[(mix(key) >> 32) % ROW_CACHE_SHARDS];
+}
+
+// Taken from other hash bits than the shard, so keys of one shard use every slot
+template<typename K, typename V>
+size_t RowCache<K, V>::epoch_slot(const K& key) {
+    return (mix(key) >> 16) % ROW_CACHE_EPOCH_SLOTS;
+}
+
+template<typename K, typename V>
+bool RowCache<K, V>::get(const K& key, V& value) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        miss_count++;
+        return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    value = it->second->second;
+    hit_count++;
+    return true;
+}
+
+template<typename K, typename V>
+uint64_t RowCache<K, V>::fill_epoch(const K& key) const {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.epochs[epoch_slot(key)];
+}
+
+template<typename K, typename V>
+void RowCache<K, V>::put(const K& key, const V& value, uint64_t epoch) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.epochs[epoch_slot(key)] != epoch) {
+        return;
+    }
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->second = value;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    if (shard.entries.size() >= shard_capacity) {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(key, value);
+    shard.index.emplace(key, shard.entries.begin());
+}
+
+template<typename K, typename V>
+void RowCache<K, V>::erase(const K& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.epochs[epoch_slot(key)]++;
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+template<typename K, typename V>
+void RowCache<K, V>::clear() {
+    for (size_t i = 0; i < ROW_CACHE_SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        for (uint64_t& epoch : shards[i].epochs) {
+            epoch++;
+        }
+        shards[i].entries.clear();
+        shards[i].index.clear();
+    }
+}
+
+template<typename K, typename V>
+size_t RowCache<K, V>::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < ROW_CACHE_SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        total += shards[i].entries.size();
+    }
+    return total;
+}
+
+template<typename K, typename V>
+size_t RowCache<K, V>::get_capacity() const {
+    return shard_capacity * ROW_CACHE_SHARDS;
+}
+
+template<typename K, typename V>
+size_t RowCache<K, V>::get_hit_count() const {
+    return hit_count;
+}
+
+template<typename K, typename V>
+size_t RowCache<K, V>::get_miss_count() const {
+    return miss_count;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef ROW_CACHE_H
+#define ROW_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+constexpr size_t ROW_CACHE_SHARDS = 16;
+// Erase counters per shard; each key maps to one of them
+constexpr size_t ROW_CACHE_EPOCH_SLOTS = 64;
+
+// Key/value pairs found in SSTs, kept so a hot key skips the bloom probes and
+// the leaf read. Keys are spread over shards by hash; each shard has its own
+// lock and evicts its least recently used entry when full.
+//
+// A fill races with writes to the same key: a reader takes fill_epoch() before
+// it looks the key up, and put() drops the entry if the key has seen an erase
+// since, so a value read before a write cannot land after it. Erases are
+// counted per slot of keys rather than per shard, so writes to other keys
+// rarely cancel a fill.
+template<typename K, typename V>
+class RowCache {
+private:
+    struct Shard {
+        std::mutex mutex;
+        // most recently used first
+        std::list<std::pair<K, V>> entries;
+        std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> index;
+        uint64_t epochs[ROW_CACHE_EPOCH_SLOTS] = {};   // erases so far, per slot
+    };
+
+    size_t shard_capacity;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<size_t> hit_count;
+    std::atomic<size_t> miss_count;
+
+    static uint64_t mix(const K& key);
+    Shard& shard_for(const K& key) const;
+    static size_t epoch_slot(const K& key);
+
+public:
+    // Holds about `capacity` entries in total
+    explicit RowCache(size_t capacity);
+
+    RowCache(const RowCache&) = delete;
+    RowCache& operator=(const RowCache&) = delete;
+
+    bool get(const K& key, V& value);
+    // Token for a later put() of `key`
+    uint64_t fill_epoch(const K& key) const;
+    // Caches a value read from the SSTs, unless the key had an erase after
+    // `epoch` was taken
+    void put(const K& key, const V& value, uint64_t epoch);
+    void erase(const K& key);
+    void clear();
+
+    size_t size() const;
+    size_t get_capacity() const;
+    size_t get_hit_count() const;
+    size_t get_miss_count() const;
+};
+
+#include "row_cache.cpp"
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef COMPACTION_STRATEGY_CPP
+#define COMPACTION_STRATEGY_CPP
+
+#include "compaction_strategy.h"
+#include <algorithm>
+
+template<typename K, typename V>
+CompactionStrategy<K, V>::CompactionStrategy(const CompactionOptions& compaction_options)
+    : options(compaction_options) {
+    options.size_ratio = std::max<size_t>(options.size_ratio, 2);
+    options.level0_file_limit = std::max<size_t>(options.level0_file_limit, 1);
+    options.level1_max_bytes = std::max<size_t>(options.level1_max_bytes, 1);
+    options.target_file_size = std::max<size_t>(options.target_file_size, PAGE_SIZE);
+    options.max_subcompactions = std::max<size_t>(options.max_subcompactions, 1);
+}
+
+template<typename K, typename V>
+const CompactionOptions& CompactionStrategy<K, V>::get_options() const {
+    return options;
+}
+
+template<typename K, typename V>
+size_t CompactionStrategy<K, V>::level_max_bytes(size_t level) const {
+    size_t max_bytes = options.level1_max_bytes;
+    for (size_t l = 1; l < level; l++) {
+        max_bytes *= options.size_ratio;
+    }
+    return max_bytes;
+}
+
+template<typename K, typename V>
+size_t CompactionStrategy<K, V>::level_bytes(const std::vector<std::unique_ptr<SST<K, V>>>& files) {
+    size_t bytes = 0;
+    for (const auto& sst : files) {
+        bytes += sst->get_file_size();
+    }
+    return bytes;
+}
+
+template<typename K, typename V>
+size_t CompactionStrategy<K, V>::run_count(const std::vector<std::unique_ptr<SST<K, V>>>& files) {
+    size_t runs = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (i == 0 || files[i]->get_run_id() != files[i - 1]->get_run_id()) {
+            runs++;
+        }
+    }
+    return runs;
+}
+
+template<typename K, typename V>
+size_t CompactionStrategy<K, V>::delete_heavy_file(const std::vector<std::unique_ptr<SST<K, V>>>& files) {
+    size_t heaviest = files.size();
+    double heaviest_ratio = DELETE_HEAVY_TOMBSTONE_RATIO;
+    for (size_t i = 0; i < files.size(); i++) {
+        size_t entries = files[i]->get_entry_count();
+        double ratio = entries == 0 ? 0 : static_cast<double>(files[i]->get_tombstone_count()) / entries;
+        if (ratio >= heaviest_ratio) {
+            heaviest = i;
+            heaviest_ratio = ratio;
+        }
+    }
+    return heaviest;
+}
+
+template<typename K, typename V>
+double CompactionStrategy<K, V>::tiered_score(const SSTLevels<K, V>& levels, size_t level) const {
+    if (level == 0) {
+        return static_cast<double>(levels[0].size()) / options.level0_file_limit;
+    }
+    return static_cast<double>(run_count(levels[level])) / options.size_ratio;
+}
+
+template<typename K, typename V>
+void CompactionStrategy<K, V>::take_level(const SSTLevels<K, V>& levels, size_t level,
+                                          CompactionJob<K, V>& job) const {
+    job.level = level;
+    job.inputs.clear();
+    job.overlapping.clear();
+    for (const auto& sst : levels[level]) {
+        job.inputs.push_back(sst.get());
+    }
+}
+
+template<typename K, typename V>
+void CompactionStrategy<K, V>::add_overlapping(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) const {
+    size_t target_level = job.level + 1;
+    if (job.inputs.empty() || target_level >= levels.size() || !is_leveled(target_level, levels.size())) {
+        return;
+    }
+
+    K min_key = job.inputs[0]->get_min_key();
+    K max_key = job.inputs[0]->get_max_key();
+    for (const SST<K, V>* sst : job.inputs) {
+        min_key = std::min(min_key, sst->get_min_key());
+        max_key = std::max(max_key, sst->get_max_key());
+    }
+    for (const auto& sst : levels[target_level]) {
+        if (!(sst->get_max_key() < min_key) && !(max_key < sst->get_min_key())) {
+            job.overlapping.push_back(sst.get());
+        }
+    }
+}
+
+template<typename K, typename V>
+LeveledCompaction<K, V>::LeveledCompaction(const CompactionOptions& compaction_options)
+    : CompactionStrategy<K, V>(compaction_options) {
+}
+
+template<typename K, typename V>
+const char* LeveledCompaction<K, V>::get_name() const {
+    return "leveled";
+}
+
+template<typename K, typename V>
+bool LeveledCompaction<K, V>::is_leveled(size_t level, size_t) const {
+    return level > 0;
+}
+
+// Compacts the level that is furthest over its limit: level 0 by file count,
+// the others by size
+template<typename K, typename V>
+bool LeveledCompaction<K, V>::pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) {
+    double best_score = 0;
+    bool found = false;
+    size_t best_level = 0;
+    for (size_t level = 0; level < levels.size(); level++) {
+        double score = level == 0
+            ? this->tiered_score(levels, 0)
+            : static_cast<double>(this->level_bytes(levels[level])) / this->level_max_bytes(level);
+        if (!levels[level].empty() && score >= 1.0 && score > best_score) {
+            best_score = score;
+            best_level = level;
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    if (best_level == 0) {
+        this->take_level(levels, 0, job);
+    } else {
+        // a delete-heavy SST reclaims the most space, so it goes first; otherwise
+        // the first SST past the cursor, wrapping around to the start
+        const auto& files = levels[best_level];
+        size_t pick = this->delete_heavy_file(files);
+        if (pick == files.size()) {
+            pick = 0;
+            auto cursor = cursors.find(best_level);
+            if (cursor != cursors.end()) {
+                while (pick < files.size() && !(cursor->second < files[pick]->get_min_key())) {
+                    pick++;
+                }
+                if (pick == files.size()) {
+                    pick = 0;
+                }
+            }
+            cursors[best_level] = files[pick]->get_max_key();
+        }
+        job.level = best_level;
+        job.inputs = {files[pick].get()};
+        job.overlapping.clear();
+    }
+    this->add_overlapping(levels, job);
+    return true;
+}
+
+template<typename K, typename V>
+TieredCompaction<K, V>::TieredCompaction(const CompactionOptions& compaction_options)
+    : CompactionStrategy<K, V>(compaction_options) {
+}
+
+template<typename K, typename V>
+const char* TieredCompaction<K, V>::get_name() const {
+    return "tiered";
+}
+
+template<typename K, typename V>
+bool TieredCompaction<K, V>::is_leveled(size_t, size_t) const {
+    return false;
+}
+
+template<typename K, typename V>
+bool TieredCompaction<K, V>::pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) {
+    double best_score = 0;
+    bool found = false;
+    size_t best_level = 0;
+    for (size_t level = 0; level < levels.size(); level++) {
+        double score = this->tiered_score(levels, level);
+        if (!levels[level].empty() && score >= 1.0 && score > best_score) {
+            best_score = score;
+            best_level = level;
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    this->take_level(levels, best_level, job);
+    return true;
+}
+
+template<typename K, typename V>
+LazyLeveledCompaction<K, V>::LazyLeveledCompaction(const CompactionOptions& compaction_options)
+    : CompactionStrategy<K, V>(compaction_options) {
+}
+
+template<typename K, typename V>
+const char* LazyLeveledCompaction<K, V>::get_name() const {
+    return "lazy-leveled";
+}
+
+template<typename K, typename V>
+bool LazyLeveledCompaction<K, V>::is_leveled(size_t level, size_t level_count) const {
+    return level > 0 && level + 1 == level_count;
+}
+
+// Upper levels are scored by run count and the last level by size. Any level
+// moves down whole; into the last level it merges with the SSTs it overlaps.
+template<typename K, typename V>
+bool LazyLeveledCompaction<K, V>::pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) {
+    double best_score = 0;
+    bool found = false;
+    size_t best_level = 0;
+    for (size_t level = 0; level < levels.size(); level++) {
+        double score = is_leveled(level, levels.size())
+            ? static_cast<double>(this->level_bytes(levels[level])) / this->level_max_bytes(level)
+            : this->tiered_score(levels, level);
+        if (!levels[level].empty() && score >= 1.0 && score > best_score) {
+            best_score = score;
+            best_level = level;
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    this->take_level(levels, best_level, job);
+    this->add_overlapping(levels, job);
+    return true;
+}
+
+template<typename K, typename V>
+std::unique_ptr<CompactionStrategy<K, V>> make_compaction_strategy(CompactionStyle style,
+                                                                   const CompactionOptions& compaction_options) {
+    switch (style) {
+        case CompactionStyle::TIERED:
+            return std::make_unique<TieredCompaction<K, V>>(compaction_options);
+        case CompactionStyle::LAZY_LEVELED:
+            return std::make_unique<LazyLeveledCompaction<K, V>>(compaction_options);
+        case CompactionStyle::LEVELED:
+        default:
+            return std::make_unique<LeveledCompaction<K, V>>(compaction_options);
+    }
+}
+
+#endif
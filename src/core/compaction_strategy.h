@@ -0,0 +1,136 @@
+#ifndef COMPACTION_STRATEGY_H
+#define COMPACTION_STRATEGY_H
+
+#include <vector>
+#include <memory>
+#include <map>
+#include "../storage/sst.h"
+
+constexpr size_t DEFAULT_COMPACTION_SIZE_RATIO = 10;
+constexpr size_t DEFAULT_LEVEL0_FILE_LIMIT = 2;
+constexpr size_t DEFAULT_LEVEL1_MAX_BYTES = 1024 * 1024;
+constexpr size_t DEFAULT_TARGET_FILE_SIZE = 256 * 1024;
+constexpr size_t DEFAULT_MAX_SUBCOMPACTIONS = 4;
+// Share of tombstones at which an SST is compacted ahead of its turn
+constexpr double DELETE_HEAVY_TOMBSTONE_RATIO = 0.25;
+
+// Shape shared by all strategies: level 0 is merged down once it has
+// level0_file_limit files, a tiered level once it has size_ratio runs, and a
+// leveled level L once it holds more than level1_max_bytes * size_ratio^(L-1) bytes.
+// Compaction output is cut into files of about target_file_size bytes of leaves,
+// and a compaction of several files' worth is split by key range across up to
+// max_subcompactions threads.
+struct CompactionOptions {
+    size_t size_ratio = DEFAULT_COMPACTION_SIZE_RATIO;
+    size_t level0_file_limit = DEFAULT_LEVEL0_FILE_LIMIT;
+    size_t level1_max_bytes = DEFAULT_LEVEL1_MAX_BYTES;
+    size_t target_file_size = DEFAULT_TARGET_FILE_SIZE;
+    size_t max_subcompactions = DEFAULT_MAX_SUBCOMPACTIONS;
+};
+
+enum class CompactionStyle {
+    LEVELED,
+    TIERED,
+    LAZY_LEVELED
+};
+
+template<typename K, typename V>
+using SSTLevels = std::vector<std::vector<std::unique_ptr<SST<K, V>>>>;
+
+// One compaction: `inputs` from `level` merged into `level + 1`, together with
+// the SSTs of `level + 1` in `overlapping` when that level is leveled
+template<typename K, typename V>
+struct CompactionJob {
+    size_t level = 0;
+    std::vector<SST<K, V>*> inputs;
+    std::vector<SST<K, V>*> overlapping;
+};
+
+// Decides the shape of the tree. A leveled level is one sorted run: its SSTs
+// are ordered by key and never overlap, so a lookup probes one of them. Any
+// other level (always level 0) holds several runs, oldest first, whose SSTs
+// may overlap; a lookup checks them youngest first. The files of one run are
+// contiguous and share a run id.
+template<typename K, typename V>
+class CompactionStrategy {
+protected:
+    CompactionOptions options;
+
+    size_t level_max_bytes(size_t level) const;
+    static size_t level_bytes(const std::vector<std::unique_ptr<SST<K, V>>>& files);
+
+    // Runs of a non-leveled level relative to how many it may hold
+    double tiered_score(const SSTLevels<K, V>& levels, size_t level) const;
+    // Index of the SST with the largest share of tombstones, if that share is at
+    // least DELETE_HEAVY_TOMBSTONE_RATIO; files.size() otherwise
+    static size_t delete_heavy_file(const std::vector<std::unique_ptr<SST<K, V>>>& files);
+    // Moves every SST of `level` into the job
+    void take_level(const SSTLevels<K, V>& levels, size_t level, CompactionJob<K, V>& job) const;
+    // Adds the next level's SSTs that overlap the inputs, if that level is leveled
+    void add_overlapping(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) const;
+
+public:
+    explicit CompactionStrategy(const CompactionOptions& compaction_options);
+    virtual ~CompactionStrategy() = default;
+
+    virtual const char* get_name() const = 0;
+    virtual bool is_leveled(size_t level, size_t level_count) const = 0;
+    // Picks the next compaction, or returns false when every level is within its limit
+    virtual bool pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) = 0;
+
+    const CompactionOptions& get_options() const;
+    // Sorted runs among a level's files
+    static size_t run_count(const std::vector<std::unique_ptr<SST<K, V>>>& files);
+};
+
+// Every level below 0 is one sorted run. Level 0 moves down whole; other
+// levels move one SST at a time, taking turns by key unless one SST is
+// mostly tombstones.
+template<typename K, typename V>
+class LeveledCompaction : public CompactionStrategy<K, V> {
+private:
+    // Largest key of the last SST compacted out of each level
+    std::map<size_t, K> cursors;
+
+public:
+    explicit LeveledCompaction(const CompactionOptions& compaction_options = CompactionOptions());
+
+    const char* get_name() const override;
+    bool is_leveled(size_t level, size_t level_count) const override;
+    bool pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) override;
+};
+
+// Every level gathers up to size_ratio runs, which are then merged into one
+// new run on the next level. Each entry is rewritten once per level.
+template<typename K, typename V>
+class TieredCompaction : public CompactionStrategy<K, V> {
+public:
+    explicit TieredCompaction(const CompactionOptions& compaction_options = CompactionOptions());
+
+    const char* get_name() const override;
+    bool is_leveled(size_t level, size_t level_count) const override;
+    bool pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) override;
+};
+
+// Tiering on every level but the last, which is leveled (Dostoevsky's lazy
+// leveling). Most of the data sits in the one sorted last run, so lookups and
+// space stay close to leveling while upper levels merge as cheaply as tiering.
+// When the last level outgrows its limit it moves down whole and a new, larger
+// last level takes over.
+template<typename K, typename V>
+class LazyLeveledCompaction : public CompactionStrategy<K, V> {
+public:
+    explicit LazyLeveledCompaction(const CompactionOptions& compaction_options = CompactionOptions());
+
+    const char* get_name() const override;
+    bool is_leveled(size_t level, size_t level_count) const override;
+    bool pick(const SSTLevels<K, V>& levels, CompactionJob<K, V>& job) override;
+};
+
+template<typename K, typename V>
+std::unique_ptr<CompactionStrategy<K, V>> make_compaction_strategy(
+    CompactionStyle style, const CompactionOptions& compaction_options = CompactionOptions());
+
+#include "compaction_strategy.cpp"
+
+#endif
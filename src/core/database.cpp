@@ -8,10 +8,20 @@
 #include <algorithm>
 #include <chrono>
 #include <map>
+#include <set>
+#include <atomic>
 
 template<typename K, typename V>
 Database<K, V>::Database(const std::string& name, size_t memtable_max_size, double false_positive_rate, size_t buffer_pool_max_pages)
-    : db_name(name), memtable_size(memtable_max_size), is_open(false), bloom_filter_fpr(false_positive_rate) {
+    : db_name(name), memtable_size(memtable_max_size), is_open(false), bloom_filter_fpr(false_positive_rate),
+      bloom_bits_per_entry(0), sst_read_mode(SSTReadMode::BUFFER_POOL),
+      stop_flush_thread(false), flush_in_progress(false), flush_failed(false),
+      stop_compaction_thread(false), compaction_in_progress(false), compaction_requested(false),
+      compaction_strategy(std::make_unique<LeveledCompaction<K, V>>()), next_run_id(1),
+      flush_bytes_written(0), compaction_bytes_written(0), trivial_move_count(0),
+      compaction_warm_up(true), warm_up_page_count(0), open_iterators(0),
+      wal_enabled(true), wal_sync_policy(WalSyncPolicy::INTERVAL), wal_sync_interval_ms(100),
+      immutable_wal_segment(0) {
     db_directory = "data/" + db_name;
     current_memtable = nullptr;
 
@@ -28,7 +38,8 @@ Database<K, V>::Database(const std::string& name, size_t memtable_max_size, doub
         buffer_pool_max_pages,  // max_pages (configurable)
         true,   // enable_eviction
         write_back_cb,
-        10      // flooding_threshold_pages (default)
+        10,     // flooding_threshold_pages (default)
+        DEFAULT_BUFFER_POOL_SHARDS
     );
 }
 
@@ -48,7 +59,21 @@ bool Database<K, V>::open() {
     try {
         ensure_directory_exists();
         current_memtable = std::make_unique<RedBlackTree<K, V>>(memtable_size);
-        load_existing_ssts();
+        flush_failed = false;
+        uint64_t last_sequence = 0;
+        compaction_requested = false;
+        flush_bytes_written = 0;
+        compaction_bytes_written = 0;
+        trivial_move_count = 0;
+        warm_up_page_count = 0;
+        if (row_cache) {
+            row_cache->clear();
+        }
+        if (!load_existing_ssts() || !replay_wal(last_sequence) || !open_wal(last_sequence)) {
+            return false;
+        }
+        start_flush_thread();
+        start_compaction_thread();
         is_open = true;
 
         std::cout << "Database '" << db_name << "' opened successfully." << std::endl;
@@ -68,14 +93,30 @@ bool Database<K, V>::close() {
     }
 
     try {
-        if (current_memtable && current_memtable->size() > 0) {
-            flush_memtable_to_sst();
+        bool flushed = flush_memtable_to_sst();
+        stop_flush_thread_and_join();
+        stop_compaction_thread_and_join();
+        if (flushed) {
+            close_wal();
+        } else if (wal) {
+            // the memtables that were not flushed are replayed from their segments on the next open
+            wal->close();
+            wal.reset();
+        }
+        if (manifest) {
+            manifest->close();
         }
 
         current_memtable.reset();
+        immutable_memtable.reset();
+        spare_memtable.reset();
         // Don't clear levels - keep them in memory for persistence
         is_open = false;
 
+        if (!flushed) {
+            std::cerr << "Database '" << db_name << "' closed with unflushed memtables" << std::endl;
+            return false;
+        }
         std::cout << "Database '" << db_name << "' closed successfully" << std::endl;
         return true;
     } catch (const std::exception& e) {
@@ -90,18 +131,73 @@ bool Database<K, V>::put(const K& key, const V& value) {
         return false;
     }
 
-    // Try to insert into memtable
-    if (current_memtable->put(key, value)) {
-        return true;
+    // If memtable is full, hand it to the background flush first so the log
+    // record lands in the segment belonging to the memtable that holds it
+    if (current_memtable->is_full() && !current_memtable->contains(key) && !schedule_memtable_flush()) {
+        return false;
     }
 
-    // If memtable is full, flush it to SST and try again
-    if (current_memtable->is_full()) {
-        flush_memtable_to_sst();
-        return current_memtable->put(key, value);
+    if (wal && !wal->append(key, value)) {
+        return false;
     }
 
-    return false;
+    if (!current_memtable->put(key, value)) {
+        return false;
+    }
+    // only after the memtable has the key, so a lookup cannot cache the old value again
+    if (row_cache) {
+        row_cache->erase(key);
+    }
+    return true;
+}
+
+template<typename K, typename V>
+bool Database<K, V>::write_batch(const std::vector<std::pair<K, V>>& batch) {
+    if (!is_open || !current_memtable) {
+        return false;
+    }
+
+    // Split the batch wherever the memtable would fill up; each piece is one
+    // commit group in the segment of the memtable it is applied to
+    std::vector<std::pair<K, V>> group;
+    group.reserve(batch.size());
+    size_t room = memtable_size - current_memtable->size();
+
+    for (const auto& record : batch) {
+        if (!current_memtable->contains(record.first)) {
+            if (room == 0) {
+                if (!commit_write_group(group) || !schedule_memtable_flush()) {
+                    return false;
+                }
+                room = memtable_size - current_memtable->size();
+                if (room == 0) {
+                    return false;
+                }
+            }
+            room--;
+        }
+        group.push_back(record);
+    }
+
+    return commit_write_group(group);
+}
+
+template<typename K, typename V>
+bool Database<K, V>::commit_write_group(std::vector<std::pair<K, V>>& group) {
+    if (wal && !wal->append_batch(group)) {
+        return false;
+    }
+
+    for (const auto& record : group) {
+        if (!current_memtable->put(record.first, record.second)) {
+            return false;
+        }
+        if (row_cache) {
+            row_cache->erase(record.first);
+        }
+    }
+    group.clear();
+    return true;
 }
 
 template<typename K, typename V>
@@ -114,6 +210,8 @@ bool Database<K, V>::get(const K& key, V& value, SearchMode mode) {
     if (!is_open || !current_memtable) {
         return false;
     }
+    // taken before anything is read, so a write racing with this lookup keeps its result out of the cache
+    uint64_t fill_epoch = row_cache ? row_cache->fill_epoch(key) : 0;
 
     // Search in memtable first (youngest)
     if (current_memtable && current_memtable->get(key, value)) {
@@ -123,8 +221,35 @@ bool Database<K, V>::get(const K& key, V& value, SearchMode mode) {
         return true;
     }
 
+    // A cached row is no older than the memtables: writing a key erases its row
+    if (row_cache && row_cache->get(key, value)) {
+        return value != TOMBSTONE;
+    }
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+
+    // Then the memtable that is waiting to be flushed
+    if (immutable_memtable && immutable_memtable->get(key, value)) {
+        if (value == TOMBSTONE) {
+            return false;
+        }
+        return true;
+    }
+
     // Search levels from youngest to oldest (level 0 to higher levels)
     for (size_t level = 0; level < levels.size(); level++) {
+        // A leveled level has at most one SST whose range holds the key
+        if (compaction_strategy->is_leveled(level, levels.size())) {
+            const SST<K, V>* sst_ptr = find_sst_in_level(level, key);
+            if (sst_ptr && sst_ptr->bloom_filter_contains(key) && sst_ptr->get(key, value, mode)) {
+                if (row_cache) {
+                    row_cache->put(key, value, fill_epoch);
+                }
+                return value != TOMBSTONE;
+            }
+            continue;
+        }
+
         // Search SSTs in reverse order within each level (youngest first)
         for (auto it = levels[level].rbegin(); it != levels[level].rend(); ++it) {
             const auto& sst_ptr = *it;
@@ -133,6 +258,9 @@ bool Database<K, V>::get(const K& key, V& value, SearchMode mode) {
                 if (key < sst_ptr->get_min_key() || key > sst_ptr->get_max_key())
                     continue;
                 if (sst_ptr->get(key, value, mode)) {
+                    if (row_cache) {
+                        row_cache->put(key, value, fill_epoch);
+                    }
                     if (value == TOMBSTONE) {
                         return false;
                     }
@@ -146,109 +274,679 @@ bool Database<K, V>::get(const K& key, V& value, SearchMode mode) {
 }
 
 template<typename K, typename V>
-std::pair<K, V>* Database<K, V>::scan(const K& start_key, const K& end_key, size_t& result_size, SearchMode mode) {
-    result_size = 0;
+std::vector<bool> Database<K, V>::multi_get(const std::vector<K>& keys, std::vector<V>& values) {
+    std::vector<bool> found(keys.size(), false);
+    values.assign(keys.size(), V{});
+    if (!is_open || !current_memtable || keys.empty()) {
+        return found;
+    }
 
-    if (!is_open) {
-        return nullptr;
+    // distinct keys in order; slot_of maps every input position onto one of them
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    std::vector<K> distinct;
+    std::vector<size_t> slot_of(keys.size());
+    for (size_t i : order) {
+        if (distinct.empty() || distinct.back() < keys[i]) {
+            distinct.push_back(keys[i]);
+        }
+        slot_of[i] = distinct.size() - 1;
     }
 
-    std::map<K, V> result_map;
+    // a key is settled by its youngest version; tombstones settle it as missing
+    std::vector<V> distinct_values(distinct.size());
+    std::vector<bool> settled(distinct.size(), false);
+    std::vector<size_t> pending(distinct.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+        pending[i] = i;
+    }
+    auto drop_settled = [&]() {
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [&](size_t k) { return settled[k]; }),
+                      pending.end());
+    };
+    auto probe_memtable = [&](RedBlackTree<K, V>& memtable) {
+        for (size_t k : pending) {
+            if (memtable.get(distinct[k], distinct_values[k])) {
+                settled[k] = true;
+            }
+        }
+        drop_settled();
+    };
 
-    // Scan levels from oldest to youngest (higher levels first)
-    for (int level = static_cast<int>(levels.size()) - 1; level >= 0; level--) {
-        for (const auto& sst : levels[level]) {
-            if (end_key < sst->get_min_key() || start_key > sst->get_max_key()) {
+    // the pending keys of [first, last) that fall in `sst`, looked up as one batch
+    std::vector<K> batch;
+    std::vector<V> batch_values;
+    std::vector<bool> batch_found;
+    auto probe_sst = [&](const SST<K, V>& sst, size_t first, size_t last) {
+        batch.clear();
+        for (size_t p = first; p < last; p++) {
+            batch.push_back(distinct[pending[p]]);
+        }
+        if (batch.empty() || sst.multi_get(batch, batch_values, batch_found) == 0) {
+            return;
+        }
+        for (size_t p = first; p < last; p++) {
+            if (batch_found[p - first]) {
+                distinct_values[pending[p]] = batch_values[p - first];
+                settled[pending[p]] = true;
+            }
+        }
+    };
+    // index into `pending` of the first key not less than `key`
+    auto pending_lower_bound = [&](const K& key) {
+        return static_cast<size_t>(std::lower_bound(pending.begin(), pending.end(), key,
+            [&](size_t k, const K& target) { return distinct[k] < target; }) - pending.begin());
+    };
+    auto pending_upper_bound = [&](const K& key) {
+        return static_cast<size_t>(std::upper_bound(pending.begin(), pending.end(), key,
+            [&](const K& target, size_t k) { return target < distinct[k]; }) - pending.begin());
+    };
+
+    probe_memtable(*current_memtable);
+
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (immutable_memtable && !pending.empty()) {
+            probe_memtable(*immutable_memtable);
+        }
+
+        for (size_t level = 0; level < levels.size() && !pending.empty(); level++) {
+            if (compaction_strategy->is_leveled(level, levels.size())) {
+                // the SSTs are disjoint, so each pending key meets at most one of them
+                for (const auto& sst : levels[level]) {
+                    probe_sst(*sst, pending_lower_bound(sst->get_min_key()), pending_upper_bound(sst->get_max_key()));
+                }
+                drop_settled();
                 continue;
             }
-            auto sst_results = sst->scan(start_key, end_key, mode);
-            for (const auto& pair : sst_results) {
-                result_map[pair.first] = pair.second;
+            // youngest first, and what one SST settles is not looked up again
+            for (auto it = levels[level].rbegin(); it != levels[level].rend() && !pending.empty(); ++it) {
+                const auto& sst = *it;
+                probe_sst(*sst, pending_lower_bound(sst->get_min_key()), pending_upper_bound(sst->get_max_key()));
+                drop_settled();
             }
         }
     }
 
-    // Scan memtable last (youngest)
-    if (current_memtable) {
-        auto memtable_results = current_memtable->scan(start_key, end_key);
-        for (const auto& pair : memtable_results) {
-            result_map[pair.first] = pair.second;
+    for (size_t i = 0; i < keys.size(); i++) {
+        size_t k = slot_of[i];
+        if (settled[k] && distinct_values[k] != TOMBSTONE) {
+            values[i] = distinct_values[k];
+            found[i] = true;
         }
     }
+    return found;
+}
 
-    // take tombstones from results
-    for (auto it = result_map.begin(); it != result_map.end(); ) {
-        if (it->second == TOMBSTONE) {
-            it = result_map.erase(it);
-        } else {
-            ++it;
+template<typename K, typename V>
+std::pair<K, V>* Database<K, V>::scan(const K& start_key, const K& end_key, size_t& result_size, SearchMode) {
+    return scan(start_key, end_key, result_size, std::numeric_limits<size_t>::max());
+}
+
+template<typename K, typename V>
+std::pair<K, V>* Database<K, V>::scan(const K& start_key, const K& end_key, size_t& result_size, size_t limit,
+                                      ScanDirection direction) {
+    result_size = 0;
+
+    auto it = new_iterator();
+    if (!it || limit == 0) {
+        return nullptr;
+    }
+    // stop as soon as the limit is met so no further leaf is read
+    std::vector<std::pair<K, V>> results;
+    if (direction == ScanDirection::FORWARD) {
+        for (it->seek(start_key); it->valid() && !(end_key < it->key()); it->next()) {
+            results.emplace_back(it->key(), it->value());
+            if (results.size() == limit) {
+                break;
+            }
+        }
+    } else {
+        for (it->seek_for_prev(end_key); it->valid() && !(it->key() < start_key); it->prev()) {
+            results.emplace_back(it->key(), it->value());
+            if (results.size() == limit) {
+                break;
+            }
         }
     }
+    it.reset();
 
-    // Convert map to array
-    result_size = result_map.size();
+    result_size = results.size();
     if (result_size == 0) {
         return nullptr;
     }
-
     std::pair<K, V>* result_array = new std::pair<K, V>[result_size];
-    size_t i = 0;
-    for (const auto& pair : result_map) {
-        result_array[i++] = pair;
-    }
+    std::copy(results.begin(), results.end(), result_array);
     return result_array;
 }
 
 template<typename K, typename V>
-void Database<K, V>::flush_memtable_to_sst() {
+std::unique_ptr<DatabaseIterator<K, V>> Database<K, V>::new_iterator() {
+    if (!is_open || !current_memtable) {
+        return nullptr;
+    }
+
+    std::vector<const RedBlackTree<K, V>*> memtables = {current_memtable.get()};
+    std::vector<typename DatabaseIterator<K, V>::Run> runs;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (immutable_memtable) {
+        memtables.push_back(immutable_memtable.get());
+    }
+
+    for (size_t level = 0; level < levels.size(); level++) {
+        const auto& files = levels[level];
+        if (compaction_strategy->is_leveled(level, levels.size())) {
+            // one run, already ordered by key
+            typename DatabaseIterator<K, V>::Run run;
+            for (const auto& sst : files) {
+                run.push_back(sst.get());
+            }
+            runs.push_back(std::move(run));
+            continue;
+        }
+        // the runs of other levels are contiguous and oldest first
+        size_t end = files.size();
+        while (end > 0) {
+            size_t begin = end - 1;
+            while (begin > 0 && files[begin - 1]->get_run_id() == files[end - 1]->get_run_id()) {
+                begin--;
+            }
+            typename DatabaseIterator<K, V>::Run run;
+            for (size_t i = begin; i < end; i++) {
+                run.push_back(files[i].get());
+            }
+            std::sort(run.begin(), run.end(), [](const SST<K, V>* a, const SST<K, V>* b) {
+                return a->get_min_key() < b->get_min_key();
+            });
+            runs.push_back(std::move(run));
+            end = begin;
+        }
+    }
+
+    open_iterators++;
+    return std::make_unique<DatabaseIterator<K, V>>(memtables, std::move(runs),
+                                                    [this] { release_iterator(); });
+}
+
+// The last iterator to close frees what flushes and compactions retired while
+// iterators were open
+template<typename K, typename V>
+void Database<K, V>::release_iterator() {
+    std::vector<std::unique_ptr<RedBlackTree<K, V>>> memtables;
+    std::vector<std::unique_ptr<SST<K, V>>> ssts;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (--open_iterators > 0) {
+            return;
+        }
+        memtables.swap(retired_memtables);
+        ssts.swap(retired_ssts);
+        for (auto& sst : ssts) {
+            sst->drop_cached_pages();
+        }
+    }
+    for (auto& sst : ssts) {
+        SST<K, V>::remove_file(sst->get_filename());
+    }
+}
+
+template<typename K, typename V>
+bool Database<K, V>::flush_memtable_to_sst() {
+    if (!schedule_memtable_flush() || !wait_for_flush()) {
+        return false;
+    }
+    wait_for_compaction();
+    return true;
+}
+
+// Returns false, keeping the memtable, if an earlier flush failed
+template<typename K, typename V>
+bool Database<K, V>::schedule_memtable_flush() {
     if (!current_memtable || current_memtable->size() == 0) {
-        return;
+        std::lock_guard<std::mutex> lock(state_mutex);
+        return !flush_failed;
     }
 
-    try {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    // Only one immutable memtable at a time, so wait out a flush that is still running
+    flush_cv.wait(lock, [this] { return !immutable_memtable || flush_failed; });
+    if (flush_failed) {
+        return false;
+    }
+
+    immutable_memtable = std::move(current_memtable);
+    if (wal) {
+        immutable_wal_segment = wal->rotate();
+    }
+    if (spare_memtable) {
+        current_memtable = std::move(spare_memtable);
+    } else {
+        current_memtable = std::make_unique<RedBlackTree<K, V>>(memtable_size);
+    }
+
+    lock.unlock();
+    flush_cv.notify_all();
+    return true;
+}
+
+template<typename K, typename V>
+bool Database<K, V>::wait_for_flush() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    flush_cv.wait(lock, [this] { return flush_failed || (!immutable_memtable && !flush_in_progress); });
+    return !flush_failed;
+}
+
+// Writes sorted memtable data to a new, fsynced level-0 SST and records it in
+// the manifest as run `run_id`. Does not touch levels, so it can run without
+// state_mutex.
+template<typename K, typename V>
+std::unique_ptr<SST<K, V>> Database<K, V>::write_level0_sst(const std::vector<std::pair<K, V>>& sorted_data,
+                                                            double false_positive_rate, uint64_t run_id,
+                                                            std::string& sst_filename) {
+    // filename for level 0
+    sst_filename = generate_sst_filename(0);
+    std::string sst_path = db_directory + "/" + sst_filename;
+
+    // create SST file from memtable data at level 0
+    auto sst = std::make_unique<SST<K, V>>(sst_path, buffer_pool.get(), 0, false_positive_rate);
+    if (!sst->create_from_memtable(sst_path, sorted_data, 0)) {
+        // a partial file would be loaded as an SST on the next open
+        std::cerr << "Create SST file fail: " << sst_filename << std::endl;
+        SST<K, V>::remove_file(sst_path);
+        return nullptr;
+    }
+    // the manifest and the log segment's removal both rely on the SST being durable
+    if (!sst->sync_file()) {
+        std::cerr << "Failed to sync SST file: " << sst_filename << std::endl;
+        SST<K, V>::remove_file(sst_path);
+        return nullptr;
+    }
+    if (!manifest->log_edit({{ManifestChangeType::ADD, 0, sst_filename, run_id}})) {
+        SST<K, V>::remove_file(sst_path);
+        return nullptr;
+    }
+    sst->set_run_id(run_id);
+    sst->set_read_mode(sst_read_mode);
+    return sst;
+}
+
+// Rebuilds the memtable from the log segments left by a previous run. The
+// segments stay on disk until the memtable they were loaded into is flushed;
+// if some keys were spilled to SSTs, the rest is first moved to a segment of
+// its own so a later replay does not spill those keys again.
+template<typename K, typename V>
+bool Database<K, V>::replay_wal(uint64_t& last_sequence) {
+    last_sequence = 0;
+    auto segments = WriteAheadLog<K, V>::list_segments(db_directory);
+    if (segments.empty()) {
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::pair<K, V>> records;
+    if (!WriteAheadLog<K, V>::replay_segments(db_directory, segments, records, last_sequence)) {
+        std::cerr << "Failed to read WAL segments in " << db_directory << std::endl;
+        return false;
+    }
+
+    // Whatever does not fit in one memtable (or everything, when there will be
+    // no log to keep it in) goes straight to level-0 SSTs. The records are
+    // sorted and unique, so those SSTs and the memtable never overlap.
+    size_t keep_in_memtable = wal_enabled ? std::min(records.size(), memtable_size) : 0;
+    size_t spill = records.size() - keep_in_memtable;
+    size_t chunk_size = memtable_size > 0 ? memtable_size : records.size();
+
+    for (size_t begin = 0; begin < spill; begin += chunk_size) {
+        size_t end = std::min(spill, begin + chunk_size);
+        std::vector<std::pair<K, V>> chunk(records.begin() + begin, records.begin() + end);
+        std::string sst_filename;
+        double false_positive_rate;
+        uint64_t run_id;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            false_positive_rate = level_false_positive_rate(0, chunk.size());
+            run_id = next_run_id++;
+        }
+        auto sst = write_level0_sst(chunk, false_positive_rate, run_id, sst_filename);
+        if (!sst) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state_mutex);
         if (levels.empty()) {
             levels.resize(1);
         }
+        flush_bytes_written += sst->get_file_size();
+        levels[0].push_back(std::move(sst));
+        compaction_requested = true;
+    }
+
+    if (keep_in_memtable > 0) {
+        std::vector<std::pair<K, V>> tail(records.begin() + spill, records.end());
+        if (spill > 0) {
+            WriteAheadLog<K, V> tail_log(db_directory, WalSyncPolicy::NEVER);
+            if (!tail_log.open(segments.back() + 1, last_sequence) || !tail_log.append_batch(tail) ||
+                !tail_log.sync()) {
+                std::cerr << "Failed to rewrite replayed WAL records in " << db_directory << std::endl;
+                return false;
+            }
+            last_sequence = tail_log.get_last_sequence();
+            tail_log.close();
+            remove_wal_segments_up_to(segments.back());
+        }
+        current_memtable->bulk_load(tail);
+    } else {
+        remove_wal_segments_up_to(segments.back());
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Replayed " << records.size() << " keys from " << segments.size() << " WAL segment(s) in "
+              << elapsed_ms << " ms" << std::endl;
+    return true;
+}
+
+template<typename K, typename V>
+void Database<K, V>::remove_wal_segments_up_to(uint64_t segment) {
+    for (uint64_t number : WriteAheadLog<K, V>::list_segments(db_directory)) {
+        if (number <= segment) {
+            WriteAheadLog<K, V>::remove_segment(db_directory, number);
+        }
+    }
+}
+
+template<typename K, typename V>
+bool Database<K, V>::open_wal(uint64_t last_sequence) {
+    if (!wal_enabled) {
+        return true;
+    }
+
+    // Start after any segment left behind so existing log data is never overwritten
+    auto segments = WriteAheadLog<K, V>::list_segments(db_directory);
+    uint64_t first_segment = segments.empty() ? 1 : segments.back() + 1;
+
+    wal = std::make_unique<WriteAheadLog<K, V>>(db_directory, wal_sync_policy, wal_sync_interval_ms);
+    if (!wal->open(first_segment, last_sequence)) {
+        wal.reset();
+        return false;
+    }
+    return true;
+}
+
+// Only called after the memtable has been flushed, so the live segment holds nothing we need
+template<typename K, typename V>
+void Database<K, V>::close_wal() {
+    if (!wal) {
+        return;
+    }
+
+    uint64_t segment = wal->get_segment_number();
+    wal->close();
+    wal.reset();
+    WriteAheadLog<K, V>::remove_segment(db_directory, segment);
+}
+
+template<typename K, typename V>
+void Database<K, V>::set_wal_options(bool enabled, WalSyncPolicy policy, size_t sync_interval_ms) {
+    wal_enabled = enabled;
+    wal_sync_policy = policy;
+    wal_sync_interval_ms = sync_interval_ms;
+}
+
+template<typename K, typename V>
+bool Database<K, V>::sync_wal() {
+    return wal ? wal->sync() : false;
+}
+
+template<typename K, typename V>
+void Database<K, V>::set_read_mode(SSTReadMode mode) {
+    sst_read_mode = mode;
+}
+
+template<typename K, typename V>
+bool Database<K, V>::set_row_cache_capacity(size_t entries) {
+    // get() and the writers use the cache without a lock
+    if (is_open) {
+        return false;
+    }
+    if (entries == 0) {
+        row_cache.reset();
+    } else {
+        row_cache = std::make_unique<RowCache<K, V>>(entries);
+    }
+    return true;
+}
 
-        // filename for level 0
-        std::string sst_filename = generate_sst_filename(0);
-        std::string sst_path = db_directory + "/" + sst_filename;
+template<typename K, typename V>
+bool Database<K, V>::set_compaction_strategy(std::unique_ptr<CompactionStrategy<K, V>> strategy) {
+    // the compaction thread uses the strategy while the database is open
+    if (is_open || !strategy) {
+        return false;
+    }
+    compaction_strategy = std::move(strategy);
+    return true;
+}
+
+template<typename K, typename V>
+const CompactionStrategy<K, V>& Database<K, V>::get_compaction_strategy() const {
+    return *compaction_strategy;
+}
 
+template<typename K, typename V>
+void Database<K, V>::set_bloom_filter_budget(double bits_per_entry) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    bloom_bits_per_entry = std::max(bits_per_entry, 0.0);
+}
+
+template<typename K, typename V>
+void Database<K, V>::set_compaction_rate_limit(size_t bytes_per_second) {
+    compaction_rate_limiter.set_rate(bytes_per_second);
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_compaction_bytes() const {
+    return compaction_rate_limiter.get_total_bytes();
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_flush_bytes_written() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return flush_bytes_written;
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_compaction_bytes_written() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return compaction_bytes_written;
+}
+
+template<typename K, typename V>
+double Database<K, V>::get_write_amplification() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (flush_bytes_written == 0) {
+        return 0;
+    }
+    return static_cast<double>(flush_bytes_written + compaction_bytes_written) / flush_bytes_written;
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_trivial_move_count() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return trivial_move_count;
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_row_cache_hit_count() const {
+    return row_cache ? row_cache->get_hit_count() : 0;
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_row_cache_miss_count() const {
+    return row_cache ? row_cache->get_miss_count() : 0;
+}
+
+template<typename K, typename V>
+void Database<K, V>::set_compaction_warm_up(bool enabled) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    compaction_warm_up = enabled;
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_warm_up_page_count() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return warm_up_page_count;
+}
+
+template<typename K, typename V>
+void Database<K, V>::start_flush_thread() {
+    stop_flush_thread = false;
+    flush_in_progress = false;
+    flush_thread = std::thread(&Database<K, V>::flush_thread_loop, this);
+}
+
+template<typename K, typename V>
+void Database<K, V>::stop_flush_thread_and_join() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stop_flush_thread = true;
+    }
+    flush_cv.notify_all();
+
+    if (flush_thread.joinable()) {
+        flush_thread.join();
+    }
+}
+
+template<typename K, typename V>
+void Database<K, V>::flush_thread_loop() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    while (true) {
+        flush_cv.wait(lock, [this] { return stop_flush_thread || (immutable_memtable && !flush_failed); });
+        if (!immutable_memtable || flush_failed) {
+            // stop requested, and nothing left to write or nothing that can be
+            break;
+        }
+
+        flush_in_progress = true;
+        lock.unlock();
+        write_immutable_memtable();
+        lock.lock();
+        flush_in_progress = false;
+        flush_cv.notify_all();
+    }
+}
+
+// Runs on the flush thread. The SST file is written without holding
+// state_mutex (the immutable memtable is read-only by now), so puts keep
+// going into the new memtable; only installing the SST takes the lock. If
+// the SST cannot be written, the memtable stays readable and its WAL segment
+// stays on disk, and flush_failed stops further flushes.
+template<typename K, typename V>
+void Database<K, V>::write_immutable_memtable() {
+    std::string sst_filename;
+    std::unique_ptr<SST<K, V>> sst;
+
+    try {
         // Get all data from memtable using scan with min/max bounds
         std::vector<std::pair<K, V>> memtable_data;
-        if (current_memtable->size() > 0) {
-            K min_key = current_memtable->get_min_key();
-            K max_key = current_memtable->get_max_key();
-            memtable_data = current_memtable->scan(min_key, max_key);
+        if (immutable_memtable->size() > 0) {
+            K min_key = immutable_memtable->get_min_key();
+            K max_key = immutable_memtable->get_max_key();
+            memtable_data = immutable_memtable->scan(min_key, max_key);
+        }
+        double false_positive_rate;
+        uint64_t run_id;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            false_positive_rate = level_false_positive_rate(0, memtable_data.size());
+            run_id = next_run_id++;
         }
+        sst = write_level0_sst(memtable_data, false_positive_rate, run_id, sst_filename);
+    } catch (const std::exception& e) {
+        std::cerr << "Error flushing memtable to SST: " << e.what() << std::endl;
+        sst.reset();
+    }
 
-        // create SST file from memtable data at level 0
-        auto sst = std::make_unique<SST<K, V>>(sst_path, buffer_pool.get(), 0, bloom_filter_fpr);
-        if (sst->create_from_memtable(sst_path, memtable_data, 0)) {
-            levels[0].push_back(std::move(sst));
-            std::cout << "Successfully flushed memtable to SST: " << sst_filename << std::endl;
-        } else {
-            std::cerr << "Create SST file fail: " << sst_filename << std::endl;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (!sst) {
+        std::cerr << "Flush failed; " << immutable_memtable->size() << " keys stay in the WAL" << std::endl;
+        flush_failed = true;
+        return;
+    }
+    try {
+        if (levels.empty()) {
+            levels.resize(1);
         }
+        flush_bytes_written += sst->get_file_size();
+        levels[0].push_back(std::move(sst));
+        std::cout << "Successfully flushed memtable to SST: " << sst_filename << std::endl;
 
-        // Clear the memtable after successful flush
-        current_memtable->clear();
+        if (immutable_wal_segment != 0) {
+            remove_wal_segments_up_to(immutable_wal_segment);
+            immutable_wal_segment = 0;
+        }
 
-        try_compaction();
+        // The SST is visible now, so the immutable memtable can be recycled
+        // unless an open iterator may still be reading it
+        if (open_iterators > 0) {
+            retired_memtables.push_back(std::move(immutable_memtable));
+        } else {
+            immutable_memtable->clear();
+            spare_memtable = std::move(immutable_memtable);
+        }
 
+        compaction_requested = true;
+        compaction_cv.notify_all();
     } catch (const std::exception& e) {
         std::cerr << "Error flushing memtable to SST: " << e.what() << std::endl;
+        flush_failed = true;
     }
 }
 
 template<typename K, typename V>
-void Database<K, V>::load_existing_ssts() {
-    if (!std::filesystem::exists(db_directory)) {
-        return;
+bool Database<K, V>::load_existing_ssts() {
+    levels.clear();
+    manifest = std::make_unique<Manifest>(db_directory);
+    if (!Manifest::exists(db_directory)) {
+        return load_ssts_without_manifest();
     }
 
-    levels.clear();
+    if (!manifest->open()) {
+        return false;
+    }
+
+    std::set<std::string> live_files;
+    auto layout = manifest->get_layout();
+    levels.resize(layout.size());
+    for (size_t level = 0; level < layout.size(); level++) {
+        for (const auto& filename : layout[level]) {
+            std::unique_ptr<SST<K, V>> sst;
+            if (!SST<K, V>::load_existing_sst(db_directory + "/" + filename, sst, buffer_pool.get())) {
+                std::cerr << "Failed to load SST listed in manifest: " << filename << std::endl;
+                return false;
+            }
+            sst->set_read_mode(sst_read_mode);
+            levels[level].push_back(std::move(sst));
+            live_files.insert(filename);
+        }
+    }
+
+    // Output of a flush or compaction that stopped before its manifest edit
+    for (const auto& entry : std::filesystem::directory_iterator(db_directory)) {
+        std::string filename = entry.path().filename().string();
+        if (entry.is_regular_file() && entry.path().extension() == ".sst" && !live_files.count(filename)) {
+            std::cerr << "Removing SST not in manifest: " << filename << std::endl;
+            SST<K, V>::remove_file(entry.path().string());
+        }
+    }
+    return arrange_loaded_levels();
+}
 
+// Databases written before the manifest existed: rebuild the levels from the
+// SST headers once and record them in a new manifest
+template<typename K, typename V>
+bool Database<K, V>::load_ssts_without_manifest() {
     std::map<size_t, std::vector<std::unique_ptr<SST<K, V>>>> ssts_by_level;
 
     for (const auto& entry : std::filesystem::directory_iterator(db_directory)) {
@@ -263,25 +961,47 @@ void Database<K, V>::load_existing_ssts() {
 
         std::unique_ptr<SST<K, V>> sst;
         if (SST<K, V>::load_existing_sst(filename, sst, buffer_pool.get())) {
+            sst->set_read_mode(sst_read_mode);
             size_t level = sst->get_level();
             ssts_by_level[level].push_back(std::move(sst));
         }
     }
 
     // Organize SSTs into levels
+    std::vector<std::vector<std::string>> layout;
     if (!ssts_by_level.empty()) {
         size_t max_level = ssts_by_level.rbegin()->first;
         levels.resize(max_level + 1);
+        layout.resize(max_level + 1);
 
         for (auto& [level, sst_vec] : ssts_by_level) {
+            // file names start with the creation time, so this is roughly oldest first
+            std::sort(sst_vec.begin(), sst_vec.end(), [](const auto& a, const auto& b) {
+                return a->get_filename() < b->get_filename();
+            });
+            for (const auto& sst : sst_vec) {
+                layout[level].push_back(std::filesystem::path(sst->get_filename()).filename().string());
+            }
             levels[level] = std::move(sst_vec);
-         }
+        }
+    }
+
+    if (!arrange_loaded_levels()) {
+        return false;
     }
+    std::map<std::string, uint64_t> run_ids;
+    for (const auto& files : levels) {
+        for (const auto& sst : files) {
+            run_ids[std::filesystem::path(sst->get_filename()).filename().string()] = sst->get_run_id();
+        }
+    }
+    return manifest->create(layout, run_ids);
 }
 
 template<typename K, typename V>
 std::string Database<K, V>::generate_sst_filename(size_t level) {
-    static int counter = 0;
+    // the flush and compaction threads both name new files
+    static std::atomic<int> counter{0};
     auto now = std::chrono::system_clock::now();
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()).count();
@@ -297,56 +1017,419 @@ std::string Database<K, V>::generate_sst_filename(size_t level) {
 }
 
 template<typename K, typename V>
-void Database<K, V>::try_compaction() {
-    for (size_t level = 0; level < levels.size(); level++) {
-        if (levels[level].size() >= 2) {
-            compact_level(level);
+void Database<K, V>::start_compaction_thread() {
+    stop_compaction_thread = false;
+    compaction_in_progress = false;
+    compaction_thread = std::thread(&Database<K, V>::compaction_thread_loop, this);
+}
+
+template<typename K, typename V>
+void Database<K, V>::stop_compaction_thread_and_join() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stop_compaction_thread = true;
+    }
+    compaction_cv.notify_all();
+
+    if (compaction_thread.joinable()) {
+        compaction_thread.join();
+    }
+}
+
+template<typename K, typename V>
+void Database<K, V>::wait_for_compaction() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    compaction_cv.wait(lock, [this] { return !compaction_in_progress && !compaction_requested; });
+}
+
+// Merges run one at a time on this thread, so a put never waits for a
+// cascade of compactions; it only waits if the flush it hands off to is stuck
+// behind a full immutable memtable.
+template<typename K, typename V>
+void Database<K, V>::compaction_thread_loop() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    while (true) {
+        compaction_cv.wait(lock, [this] { return stop_compaction_thread || compaction_requested; });
+        if (stop_compaction_thread) {
+            break;
+        }
+
+        CompactionJob<K, V> job;
+        if (!compaction_strategy->pick(levels, job)) {
+            compaction_requested = false;
+            compaction_cv.notify_all();
+            continue;
+        }
 
+        compaction_in_progress = true;
+        if (!run_compaction(job, lock)) {
+            // try again after the next flush rather than spin on the same failure
+            compaction_requested = false;
         }
+        compaction_in_progress = false;
+        compaction_cv.notify_all();
     }
 }
 
+// Called with state_mutex held; the lock is released while the merged file is
+// written, and the inputs stay readable until the result is installed. Only
+// this thread removes SSTs, and flushes only append to level 0, so the inputs
+// stay where they were picked.
 template<typename K, typename V>
-void Database<K, V>::compact_level(size_t level) {
-    if (levels[level].size() < 2) {
-        return;
+bool Database<K, V>::run_compaction(const CompactionJob<K, V>& job, std::unique_lock<std::mutex>& lock) {
+    // nothing to merge: inputs that share no keys with each other or the next level move down whole
+    if (job.overlapping.empty() && key_ranges_disjoint(job.inputs)) {
+        return move_compaction_inputs(job, lock);
     }
+    size_t target_level = job.level + 1;
 
-    auto sst1 = std::move(levels[level][0]);
-    auto sst2 = std::move(levels[level][1]);
+    // the next level is older than the picked files, which are already oldest first
+    std::vector<SST<K, V>*> merge_inputs = job.overlapping;
+    merge_inputs.insert(merge_inputs.end(), job.inputs.begin(), job.inputs.end());
 
-    // remove first two sst from the current level
-    levels[level].erase(levels[level].begin(), levels[level].begin() + 2);
+    const CompactionOptions& compaction_options = compaction_strategy->get_options();
+    size_t input_entries = 0;
+    for (const SST<K, V>* sst : job.inputs) {
+        input_entries += sst->get_entry_count();
+    }
+    SSTMergeOptions merge_options;
+    merge_options.max_file_size = compaction_options.target_file_size;
+    merge_options.max_subcompactions = compaction_options.max_subcompactions;
+    merge_options.drop_tombstones = is_bottommost_compaction(job);
+    merge_options.false_positive_rate = level_false_positive_rate(target_level, input_entries);
+    merge_options.buffer_pool = buffer_pool.get();
+    merge_options.limiter = &compaction_rate_limiter;
+    // the outputs are the newest run of their level, or part of the one sorted run
+    uint64_t run_id = next_run_id++;
+
+    lock.unlock();
+
+    // the output is split into files of about the target size, each with a new
+    // filename; subcompaction threads ask for names one at a time
+    std::vector<std::string> output_filenames;
+    auto next_file_path = [&]() {
+        output_filenames.push_back(generate_sst_filename(target_level));
+        return db_directory + "/" + output_filenames.back();
+    };
+    std::vector<std::unique_ptr<SST<K, V>>> outputs;
+    bool merged = SST<K, V>::create_from_merge(next_file_path, merge_inputs, target_level, outputs, merge_options);
+
+    // the new files replace their inputs in one manifest edit, once they are durable
+    if (merged) {
+        std::vector<ManifestChange> changes;
+        for (const std::string& filename : output_filenames) {
+            changes.push_back({ManifestChangeType::ADD, target_level, filename, run_id});
+        }
+        for (const SST<K, V>* sst : job.inputs) {
+            changes.push_back({ManifestChangeType::REMOVE, job.level,
+                               std::filesystem::path(sst->get_filename()).filename().string()});
+        }
+        for (const SST<K, V>* sst : job.overlapping) {
+            changes.push_back({ManifestChangeType::REMOVE, target_level,
+                               std::filesystem::path(sst->get_filename()).filename().string()});
+        }
+        for (const auto& sst : outputs) {
+            merged = merged && sst->sync_file();
+        }
+        merged = merged && manifest->log_edit(changes);
+    }
+    if (!merged) {
+        outputs.clear();
+        for (const std::string& filename : output_filenames) {
+            SST<K, V>::remove_file(db_directory + "/" + filename);
+        }
+        std::cerr << "Failed to compct level " << job.level << std::endl;
+        lock.lock();
+        return false;
+    }
+    for (const auto& sst : outputs) {
+        sst->set_read_mode(sst_read_mode);
+    }
 
-    // existence check
-    size_t target_level = level + 1;
+    lock.lock();
+    std::vector<std::unique_ptr<SST<K, V>>> replaced;
+    auto take_out = [&replaced](std::vector<std::unique_ptr<SST<K, V>>>& level,
+                                const std::vector<SST<K, V>*>& ssts) {
+        for (SST<K, V>* sst : ssts) {
+            auto it = std::find_if(level.begin(), level.end(), [sst](const auto& p) { return p.get() == sst; });
+            replaced.push_back(std::move(*it));
+            level.erase(it);
+        }
+    };
+    take_out(levels[job.level], job.inputs);
     while (levels.size() <= target_level) {
         levels.push_back({});
     }
+    take_out(levels[target_level], job.overlapping);
+
+    std::vector<SST<K, V>*> installed;
+    for (auto& sst : outputs) {
+        compaction_bytes_written += sst->get_file_size();
+        sst->set_run_id(run_id);
+        installed.push_back(sst.get());
+        levels[target_level].push_back(std::move(sst));
+    }
+    if (compaction_strategy->is_leveled(target_level, levels.size())) {
+        sort_level_by_key(target_level);
+    }
+    std::cout << "Successfull compacted level " << job.level << " to level " << target_level << std::endl;
+
+    // the old files' pages leave the pool now rather than when the clock
+    // reaches them, and the new leaves holding the same keys can take their place
+    std::vector<LeafHeat<K>> heat;
+    for (auto& sst : replaced) {
+        std::vector<LeafHeat<K>> dropped = sst->drop_cached_pages();
+        heat.insert(heat.end(), dropped.begin(), dropped.end());
+    }
+    std::vector<std::pair<const SST<K, V>*, size_t>> warm_up_pages;
+    if (compaction_warm_up && sst_read_mode == SSTReadMode::BUFFER_POOL && !heat.empty()) {
+        warm_up_pages = pick_warm_up_pages(installed, heat);
+    }
 
-    // new filename for merged sst
-    std::string merged_filename = generate_sst_filename(target_level);
-    std::string merged_path = db_directory + "/" + merged_filename;
+    // an open iterator may still read the old files; the last one to close deletes them
+    if (open_iterators > 0) {
+        for (auto& sst : replaced) {
+            retired_ssts.push_back(std::move(sst));
+        }
+        replaced.clear();
+    }
+
+    // cleanup old SST files; no reader can reach them any more
+    lock.unlock();
+    for (auto& sst : replaced) {
+        SST<K, V>::remove_file(sst->get_filename());
+        sst.reset();
+    }
+
+    // The pages are read without state_mutex so lookups are not held up. The
+    // outputs are pinned as an iterator would pin them: if they were replaced
+    // meanwhile they would be retired rather than freed.
+    if (!warm_up_pages.empty()) {
+        {
+            std::lock_guard<std::mutex> pin(state_mutex);
+            open_iterators++;
+        }
+        size_t loaded = 0;
+        for (const auto& [sst, offset] : warm_up_pages) {
+            if (sst->preload_page(offset)) {
+                loaded++;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> count(state_mutex);
+            warm_up_page_count += loaded;
+        }
+        release_iterator();
+    }
+    lock.lock();
+    return true;
+}
 
-    // merge logic
-    std::unique_ptr<SST<K, V>> merged_sst;
-    if (SST<K, V>::create_from_merge(merged_path, sst1.get(), sst2.get(), target_level, merged_sst)) {
-        levels[target_level].push_back(std::move(merged_sst));
-        std::cout << "Successfull compacted level " << level << " to level " << target_level << std::endl;
+template<typename K, typename V>
+bool Database<K, V>::key_ranges_disjoint(std::vector<SST<K, V>*> ssts) {
+    std::sort(ssts.begin(), ssts.end(), [](const SST<K, V>* a, const SST<K, V>* b) {
+        return a->get_min_key() < b->get_min_key();
+    });
+    for (size_t i = 1; i < ssts.size(); i++) {
+        if (!(ssts[i - 1]->get_max_key() < ssts[i]->get_min_key())) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        // cleanup old SST files
-        std::filesystem::remove(sst1->get_filename());
-        std::filesystem::remove(sst2->get_filename());
+// Called with state_mutex held. The bloom filter rate for a new SST in `level`
+// that will hold `incoming_entries`: the fixed rate, or with a filter budget
+// the level's share under Monkey's allocation for the tree as it will be
+template<typename K, typename V>
+double Database<K, V>::level_false_positive_rate(size_t level, size_t incoming_entries) const {
+    if (bloom_bits_per_entry <= 0) {
+        return bloom_filter_fpr;
+    }
+    std::vector<size_t> level_entries(std::max(levels.size(), level + 1), 0);
+    for (size_t l = 0; l < levels.size(); l++) {
+        for (const auto& sst : levels[l]) {
+            level_entries[l] += sst->get_entry_count();
+        }
+    }
+    level_entries[level] += std::max<size_t>(incoming_entries, 1);
+    return monkey_false_positive_rates(level_entries, bloom_bits_per_entry)[level];
+}
 
-        if (levels[target_level].size() >= 2) {
-            compact_level(target_level);
+// Called with state_mutex held. Picks the leaves of `outputs` that hold the keys
+// of the cached input leaves in `heat`, most read first, up to as many pages as
+// the inputs had cached and at most half the pool. Index pages need no warm-up:
+// lookups find their leaf through the fence keys kept in memory.
+template<typename K, typename V>
+std::vector<std::pair<const SST<K, V>*, size_t>> Database<K, V>::pick_warm_up_pages(
+    const std::vector<SST<K, V>*>& outputs, const std::vector<LeafHeat<K>>& heat) const {
+    struct Candidate {
+        size_t hits;
+        SST<K, V>* sst;
+        size_t offset;
+    };
+    std::vector<Candidate> candidates;
+    for (SST<K, V>* sst : outputs) {
+        for (const auto& [offset, hits] : sst->map_leaf_heat(heat)) {
+            candidates.push_back({hits, sst, offset});
         }
-    } else {
-        std::cerr << "Failed to compct level " << level << std::endl;
-        // Put SSTs back if compaction failed
-        levels[level].insert(levels[level].begin(), std::move(sst1));
-        levels[level].insert(levels[level].begin() + 1, std::move(sst2));
     }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.hits > b.hits;
+    });
+
+    size_t budget = std::min(heat.size(), buffer_pool->get_max_pages() / 2);
+    std::vector<std::pair<const SST<K, V>*, size_t>> pages;
+    for (size_t i = 0; i < candidates.size() && pages.size() < budget; i++) {
+        pages.emplace_back(candidates[i].sst, candidates[i].offset);
+    }
+    return pages;
+}
+
+// Called with state_mutex held. True if no SST outside the job, in the target
+// level or below it, holds keys in the job's range, so a tombstone written by
+// the job no longer hides anything. Files added to the job's own level while it
+// runs are newer than its inputs, and only this thread changes deeper levels.
+template<typename K, typename V>
+bool Database<K, V>::is_bottommost_compaction(const CompactionJob<K, V>& job) const {
+    if (job.inputs.empty()) {
+        return false;
+    }
+    K min_key = job.inputs[0]->get_min_key();
+    K max_key = job.inputs[0]->get_max_key();
+    for (const auto* ssts : {&job.inputs, &job.overlapping}) {
+        for (const SST<K, V>* sst : *ssts) {
+            min_key = std::min(min_key, sst->get_min_key());
+            max_key = std::max(max_key, sst->get_max_key());
+        }
+    }
+
+    for (size_t level = job.level + 1; level < levels.size(); level++) {
+        for (const auto& sst : levels[level]) {
+            bool in_job = std::find(job.overlapping.begin(), job.overlapping.end(), sst.get()) != job.overlapping.end();
+            if (!in_job && !(sst->get_max_key() < min_key) && !(max_key < sst->get_min_key())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Called with state_mutex held. Moves the inputs to the next level with one
+// manifest edit; the files themselves are neither read nor rewritten, and
+// they become one run there, in key order.
+template<typename K, typename V>
+bool Database<K, V>::move_compaction_inputs(const CompactionJob<K, V>& job, std::unique_lock<std::mutex>& lock) {
+    size_t target_level = job.level + 1;
+    std::vector<SST<K, V>*> moved = job.inputs;
+    std::sort(moved.begin(), moved.end(), [](const SST<K, V>* a, const SST<K, V>* b) {
+        return a->get_min_key() < b->get_min_key();
+    });
+
+    uint64_t run_id = next_run_id++;
+    std::vector<ManifestChange> changes;
+    for (const SST<K, V>* sst : moved) {
+        std::string filename = std::filesystem::path(sst->get_filename()).filename().string();
+        changes.push_back({ManifestChangeType::REMOVE, job.level, filename});
+        changes.push_back({ManifestChangeType::ADD, target_level, filename, run_id});
+    }
+
+    lock.unlock();
+    bool logged = manifest->log_edit(changes);
+    lock.lock();
+    if (!logged) {
+        std::cerr << "Failed to move level " << job.level << " to level " << target_level << std::endl;
+        return false;
+    }
+
+    while (levels.size() <= target_level) {
+        levels.push_back({});
+    }
+    for (SST<K, V>* sst : moved) {
+        auto& level = levels[job.level];
+        auto it = std::find_if(level.begin(), level.end(), [sst](const auto& p) { return p.get() == sst; });
+        std::unique_ptr<SST<K, V>> owned = std::move(*it);
+        level.erase(it);
+        owned->set_level(target_level);
+        owned->set_run_id(run_id);
+        levels[target_level].push_back(std::move(owned));
+    }
+    if (compaction_strategy->is_leveled(target_level, levels.size())) {
+        sort_level_by_key(target_level);
+    }
+    trivial_move_count++;
+    return true;
+}
+
+// Puts leveled levels in key order and gives every SST its run. In other
+// levels each file takes the run the manifest recorded for it; files added
+// before run ids were recorded fall back to runs rebuilt from consecutive
+// files that do not overlap, which the manifest keeps in the order added.
+template<typename K, typename V>
+bool Database<K, V>::arrange_loaded_levels() {
+    auto recorded_run = [this](const SST<K, V>& sst) {
+        return manifest->get_run_id(std::filesystem::path(sst.get_filename()).filename().string());
+    };
+    // new runs must not reuse a recorded id
+    for (const auto& files : levels) {
+        for (const auto& sst : files) {
+            next_run_id = std::max(next_run_id, recorded_run(*sst) + 1);
+        }
+    }
+
+    for (size_t level = 0; level < levels.size(); level++) {
+        auto& files = levels[level];
+        if (compaction_strategy->is_leveled(level, levels.size())) {
+            sort_level_by_key(level);
+            for (size_t i = 1; i < files.size(); i++) {
+                if (!(files[i - 1]->get_max_key() < files[i]->get_min_key())) {
+                    std::cerr << "Level " << level << " has overlapping SSTs, which the "
+                              << compaction_strategy->get_name() << " compaction strategy does not allow" << std::endl;
+                    return false;
+                }
+            }
+            for (auto& sst : files) {
+                sst->set_run_id(next_run_id);
+            }
+            next_run_id++;
+            continue;
+        }
+
+        bool previous_unrecorded = false;
+        for (size_t i = 0; i < files.size(); i++) {
+            uint64_t run_id = recorded_run(*files[i]);
+            if (run_id != 0) {
+                files[i]->set_run_id(run_id);
+                previous_unrecorded = false;
+                continue;
+            }
+            bool extends_run = level > 0 && previous_unrecorded &&
+                               files[i - 1]->get_max_key() < files[i]->get_min_key();
+            files[i]->set_run_id(extends_run ? next_run_id - 1 : next_run_id++);
+            previous_unrecorded = true;
+        }
+    }
+    return true;
+}
+
+template<typename K, typename V>
+void Database<K, V>::sort_level_by_key(size_t level) {
+    std::sort(levels[level].begin(), levels[level].end(), [](const auto& a, const auto& b) {
+        return a->get_min_key() < b->get_min_key();
+    });
+}
+
+// Binary search on the SSTs' largest keys; SSTs of a leveled level do not overlap
+template<typename K, typename V>
+const SST<K, V>* Database<K, V>::find_sst_in_level(size_t level, const K& key) const {
+    const auto& files = levels[level];
+    auto it = std::lower_bound(files.begin(), files.end(), key, [](const auto& sst, const K& k) {
+        return sst->get_max_key() < k;
+    });
+    if (it == files.end() || key < (*it)->get_min_key()) {
+        return nullptr;
+    }
+    return it->get();
 }
 
 template<typename K, typename V>
@@ -363,6 +1446,7 @@ bool Database<K, V>::is_database_open() const {
 
 template<typename K, typename V>
 size_t Database<K, V>::get_sst_count() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
     size_t count = 0;
     for (const auto& level : levels) {
         count += level.size();
@@ -371,6 +1455,24 @@ size_t Database<K, V>::get_sst_count() const {
     return count;
 }
 
+template<typename K, typename V>
+size_t Database<K, V>::get_level_count() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return levels.size();
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_level_sst_count(size_t level) const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return level < levels.size() ? levels[level].size() : 0;
+}
+
+template<typename K, typename V>
+size_t Database<K, V>::get_level_run_count(size_t level) const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return level < levels.size() ? CompactionStrategy<K, V>::run_count(levels[level]) : 0;
+}
+
 template<typename K, typename V>
 size_t Database<K, V>::get_memtable_size() const {
     return current_memtable ? current_memtable->size() : 0;
@@ -383,6 +1485,9 @@ void Database<K, V>::print_stats() const {
     std::cout << "Status: " << (is_open ? "Open" : "Closed") << std::endl;
     std::cout << "Memtable size: " << get_memtable_size() << "/" << memtable_size << std::endl;
     std::cout << "SST files: " << get_sst_count() << std::endl;
+    std::cout << "Compaction: " << compaction_strategy->get_name() << ", " << get_compaction_bytes()
+              << " bytes of I/O, write amplification " << get_write_amplification() << ", "
+              << get_trivial_move_count() << " trivial moves" << std::endl;
     std::cout << "Directory: " << db_directory << std::endl;
 }
 
@@ -6,9 +6,24 @@
 #include <memory>
 #include <filesystem>
 #include <limits>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include "../memtable/memtable.h"
 #include "../buffer/buffer_pool.h"
+#include "../cache/row_cache.h"
 #include "../storage/sst.h"
+#include "../storage/manifest.h"
+#include "../storage/rate_limiter.h"
+#include "../wal/wal.h"
+#include "compaction_strategy.h"
+#include "database_iterator.h"
+
+// Order in which a limited scan walks its range
+enum class ScanDirection {
+    FORWARD,
+    REVERSE
+};
 
 template<typename K, typename V>
 class Database {
@@ -17,19 +32,116 @@ private:
     std::string db_directory;
     size_t memtable_size;
     std::unique_ptr<RedBlackTree<K, V>> current_memtable;
-    std::vector<std::vector<std::unique_ptr<SST<K, V>>>> levels;
+    // Full memtable waiting for the background flush; still visible to reads
+    std::unique_ptr<RedBlackTree<K, V>> immutable_memtable;
+    // Flushed memtable kept around so its arena blocks are reused
+    std::unique_ptr<RedBlackTree<K, V>> spare_memtable;
+    // Level 0 holds flushed memtables oldest first; how deeper levels are
+    // arranged is up to the compaction strategy
+    SSTLevels<K, V> levels;
+    // Durable record of which SST files make up each level, in order
+    std::unique_ptr<Manifest> manifest;
     std::unique_ptr<BufferPool> buffer_pool;
     bool is_open;
     double bloom_filter_fpr;
+    // Average bloom filter bits per entry shared out across levels; 0 gives
+    // every SST bloom_filter_fpr
+    double bloom_bits_per_entry;
+    SSTReadMode sst_read_mode;
+    // Values found in SSTs, checked after the memtable; null when disabled.
+    // Writes erase their key once it is in the memtable. Compaction keeps
+    // every key's newest version, so replacing SSTs never makes a row stale.
+    std::unique_ptr<RowCache<K, V>> row_cache;
+
+    static constexpr V TOMBSTONE = tombstone_value<V>();
+
+    // Background flush state. state_mutex guards immutable_memtable and levels;
+    // current_memtable belongs to the caller's thread. The buffer pool latches
+    // its own shards.
+    mutable std::mutex state_mutex;
+    std::condition_variable flush_cv;
+    std::thread flush_thread;
+    bool stop_flush_thread;
+    bool flush_in_progress;
+    // Set when an SST could not be written. The immutable memtable and its
+    // WAL segment are kept, and writes that need a flush fail until reopen.
+    bool flush_failed;
+
+    // Background compaction state, also guarded by state_mutex. Flushes
+    // request compaction; the worker drops the request once no level is over
+    // its limit, or after a failed compaction.
+    std::condition_variable compaction_cv;
+    std::thread compaction_thread;
+    bool stop_compaction_thread;
+    bool compaction_in_progress;
+    bool compaction_requested;
+    // Paces compaction reads and writes so foreground I/O is not starved
+    RateLimiter compaction_rate_limiter;
+
+    std::unique_ptr<CompactionStrategy<K, V>> compaction_strategy;
+    uint64_t next_run_id;
+
+    // Bytes written by flushes and by compactions, for write amplification
+    size_t flush_bytes_written;
+    size_t compaction_bytes_written;
+    // Compactions done by moving their inputs down a level without rewriting them
+    size_t trivial_move_count;
+    // Whether a compaction preloads the leaves of its output that replace the
+    // most read cached leaves of its inputs, and how many pages it has loaded
+    bool compaction_warm_up;
+    size_t warm_up_page_count;
 
-    static constexpr V TOMBSTONE = std::numeric_limits<V>::min();
+    // Open iterators, and the memtables and SSTs retired while one was open;
+    // those are freed, and the SST files deleted, when the last iterator closes
+    size_t open_iterators;
+    std::vector<std::unique_ptr<RedBlackTree<K, V>>> retired_memtables;
+    std::vector<std::unique_ptr<SST<K, V>>> retired_ssts;
 
-    void load_existing_ssts();
+    // Write-ahead log; each memtable owns one segment, which is deleted once
+    // that memtable's SST is on disk. Segment 0 means "no segment".
+    std::unique_ptr<WriteAheadLog<K, V>> wal;
+    bool wal_enabled;
+    WalSyncPolicy wal_sync_policy;
+    size_t wal_sync_interval_ms;
+    uint64_t immutable_wal_segment;
+
+    bool replay_wal(uint64_t& last_sequence);
+    bool open_wal(uint64_t last_sequence);
+    void close_wal();
+    void remove_wal_segments_up_to(uint64_t segment);
+    std::unique_ptr<SST<K, V>> write_level0_sst(const std::vector<std::pair<K, V>>& sorted_data,
+                                                double false_positive_rate, uint64_t run_id,
+                                                std::string& sst_filename);
+    double level_false_positive_rate(size_t level, size_t incoming_entries) const;
+    bool commit_write_group(std::vector<std::pair<K, V>>& group);
+
+    void start_flush_thread();
+    void stop_flush_thread_and_join();
+    void flush_thread_loop();
+    bool schedule_memtable_flush();
+    bool wait_for_flush();
+    void write_immutable_memtable();
+
+    void start_compaction_thread();
+    void stop_compaction_thread_and_join();
+    void compaction_thread_loop();
+    void wait_for_compaction();
+
+    bool load_existing_ssts();
+    bool load_ssts_without_manifest();
     std::string generate_sst_filename(size_t level);
     void ensure_directory_exists();
 
-    void compact_level(size_t level);
-    void try_compaction();
+    bool run_compaction(const CompactionJob<K, V>& job, std::unique_lock<std::mutex>& lock);
+    bool move_compaction_inputs(const CompactionJob<K, V>& job, std::unique_lock<std::mutex>& lock);
+    static bool key_ranges_disjoint(std::vector<SST<K, V>*> ssts);
+    bool is_bottommost_compaction(const CompactionJob<K, V>& job) const;
+    void release_iterator();
+    std::vector<std::pair<const SST<K, V>*, size_t>> pick_warm_up_pages(const std::vector<SST<K, V>*>& outputs,
+                                                                       const std::vector<LeafHeat<K>>& heat) const;
+    bool arrange_loaded_levels();
+    void sort_level_by_key(size_t level);
+    const SST<K, V>* find_sst_in_level(size_t level, const K& key) const;
 
 public:
     Database(const std::string& name, size_t memtable_max_size = 1000, double false_positive_rate = 0.01, size_t buffer_pool_max_pages = 128);
@@ -40,20 +152,83 @@ public:
 
     bool put(const K& key, const V& value);
     bool remove(const K& key);
+    // Logs the whole batch as one WAL commit group, then applies it to the memtable
+    bool write_batch(const std::vector<std::pair<K, V>>& batch);
+
+    // WAL configuration, takes effect on the next open()
+    void set_wal_options(bool enabled, WalSyncPolicy policy = WalSyncPolicy::INTERVAL,
+                         size_t sync_interval_ms = 100);
+    bool sync_wal();
+
+    // How SST pages are read; takes effect on the next open()
+    void set_read_mode(SSTReadMode mode);
+    // Caches up to `entries` key/value pairs read from SSTs; 0 (default) turns
+    // the row cache off. Call before open(); returns false while open.
+    bool set_row_cache_capacity(size_t entries);
+
+    // How SSTs are merged (leveled by default); call before open() (returns
+    // false while open), and keep using the strategy a database was written with
+    bool set_compaction_strategy(std::unique_ptr<CompactionStrategy<K, V>> strategy);
+    const CompactionStrategy<K, V>& get_compaction_strategy() const;
+    // Gives bloom filters an average of `bits_per_entry` bits per entry, shared
+    // out so that small levels get lower false positive rates than large ones
+    // (Monkey). Applies to SSTs written from now on; 0 (default) gives every
+    // SST the false_positive_rate passed to the constructor.
+    void set_bloom_filter_budget(double bits_per_entry);
+    // Caps background compaction I/O in bytes per second (0 = unlimited); takes effect immediately
+    void set_compaction_rate_limit(size_t bytes_per_second);
+    // Bytes read and written by compactions so far
+    size_t get_compaction_bytes() const;
+    // Bytes of SSTs written by flushes and by compactions since open()
+    size_t get_flush_bytes_written() const;
+    size_t get_compaction_bytes_written() const;
+    // All SST bytes written per byte flushed from memtables
+    double get_write_amplification() const;
+    // Compactions since open() that moved SSTs down a level as metadata only
+    size_t get_trivial_move_count() const;
+    // Lookups answered by the row cache, and lookups that missed it
+    size_t get_row_cache_hit_count() const;
+    size_t get_row_cache_miss_count() const;
+    // Turns compaction warm-up of the buffer pool on (default) or off
+    void set_compaction_warm_up(bool enabled);
+    // Pages preloaded into the buffer pool by compaction warm-up since open()
+    size_t get_warm_up_page_count() const;
 
     bool get(const K& key, V& value, SearchMode mode = SearchMode::B_TREE_SEARCH);
+    // Looks up all of `keys` in one pass; where the returned flag is set,
+    // values[i] holds the value of keys[i]. The keys are sorted and probed in
+    // order: each memtable is searched once per distinct key, and each SST
+    // checks its bloom filter for the whole batch and reads a leaf once for
+    // all the keys that land in it.
+    std::vector<bool> multi_get(const std::vector<K>& keys, std::vector<V>& values);
 
+    // Copies the live entries with keys in [start_key, end_key] into an array
+    // the caller must delete[]. Reads through new_iterator(); SSTs are entered
+    // through their fence keys whatever the search mode.
     std::pair<K, V>* scan(const K& start_key, const K& end_key, size_t& result_size,
         SearchMode mode = SearchMode::B_TREE_SEARCH);
+    // At most `limit` entries of [start_key, end_key]: the first ones going up
+    // from start_key, or with REVERSE the last ones going down from end_key, in
+    // that order. Stops reading SST leaves once the limit is reached.
+    std::pair<K, V>* scan(const K& start_key, const K& end_key, size_t& result_size, size_t limit,
+        ScanDirection direction = ScanDirection::FORWARD);
+    // Iterator over every live entry in key order; position it with seek() or
+    // seek_to_first(). Destroy it before close().
+    std::unique_ptr<DatabaseIterator<K, V>> new_iterator();
 
     bool is_database_open() const;
     size_t get_sst_count() const;
+    size_t get_level_count() const;
+    size_t get_level_sst_count(size_t level) const;
+    size_t get_level_run_count(size_t level) const;
     size_t get_memtable_size() const;
 
     void print_stats() const;
 
-    // Public method for testing SST flushing
-    void flush_memtable_to_sst();
+    // Hands the memtable to the background flush and waits until its SST
+    // is installed and background compaction has caught up. Returns false if
+    // a flush failed; the unflushed keys stay in the WAL for the next open().
+    bool flush_memtable_to_sst();
 };
 
 #include "database.cpp"
@@ -0,0 +1,276 @@
+#ifndef DATABASE_ITERATOR_CPP
+#define DATABASE_ITERATOR_CPP
+
+#include "database_iterator.h"
+#include <algorithm>
+
+template<typename K, typename V>
+DatabaseIterator<K, V>::DatabaseIterator(const std::vector<const RedBlackTree<K, V>*>& memtables,
+                                         std::vector<Run> runs, std::function<void()> release)
+    : sources(std::make_unique<Source[]>(memtables.size() + runs.size())),
+      source_count(memtables.size() + runs.size()), forward(true), on_destroy(std::move(release)),
+      current_key(), error(false) {
+    size_t i = 0;
+    for (const auto* memtable : memtables) {
+        sources[i++].memtable = memtable;
+    }
+    for (auto& run : runs) {
+        sources[i++].run = std::move(run);
+    }
+    heap.reserve(source_count);
+}
+
+template<typename K, typename V>
+DatabaseIterator<K, V>::~DatabaseIterator() {
+    if (on_destroy) {
+        on_destroy();
+    }
+}
+
+template<typename K, typename V>
+bool DatabaseIterator<K, V>::source_valid(const Source& source) const {
+    return source.memtable ? source.node != nullptr : source.cursor.valid();
+}
+
+template<typename K, typename V>
+const K& DatabaseIterator<K, V>::source_key(const Source& source) const {
+    return source.memtable ? source.node->key : source.cursor.key();
+}
+
+template<typename K, typename V>
+const V& DatabaseIterator<K, V>::source_value(const Source& source) const {
+    return source.memtable ? source.node->value : source.cursor.value();
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::source_next(Source& source) {
+    if (source.memtable) {
+        source.node = source.memtable->successor(source.node);
+        return;
+    }
+    source.cursor.next();
+    skip_finished_ssts(source);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::source_prev(Source& source) {
+    if (source.memtable) {
+        source.node = source.memtable->predecessor(source.node);
+        return;
+    }
+    source.cursor.prev();
+    skip_finished_ssts(source);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::source_seek(Source& source, const K* key) {
+    if (source.memtable) {
+        if (key) {
+            source.node = source.memtable->lower_bound(*key);
+        } else {
+            source.node = source.memtable->size() > 0 ? source.memtable->lower_bound(source.memtable->get_min_key())
+                                                      : nullptr;
+        }
+        return;
+    }
+
+    // the first SST of the run whose keys reach `key`
+    size_t position = 0;
+    if (key) {
+        position = static_cast<size_t>(std::partition_point(source.run.begin(), source.run.end(),
+            [key](const SST<K, V>* sst) { return sst->get_max_key() < *key; }) - source.run.begin());
+    }
+    source.run_position = position;
+    if (position == source.run.size()) {
+        source.cursor.reset(nullptr);
+        return;
+    }
+    source.cursor.reset(source.run[position]);
+    if (key) {
+        source.cursor.seek(*key);
+    } else {
+        source.cursor.seek_to_first();
+    }
+    skip_finished_ssts(source);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::source_seek_for_prev(Source& source, const K* key) {
+    if (source.memtable) {
+        if (key) {
+            source.node = source.memtable->floor(*key);
+        } else {
+            source.node = source.memtable->size() > 0 ? source.memtable->floor(source.memtable->get_max_key())
+                                                      : nullptr;
+        }
+        return;
+    }
+
+    // the last SST of the run whose keys start at or before `key`
+    size_t position = source.run.size();
+    if (key) {
+        position = static_cast<size_t>(std::partition_point(source.run.begin(), source.run.end(),
+            [key](const SST<K, V>* sst) { return !(*key < sst->get_min_key()); }) - source.run.begin());
+    }
+    if (position == 0) {
+        source.cursor.reset(nullptr);
+        return;
+    }
+    source.run_position = position - 1;
+    source.cursor.reset(source.run[source.run_position]);
+    if (key) {
+        source.cursor.seek_for_prev(*key);
+    } else {
+        source.cursor.seek_to_last();
+    }
+    skip_finished_ssts(source);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::skip_finished_ssts(Source& source) {
+    while (!source.cursor.valid()) {
+        if (source.cursor.has_error()) {
+            error = true;
+        }
+        bool has_more = forward ? source.run_position + 1 < source.run.size() : source.run_position > 0;
+        if (!has_more) {
+            source.cursor.reset(nullptr);
+            return;
+        }
+        source.run_position = forward ? source.run_position + 1 : source.run_position - 1;
+        source.cursor.reset(source.run[source.run_position]);
+        if (forward) {
+            source.cursor.seek_to_first();
+        } else {
+            source.cursor.seek_to_last();
+        }
+    }
+}
+
+// Heap order: true if source `a` comes after source `b` in the current direction
+template<typename K, typename V>
+bool DatabaseIterator<K, V>::comes_after(size_t a, size_t b) const {
+    const K& key_a = source_key(sources[a]);
+    const K& key_b = source_key(sources[b]);
+    if (forward ? key_b < key_a : key_a < key_b) {
+        return true;
+    }
+    return !(key_a < key_b) && !(key_b < key_a) && b < a;
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::seek_all(const K* key, bool forwards) {
+    forward = forwards;
+    heap.clear();
+    for (size_t i = 0; i < source_count; i++) {
+        if (forward) {
+            source_seek(sources[i], key);
+        } else {
+            source_seek_for_prev(sources[i], key);
+        }
+        if (source_valid(sources[i])) {
+            heap.push_back(i);
+        }
+    }
+    auto order = [this](size_t a, size_t b) { return comes_after(a, b); };
+    std::make_heap(heap.begin(), heap.end(), order);
+    skip_tombstones();
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::skip_key(const K& key) {
+    auto order = [this](size_t a, size_t b) { return comes_after(a, b); };
+    // every key in the heap is on the far side of `key` or equal to it
+    while (!heap.empty() && !(forward ? key < source_key(sources[heap.front()])
+                                      : source_key(sources[heap.front()]) < key)) {
+        std::pop_heap(heap.begin(), heap.end(), order);
+        size_t index = heap.back();
+        if (forward) {
+            source_next(sources[index]);
+        } else {
+            source_prev(sources[index]);
+        }
+        if (source_valid(sources[index])) {
+            std::push_heap(heap.begin(), heap.end(), order);
+        } else {
+            heap.pop_back();
+        }
+    }
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::skip_tombstones() {
+    while (!heap.empty() && source_value(sources[heap.front()]) == tombstone_value<V>()) {
+        current_key = source_key(sources[heap.front()]);
+        skip_key(current_key);
+    }
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::seek_to_first() {
+    seek_all(nullptr, true);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::seek_to_last() {
+    seek_all(nullptr, false);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::seek(const K& key) {
+    seek_all(&key, true);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::seek_for_prev(const K& key) {
+    seek_all(&key, false);
+}
+
+template<typename K, typename V>
+bool DatabaseIterator<K, V>::valid() const {
+    return !heap.empty();
+}
+
+template<typename K, typename V>
+const K& DatabaseIterator<K, V>::key() const {
+    return source_key(sources[heap.front()]);
+}
+
+template<typename K, typename V>
+const V& DatabaseIterator<K, V>::value() const {
+    return source_value(sources[heap.front()]);
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::next() {
+    if (heap.empty()) {
+        return;
+    }
+    current_key = key();
+    if (!forward) {
+        // turn around: every source onto the first key not less than this one
+        seek_all(&current_key, true);
+    }
+    skip_key(current_key);
+    skip_tombstones();
+}
+
+template<typename K, typename V>
+void DatabaseIterator<K, V>::prev() {
+    if (heap.empty()) {
+        return;
+    }
+    current_key = key();
+    if (forward) {
+        seek_all(&current_key, false);
+    }
+    skip_key(current_key);
+    skip_tombstones();
+}
+
+template<typename K, typename V>
+bool DatabaseIterator<K, V>::has_error() const {
+    return error;
+}
+
+#endif
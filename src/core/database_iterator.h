@@ -0,0 +1,94 @@
+#ifndef DATABASE_ITERATOR_H
+#define DATABASE_ITERATOR_H
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include "../memtable/memtable.h"
+#include "../storage/sst.h"
+#include "../storage/sst_cursor.h"
+
+// Reads a database in key order, forwards or backwards, by merging its
+// memtables and SSTs on the fly. Each source keeps one cursor: a memtable node, or an entry of the SST being
+// read within one sorted run. A heap orders the cursors by key with the
+// youngest source first on ties, so the newest version of a key hides older
+// ones, and keys whose newest version is a tombstone are skipped. Nothing is
+// copied per key, and an SST leaf is read only when a cursor reaches it.
+// Changing direction re-seeks every source around the current key.
+//
+// Made by Database::new_iterator(). The memtables and SSTs it reads stay alive
+// until it is destroyed, which must happen before the database is closed.
+// Puts made while it is open may or may not be seen.
+template<typename K, typename V>
+class DatabaseIterator {
+public:
+    // SSTs of one sorted run, ordered by key
+    using Run = std::vector<const SST<K, V>*>;
+
+private:
+    struct Source {
+        const RedBlackTree<K, V>* memtable = nullptr;
+        const RedBlackNode<K, V>* node = nullptr;
+        Run run;
+        size_t run_position = 0;
+        SSTCursor<K, V> cursor;
+    };
+
+    // Youngest first: memtables, then runs from level 0 down
+    std::unique_ptr<Source[]> sources;
+    size_t source_count;
+    // Indexes of the sources that are not exhausted, as a heap on (key, index);
+    // the key order is reversed while moving backwards
+    std::vector<size_t> heap;
+    bool forward;
+    std::function<void()> on_destroy;
+    K current_key;
+    bool error;
+
+    bool source_valid(const Source& source) const;
+    const K& source_key(const Source& source) const;
+    const V& source_value(const Source& source) const;
+    void source_next(Source& source);
+    void source_prev(Source& source);
+    // Positions the source on its first key not less than `key`, or its first key if null
+    void source_seek(Source& source, const K* key);
+    // Positions the source on its last key not greater than `key`, or its last key if null
+    void source_seek_for_prev(Source& source, const K* key);
+    // Moves a run past SSTs it has finished, onto the next one's first key or,
+    // backwards, the previous one's last key
+    void skip_finished_ssts(Source& source);
+
+    bool comes_after(size_t a, size_t b) const;
+    void seek_all(const K* key, bool forwards);
+    // Steps every source on `key` past it
+    void skip_key(const K& key);
+    void skip_tombstones();
+
+public:
+    DatabaseIterator(const std::vector<const RedBlackTree<K, V>*>& memtables, std::vector<Run> runs,
+                     std::function<void()> release);
+    ~DatabaseIterator();
+
+    DatabaseIterator(const DatabaseIterator&) = delete;
+    DatabaseIterator& operator=(const DatabaseIterator&) = delete;
+
+    void seek_to_first();
+    void seek_to_last();
+    // Moves to the first live key not less than `key`
+    void seek(const K& key);
+    // Moves to the last live key not greater than `key`
+    void seek_for_prev(const K& key);
+
+    bool valid() const;
+    const K& key() const;
+    const V& value() const;
+    void next();
+    void prev();
+
+    // True if an SST read failed; the entries of that SST are then missing
+    bool has_error() const;
+};
+
+#include "database_iterator.cpp"
+
+#endif
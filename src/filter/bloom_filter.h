@@ -79,4 +79,56 @@ public:
     size_t num_hash_functions;
 };
 
+// Monkey's filter allocation: given the entries in each level and an average
+// budget of bits per entry, picks the false positive rate of every level so
+// that the sum of the rates (the expected I/Os of a lookup that finds
+// nothing) is smallest. The optimum makes each rate proportional to the
+// level's size, so small levels get tight filters and the largest level a
+// loose one. A level whose rate would reach 1 gets no useful filter and its
+// bits go to the others.
+inline std::vector<double> monkey_false_positive_rates(const std::vector<size_t>& level_entries,
+                                                       double bits_per_entry) {
+    const double ln2_squared = std::log(2) * std::log(2);
+    std::vector<double> rates(level_entries.size(), 1.0);
+    std::vector<bool> filtered(level_entries.size());
+    double total_entries = 0;
+    for (size_t i = 0; i < level_entries.size(); i++) {
+        filtered[i] = level_entries[i] > 0;
+        total_entries += static_cast<double>(level_entries[i]);
+    }
+    const double budget_bits = bits_per_entry * total_entries;
+
+    // rate_i = c * entries_i; the budget fixes c:
+    // sum entries_i * ln(1 / rate_i) = budget_bits * ln(2)^2
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        double entries = 0;
+        double entries_log_entries = 0;
+        for (size_t i = 0; i < level_entries.size(); i++) {
+            if (filtered[i]) {
+                double n = static_cast<double>(level_entries[i]);
+                entries += n;
+                entries_log_entries += n * std::log(n);
+            }
+        }
+        if (entries == 0) {
+            break;
+        }
+        double log_c = -(budget_bits * ln2_squared + entries_log_entries) / entries;
+        for (size_t i = 0; i < level_entries.size(); i++) {
+            if (!filtered[i]) {
+                continue;
+            }
+            rates[i] = std::exp(log_c) * static_cast<double>(level_entries[i]);
+            if (rates[i] >= 1.0) {
+                rates[i] = 1.0;
+                filtered[i] = false;
+                changed = true;
+            }
+        }
+    }
+    return rates;
+}
+
 #endif
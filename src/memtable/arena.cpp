@@ -0,0 +1,66 @@
+#ifndef ARENA_CPP
+#define ARENA_CPP
+
+#include "arena.h"
+#include <stdexcept>
+
+Arena::Arena(size_t block_bytes)
+    : block_size(block_bytes == 0 ? 1 : block_bytes), current_block(0), block_offset(0), bytes_allocated(0) {
+}
+
+void Arena::advance_block() {
+    // Reuse a block left over from before the last reset if there is one
+    if (!blocks.empty() && current_block + 1 < blocks.size()) {
+        current_block++;
+    } else {
+        blocks.push_back(std::make_unique<char[]>(block_size));
+        current_block = blocks.size() - 1;
+    }
+    block_offset = 0;
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    if (bytes + alignment > block_size) {
+        throw std::length_error("Arena allocation larger than block size");
+    }
+
+    if (blocks.empty()) {
+        advance_block();
+    }
+
+    size_t padding = (alignment - (block_offset % alignment)) % alignment;
+    if (block_offset + padding + bytes > block_size) {
+        advance_block();
+        padding = 0;
+    }
+
+    char* ptr = blocks[current_block].get() + block_offset + padding;
+    block_offset += padding + bytes;
+    bytes_allocated += bytes;
+    return ptr;
+}
+
+// O(1): blocks stay owned by the arena and are handed out again in order
+void Arena::reset() {
+    current_block = 0;
+    block_offset = 0;
+    bytes_allocated = 0;
+}
+
+size_t Arena::get_block_size() const {
+    return block_size;
+}
+
+size_t Arena::get_block_count() const {
+    return blocks.size();
+}
+
+size_t Arena::get_bytes_allocated() const {
+    return bytes_allocated;
+}
+
+size_t Arena::get_memory_usage() const {
+    return blocks.size() * block_size;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+constexpr size_t ARENA_MAX_BLOCK_SIZE = 1024 * 1024;
+
+// Bump allocator for memtable nodes. Memory is carved from large contiguous
+// blocks and only released when the arena is destroyed; reset() rewinds the
+// cursor so the next memtable reuses the same blocks without touching malloc.
+class Arena {
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_size;
+    size_t current_block;
+    size_t block_offset;
+    size_t bytes_allocated;
+
+    void advance_block();
+
+public:
+    explicit Arena(size_t block_bytes = ARENA_MAX_BLOCK_SIZE);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    void reset();
+
+    size_t get_block_size() const;
+    size_t get_block_count() const;
+    size_t get_bytes_allocated() const;
+    size_t get_memory_usage() const;
+};
+
+#include "arena.cpp"
+
+#endif
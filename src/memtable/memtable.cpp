@@ -2,9 +2,22 @@
 #define MEMTABLE_CPP
 
 #include "memtable.h"
+#include <new>
+#include <type_traits>
 
+// Size arena blocks so that a whole memtable fits in one block when it is small
 template<typename K, typename V>
-RedBlackTree<K, V>::RedBlackTree(size_t max_size) : current_size(0), memtable_size(max_size) {
+static size_t memtable_arena_block_size(size_t max_size) {
+    size_t node_bytes = sizeof(RedBlackNode<K, V>) + alignof(RedBlackNode<K, V>);
+    if (max_size == 0 || max_size > ARENA_MAX_BLOCK_SIZE / node_bytes) {
+        return std::max(ARENA_MAX_BLOCK_SIZE, node_bytes);
+    }
+    return max_size * node_bytes;
+}
+
+template<typename K, typename V>
+RedBlackTree<K, V>::RedBlackTree(size_t max_size)
+    : current_size(0), memtable_size(max_size), arena(memtable_arena_block_size<K, V>(max_size)) {
     nil_node = new RedBlackNode<K, V>(K{}, V{}, BLACK);
     nil_node->left = nil_node;
     nil_node->right = nil_node;
@@ -14,19 +27,29 @@ RedBlackTree<K, V>::RedBlackTree(size_t max_size) : current_size(0), memtable_si
 
 template<typename K, typename V>
 RedBlackTree<K, V>::~RedBlackTree() {
-    destroy_tree(root);
+    if constexpr (!std::is_trivially_destructible_v<RedBlackNode<K, V>>) {
+        destroy_tree(root);
+    }
     delete nil_node;
 }
 
+// Nodes live in the arena, so only their destructors run here; the memory is
+// reclaimed by arena.reset() or when the arena itself goes away
 template<typename K, typename V>
 void RedBlackTree<K, V>::destroy_tree(RedBlackNode<K, V>* node) {
     if (node != nil_node) {
         destroy_tree(node->left);
         destroy_tree(node->right);
-        delete node;
+        node->~RedBlackNode<K, V>();
     }
 }
 
+template<typename K, typename V>
+RedBlackNode<K, V>* RedBlackTree<K, V>::allocate_node(const K& key, const V& value) {
+    void* memory = arena.allocate(sizeof(RedBlackNode<K, V>), alignof(RedBlackNode<K, V>));
+    return new (memory) RedBlackNode<K, V>(key, value);
+}
+
 template<typename K, typename V>
 void RedBlackTree<K, V>::left_rotate(RedBlackNode<K, V>* x) {
     RedBlackNode<K, V>* y = x->right;
@@ -75,18 +98,17 @@ void RedBlackTree<K, V>::right_rotate(RedBlackNode<K, V>* y) {
 
 template<typename K, typename V>
 bool RedBlackTree<K, V>::put(const K& key, const V& value) {
-    RedBlackNode<K, V>* z = new RedBlackNode<K, V>(key, value);
     RedBlackNode<K, V>* y = nil_node;
     RedBlackNode<K, V>* x = root;
 
+    // Find the insertion point first so that updates never allocate a node
     while (x != nil_node) {
         y = x;
 
-        if (z->key == x->key) {
+        if (key == x->key) {
             x->value = value;
-            delete z;
             return true;
-        } else if (z->key < x->key) {
+        } else if (key < x->key) {
             x = x->left;
         } else {
             x = x->right;
@@ -94,10 +116,10 @@ bool RedBlackTree<K, V>::put(const K& key, const V& value) {
     }
 
     if (current_size >= memtable_size) {
-        delete z;
         return false;
     }
 
+    RedBlackNode<K, V>* z = allocate_node(key, value);
     z->parent = y;
     if (y == nil_node) {
         root = z;
@@ -182,6 +204,23 @@ bool RedBlackTree<K, V>::get(const K& key, V& value) {
     return false;
 }
 
+template<typename K, typename V>
+bool RedBlackTree<K, V>::contains(const K& key) const {
+    RedBlackNode<K, V>* current = root;
+
+    while (current != nil_node) {
+        if (key == current->key) {
+            return true;
+        } else if (key < current->key) {
+            current = current->left;
+        } else {
+            current = current->right;
+        }
+    }
+
+    return false;
+}
+
 template<typename K, typename V>
 bool RedBlackTree<K, V>::is_full() const {
     return current_size >= memtable_size;
@@ -194,11 +233,62 @@ size_t RedBlackTree<K, V>::size() const {
 
 template<typename K, typename V>
 void RedBlackTree<K, V>::clear() {
-    destroy_tree(root);
+    // Trivially destructible nodes need no tree walk, making the reset O(1)
+    if constexpr (!std::is_trivially_destructible_v<RedBlackNode<K, V>>) {
+        destroy_tree(root);
+    }
+    arena.reset();
     root = nil_node;
     current_size = 0;
 }
 
+// Builds a perfectly balanced tree by always picking the middle element as the
+// subtree root. All nil leaves then sit at two adjacent depths, so colouring
+// the deepest level red and everything else black satisfies the red-black rules.
+template<typename K, typename V>
+bool RedBlackTree<K, V>::bulk_load(const std::vector<std::pair<K, V>>& sorted_data) {
+    if (sorted_data.size() > memtable_size) {
+        return false;
+    }
+
+    clear();
+    if (sorted_data.empty()) {
+        return true;
+    }
+
+    int red_depth = 0;
+    for (size_t n = sorted_data.size(); n > 1; n >>= 1) {
+        red_depth++;
+    }
+
+    root = build_balanced(sorted_data, 0, sorted_data.size(), nil_node, 0, red_depth);
+    root->color = BLACK;
+    current_size = sorted_data.size();
+    return true;
+}
+
+template<typename K, typename V>
+RedBlackNode<K, V>* RedBlackTree<K, V>::build_balanced(const std::vector<std::pair<K, V>>& sorted_data,
+                                                       size_t begin, size_t end, RedBlackNode<K, V>* parent,
+                                                       int depth, int red_depth) {
+    if (begin >= end) {
+        return nil_node;
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    RedBlackNode<K, V>* node = allocate_node(sorted_data[mid].first, sorted_data[mid].second);
+    node->color = (depth == red_depth) ? RED : BLACK;
+    node->parent = parent;
+    node->left = build_balanced(sorted_data, begin, mid, node, depth + 1, red_depth);
+    node->right = build_balanced(sorted_data, mid + 1, end, node, depth + 1, red_depth);
+    return node;
+}
+
+template<typename K, typename V>
+size_t RedBlackTree<K, V>::get_arena_memory_usage() const {
+    return arena.get_memory_usage();
+}
+
 template<typename K, typename V>
 void RedBlackTree<K, V>::inorder_traversal() const {
     inorder_helper(root);
@@ -299,6 +389,76 @@ void RedBlackTree<K, V>::scan_helper(RedBlackNode<K, V>* node, const K& start_ke
     }
 }
 
+template<typename K, typename V>
+const RedBlackNode<K, V>* RedBlackTree<K, V>::lower_bound(const K& key) const {
+    const RedBlackNode<K, V>* current = root;
+    const RedBlackNode<K, V>* result = nullptr;
+
+    while (current != nil_node) {
+        if (current->key < key) {
+            current = current->right;
+        } else {
+            result = current;
+            current = current->left;
+        }
+    }
+    return result;
+}
+
+template<typename K, typename V>
+const RedBlackNode<K, V>* RedBlackTree<K, V>::successor(const RedBlackNode<K, V>* node) const {
+    if (node->right != nil_node) {
+        node = node->right;
+        while (node->left != nil_node) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    // climb until we leave a left subtree
+    const RedBlackNode<K, V>* parent = node->parent;
+    while (parent != nil_node && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent == nil_node ? nullptr : parent;
+}
+
+template<typename K, typename V>
+const RedBlackNode<K, V>* RedBlackTree<K, V>::floor(const K& key) const {
+    const RedBlackNode<K, V>* current = root;
+    const RedBlackNode<K, V>* result = nullptr;
+
+    while (current != nil_node) {
+        if (key < current->key) {
+            current = current->left;
+        } else {
+            result = current;
+            current = current->right;
+        }
+    }
+    return result;
+}
+
+template<typename K, typename V>
+const RedBlackNode<K, V>* RedBlackTree<K, V>::predecessor(const RedBlackNode<K, V>* node) const {
+    if (node->left != nil_node) {
+        node = node->left;
+        while (node->right != nil_node) {
+            node = node->right;
+        }
+        return node;
+    }
+
+    // climb until we leave a right subtree
+    const RedBlackNode<K, V>* parent = node->parent;
+    while (parent != nil_node && node == parent->left) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent == nil_node ? nullptr : parent;
+}
+
 template<typename K, typename V>
 K RedBlackTree<K, V>::get_min_key() const {
     if (root == nil_node) {
@@ -4,6 +4,8 @@
 #include <string>
 #include <iostream>
 #include <algorithm>
+#include <vector>
+#include "arena.h"
 
 enum Color { RED, BLACK };
 
@@ -28,7 +30,9 @@ private:
     RedBlackNode<K, V>* nil_node;
     size_t current_size;
     size_t memtable_size;
+    Arena arena;
 
+    RedBlackNode<K, V>* allocate_node(const K& key, const V& value);
     void left_rotate(RedBlackNode<K, V>* x);
     void right_rotate(RedBlackNode<K, V>* y);
     void insert_fixup(RedBlackNode<K, V>* z);
@@ -37,6 +41,8 @@ private:
     void delete_fixup(RedBlackNode<K, V>* x);
     void destroy_tree(RedBlackNode<K, V>* node);
     bool verify_red_black_helper(RedBlackNode<K, V>* node) const;
+    RedBlackNode<K, V>* build_balanced(const std::vector<std::pair<K, V>>& sorted_data, size_t begin, size_t end,
+                                       RedBlackNode<K, V>* parent, int depth, int red_depth);
     int get_height_helper(RedBlackNode<K, V>* node) const;
 
 public:
@@ -45,9 +51,13 @@ public:
 
     bool put(const K& key, const V& value);
     bool get(const K& key, V& value);
+    bool contains(const K& key) const;
     bool is_full() const;
     size_t size() const;
     void clear();
+    // Replaces the contents with sorted, duplicate-free data in O(n)
+    bool bulk_load(const std::vector<std::pair<K, V>>& sorted_data);
+    size_t get_arena_memory_usage() const;
 
     void inorder_traversal() const;
     void inorder_helper(RedBlackNode<K, V>* node) const;
@@ -55,6 +65,15 @@ public:
     std::vector<std::pair<K, V>> scan(const K& start_key, const K& end_key) const;
     void scan_helper(RedBlackNode<K, V>* node, const K& start_key, const K& end_key, std::vector<std::pair<K, V>>& results) const;
 
+    // In-order cursor: the first node with a key not less than `key`, and the
+    // node after `node`; both return nullptr past the last key
+    const RedBlackNode<K, V>* lower_bound(const K& key) const;
+    const RedBlackNode<K, V>* successor(const RedBlackNode<K, V>* node) const;
+    // The same backwards: the last node with a key not greater than `key`, and
+    // the node before `node`; both return nullptr before the first key
+    const RedBlackNode<K, V>* floor(const K& key) const;
+    const RedBlackNode<K, V>* predecessor(const RedBlackNode<K, V>* node) const;
+
     // Get min and max keys for scan bounds
     K get_min_key() const;
     K get_max_key() const;
@@ -0,0 +1,95 @@
+#ifndef FILE_TABLE_CPP
+#define FILE_TABLE_CPP
+
+#include "file_table.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileHandle::FileHandle(int file_fd) : fd(file_fd) {
+}
+
+FileHandle::~FileHandle() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+int FileHandle::get_fd() const {
+    return fd;
+}
+
+FileTable::FileTable() : capacity(FILE_TABLE_DEFAULT_CAPACITY), opens(0) {
+}
+
+FileTable& FileTable::instance() {
+    static FileTable table;
+    return table;
+}
+
+std::shared_ptr<FileHandle> FileTable::acquire(const std::string& path, bool create) {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    auto it = open_files.find(path);
+    if (it != open_files.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru_position);
+        return it->second.handle;
+    }
+
+    int flags = O_RDWR | (create ? O_CREAT : 0);
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        if (create || errno != ENOENT) {
+            std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << std::endl;
+        }
+        return nullptr;
+    }
+    opens++;
+
+    lru.push_front(path);
+    auto handle = std::make_shared<FileHandle>(fd);
+    open_files[path] = {handle, lru.begin()};
+    evict_to_capacity_locked();
+    return handle;
+}
+
+void FileTable::evict_to_capacity_locked() {
+    while (open_files.size() > capacity && !lru.empty()) {
+        open_files.erase(lru.back());
+        lru.pop_back();
+    }
+}
+
+void FileTable::evict(const std::string& path) {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    auto it = open_files.find(path);
+    if (it == open_files.end()) {
+        return;
+    }
+    lru.erase(it->second.lru_position);
+    open_files.erase(it);
+}
+
+void FileTable::set_capacity(size_t max_open_files) {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    capacity = max_open_files == 0 ? 1 : max_open_files;
+    evict_to_capacity_locked();
+}
+
+size_t FileTable::get_capacity() const {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    return capacity;
+}
+
+size_t FileTable::get_open_count() const {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    return open_files.size();
+}
+
+size_t FileTable::get_total_opens() const {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    return opens;
+}
+
+#endif
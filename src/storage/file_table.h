@@ -0,0 +1,70 @@
+#ifndef FILE_TABLE_H
+#define FILE_TABLE_H
+
+#include <string>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+constexpr size_t FILE_TABLE_DEFAULT_CAPACITY = 256;
+
+// An open file descriptor; closed when the last user lets go of it
+class FileHandle {
+private:
+    int fd;
+
+public:
+    explicit FileHandle(int file_fd);
+    ~FileHandle();
+
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int get_fd() const;
+};
+
+// Process-wide table of open SST files, so page I/O is a single pread or
+// pwrite instead of an open/read/close per page. At most `capacity` files are
+// kept open; the least recently used one is dropped first. A handle that is
+// still in use when it is dropped stays open until its I/O finishes.
+class FileTable {
+private:
+    using LruList = std::list<std::string>;
+
+    struct Entry {
+        std::shared_ptr<FileHandle> handle;
+        LruList::iterator lru_position;
+    };
+
+    mutable std::mutex table_mutex;
+    size_t capacity;
+    LruList lru;
+    std::unordered_map<std::string, Entry> open_files;
+
+    // open() calls made so far, for tests and stats
+    size_t opens;
+
+    FileTable();
+    void evict_to_capacity_locked();
+
+public:
+    static FileTable& instance();
+
+    FileTable(const FileTable&) = delete;
+    FileTable& operator=(const FileTable&) = delete;
+
+    // Returns an open handle for the path, opening (and optionally creating) it if needed
+    std::shared_ptr<FileHandle> acquire(const std::string& path, bool create = false);
+    // Drops the cached handle, e.g. before the file is deleted or rewritten
+    void evict(const std::string& path);
+
+    void set_capacity(size_t max_open_files);
+    size_t get_capacity() const;
+    size_t get_open_count() const;
+    size_t get_total_opens() const;
+};
+
+#include "file_table.cpp"
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef MANIFEST_CPP
+#define MANIFEST_CPP
+
+#include "manifest.h"
+#include "../../utils/crc32.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Record layout: crc32 | u32 payload length | payload, where the payload is
+// u64 sequence | u32 change count | (u8 type | u32 level | u16 name length | name)*.
+// An ADD with a run id uses its own type, followed by u64 run id, so
+// manifests written before run ids were recorded still load.
+namespace {
+constexpr size_t MANIFEST_RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+constexpr uint8_t MANIFEST_ADD_IN_RUN = 3;
+
+template<typename T>
+void append_raw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_raw(const char*& in, const char* end, T& value) {
+    if (static_cast<size_t>(end - in) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return true;
+}
+
+bool write_all_and_sync(int fd, const std::string& data) {
+    const char* ptr = data.data();
+    size_t length = data.size();
+    while (length > 0) {
+        ssize_t written = ::write(fd, ptr, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        ptr += written;
+        length -= static_cast<size_t>(written);
+    }
+    return ::fsync(fd) == 0;
+}
+}
+
+Manifest::Manifest(const std::string& dir)
+    : directory(dir), fd(-1), last_sequence(0), edits_since_snapshot(0) {
+}
+
+Manifest::~Manifest() {
+    close();
+}
+
+bool Manifest::exists(const std::string& dir) {
+    return std::filesystem::exists(dir + "/" + FILENAME);
+}
+
+std::string Manifest::encode_edit(uint64_t sequence, const std::vector<ManifestChange>& changes) {
+    std::string payload;
+    append_raw<uint64_t>(payload, sequence);
+    append_raw<uint32_t>(payload, static_cast<uint32_t>(changes.size()));
+    for (const auto& change : changes) {
+        bool in_run = change.type == ManifestChangeType::ADD && change.run_id != 0;
+        append_raw<uint8_t>(payload, in_run ? MANIFEST_ADD_IN_RUN : static_cast<uint8_t>(change.type));
+        append_raw<uint32_t>(payload, static_cast<uint32_t>(change.level));
+        append_raw<uint16_t>(payload, static_cast<uint16_t>(change.filename.size()));
+        payload.append(change.filename);
+        if (in_run) {
+            append_raw<uint64_t>(payload, change.run_id);
+        }
+    }
+
+    std::string record;
+    append_raw<uint32_t>(record, crc32(payload.data(), payload.size()));
+    append_raw<uint32_t>(record, static_cast<uint32_t>(payload.size()));
+    record.append(payload);
+    return record;
+}
+
+bool Manifest::decode_edit(const char* payload, size_t length, uint64_t& sequence,
+                           std::vector<ManifestChange>& changes) {
+    const char* in = payload;
+    const char* end = payload + length;
+    uint32_t count;
+    if (!read_raw(in, end, sequence) || !read_raw(in, end, count)) {
+        return false;
+    }
+
+    changes.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t type;
+        uint32_t level;
+        uint16_t name_length;
+        if (!read_raw(in, end, type) || !read_raw(in, end, level) || !read_raw(in, end, name_length) ||
+            static_cast<size_t>(end - in) < name_length) {
+            return false;
+        }
+        std::string filename(in, name_length);
+        in += name_length;
+        uint64_t run_id = 0;
+        if (type == MANIFEST_ADD_IN_RUN) {
+            if (!read_raw(in, end, run_id)) {
+                return false;
+            }
+            type = static_cast<uint8_t>(ManifestChangeType::ADD);
+        } else if (type != static_cast<uint8_t>(ManifestChangeType::ADD) &&
+                   type != static_cast<uint8_t>(ManifestChangeType::REMOVE)) {
+            return false;
+        }
+        changes.push_back({static_cast<ManifestChangeType>(type), level, std::move(filename), run_id});
+    }
+    return in == end;
+}
+
+// Applies an edit to the layout; fails without side effects if a removed
+// file is not where the edit says it is
+bool Manifest::apply(const std::vector<ManifestChange>& changes) {
+    auto updated = layout;
+    auto updated_run_ids = run_ids;
+    for (const auto& change : changes) {
+        if (updated.size() <= change.level) {
+            updated.resize(change.level + 1);
+        }
+        auto& files = updated[change.level];
+        if (change.type == ManifestChangeType::ADD) {
+            files.push_back(change.filename);
+            if (change.run_id != 0) {
+                updated_run_ids[change.filename] = change.run_id;
+            }
+        } else {
+            auto it = std::find(files.begin(), files.end(), change.filename);
+            if (it == files.end()) {
+                return false;
+            }
+            files.erase(it);
+            updated_run_ids.erase(change.filename);
+        }
+    }
+
+    // drop empty trailing levels so the layout matches what Database builds
+    while (!updated.empty() && updated.back().empty()) {
+        updated.pop_back();
+    }
+    layout = std::move(updated);
+    run_ids = std::move(updated_run_ids);
+    return true;
+}
+
+bool Manifest::open() {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    layout.clear();
+    run_ids.clear();
+    last_sequence = 0;
+
+    std::string path = directory + "/" + FILENAME;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open manifest " << path << std::endl;
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    size_t offset = 0;
+    std::vector<ManifestChange> changes;
+    while (data.size() - offset >= MANIFEST_RECORD_HEADER_SIZE) {
+        uint32_t checksum, length;
+        std::memcpy(&checksum, data.data() + offset, sizeof(uint32_t));
+        std::memcpy(&length, data.data() + offset + sizeof(uint32_t), sizeof(uint32_t));
+        const char* payload = data.data() + offset + MANIFEST_RECORD_HEADER_SIZE;
+        if (data.size() - offset - MANIFEST_RECORD_HEADER_SIZE < length ||
+            crc32(payload, length) != checksum) {
+            break;
+        }
+
+        uint64_t sequence;
+        if (!decode_edit(payload, length, sequence, changes)) {
+            break;
+        }
+        if (!apply(changes)) {
+            std::cerr << "Manifest " << path << " removes a file it never added (edit " << sequence << ")"
+                      << std::endl;
+            return false;
+        }
+        last_sequence = sequence;
+        offset += MANIFEST_RECORD_HEADER_SIZE + length;
+    }
+
+    if (offset != data.size()) {
+        // an edit that was being written when the process stopped; it never took effect
+        std::cerr << "Manifest " << path << ": ignoring " << (data.size() - offset)
+                  << " bytes of incomplete edit" << std::endl;
+    }
+
+    return rewrite_locked();
+}
+
+bool Manifest::create(const std::vector<std::vector<std::string>>& initial_layout,
+                      const std::map<std::string, uint64_t>& initial_run_ids) {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    layout = initial_layout;
+    run_ids = initial_run_ids;
+    last_sequence = 0;
+    return rewrite_locked();
+}
+
+// Writes the current layout as a single edit to a new file and swaps it in
+bool Manifest::rewrite_locked() {
+    std::vector<ManifestChange> snapshot;
+    for (size_t level = 0; level < layout.size(); level++) {
+        for (const auto& filename : layout[level]) {
+            auto run = run_ids.find(filename);
+            snapshot.push_back({ManifestChangeType::ADD, level, filename, run == run_ids.end() ? 0 : run->second});
+        }
+    }
+
+    std::string path = directory + "/" + FILENAME;
+    std::string temp_path = path + ".tmp";
+    int temp_fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (temp_fd < 0) {
+        std::cerr << "Failed to create manifest " << temp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool written = write_all_and_sync(temp_fd, encode_edit(last_sequence + 1, snapshot));
+    ::close(temp_fd);
+    if (!written || ::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write manifest " << path << std::endl;
+        std::filesystem::remove(temp_path);
+        return false;
+    }
+    last_sequence++;
+
+    // make the rename itself durable
+    int dir_fd = ::open(directory.c_str(), O_RDONLY);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        std::cerr << "Failed to open manifest " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    edits_since_snapshot = 0;
+    return true;
+}
+
+void Manifest::close() {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool Manifest::log_edit(const std::vector<ManifestChange>& changes) {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    if (fd < 0) {
+        return false;
+    }
+
+    auto previous = layout;
+    auto previous_run_ids = run_ids;
+    if (!apply(changes)) {
+        std::cerr << "Rejected manifest edit: removed file is not in the layout" << std::endl;
+        return false;
+    }
+    off_t previous_end = ::lseek(fd, 0, SEEK_END);
+    if (!write_all_and_sync(fd, encode_edit(last_sequence + 1, changes))) {
+        std::cerr << "Failed to append to manifest in " << directory << ": " << std::strerror(errno) << std::endl;
+        layout = std::move(previous);
+        run_ids = std::move(previous_run_ids);
+        // open() stops at a torn record, so edits appended after one would be lost
+        bool trimmed = previous_end >= 0 && ::ftruncate(fd, previous_end) == 0 && ::fsync(fd) == 0;
+        if (!trimmed && !rewrite_locked()) {
+            std::cerr << "Manifest in " << directory << " has a torn edit; refusing further edits" << std::endl;
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        return false;
+    }
+    last_sequence++;
+
+    if (++edits_since_snapshot >= MANIFEST_MAX_EDITS) {
+        // the edit is already durable; a failed rewrite only leaves a longer log
+        rewrite_locked();
+    }
+    return true;
+}
+
+std::vector<std::vector<std::string>> Manifest::get_layout() const {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    return layout;
+}
+
+uint64_t Manifest::get_run_id(const std::string& filename) const {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    auto it = run_ids.find(filename);
+    return it == run_ids.end() ? 0 : it->second;
+}
+
+uint64_t Manifest::get_last_sequence() const {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    return last_sequence;
+}
+
+size_t Manifest::get_edits_since_snapshot() const {
+    std::lock_guard<std::mutex> lock(manifest_mutex);
+    return edits_since_snapshot;
+}
+
+#endif
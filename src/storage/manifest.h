@@ -0,0 +1,76 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+// Rewrite the manifest as a snapshot once this many edits have been appended
+constexpr size_t MANIFEST_MAX_EDITS = 1024;
+
+enum class ManifestChangeType : uint8_t {
+    ADD = 1,
+    REMOVE = 2
+};
+
+struct ManifestChange {
+    ManifestChangeType type;
+    size_t level;
+    std::string filename;
+    // Sorted run an added file belongs to within its level; 0 if unknown
+    uint64_t run_id = 0;
+};
+
+// Append-only log of SST additions and removals per level. Each edit is one
+// checksummed, sequence-numbered record that is fsynced before log_edit
+// returns, so a flush or compaction becomes visible atomically and a torn
+// tail is ignored on load. Within a level, files keep the order they were
+// added in (oldest first), and each remembers the run it was added with.
+class Manifest {
+private:
+    std::string directory;
+    mutable std::mutex manifest_mutex;
+    int fd;
+    uint64_t last_sequence;
+    size_t edits_since_snapshot;
+    std::vector<std::vector<std::string>> layout;
+    std::map<std::string, uint64_t> run_ids;   // live files added with a run id
+
+    bool apply(const std::vector<ManifestChange>& changes);
+    bool rewrite_locked();
+    static std::string encode_edit(uint64_t sequence, const std::vector<ManifestChange>& changes);
+    static bool decode_edit(const char* payload, size_t length, uint64_t& sequence,
+                            std::vector<ManifestChange>& changes);
+
+public:
+    static constexpr const char* FILENAME = "MANIFEST";
+
+    explicit Manifest(const std::string& dir);
+    ~Manifest();
+
+    Manifest(const Manifest&) = delete;
+    Manifest& operator=(const Manifest&) = delete;
+
+    static bool exists(const std::string& dir);
+
+    // Replays the manifest into the per-level file lists and compacts it
+    bool open();
+    // Starts a new manifest holding the given layout (e.g. from a directory scan)
+    bool create(const std::vector<std::vector<std::string>>& initial_layout,
+                const std::map<std::string, uint64_t>& initial_run_ids = {});
+    void close();
+
+    bool log_edit(const std::vector<ManifestChange>& changes);
+
+    std::vector<std::vector<std::string>> get_layout() const;
+    // Run the live file was last added with, or 0 if its edit had none
+    uint64_t get_run_id(const std::string& filename) const;
+    uint64_t get_last_sequence() const;
+    size_t get_edits_since_snapshot() const;
+};
+
+#include "manifest.cpp"
+
+#endif
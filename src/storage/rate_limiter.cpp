@@ -0,0 +1,62 @@
+#ifndef RATE_LIMITER_CPP
+#define RATE_LIMITER_CPP
+
+#include "rate_limiter.h"
+#include <algorithm>
+#include <thread>
+
+// Refills cover at most this long, which also bounds the burst
+constexpr double RATE_LIMITER_BURST_SECONDS = 0.1;
+
+RateLimiter::RateLimiter(size_t rate)
+    : bytes_per_second(rate), available_bytes(0), last_refill(std::chrono::steady_clock::now()), total_bytes(0) {
+}
+
+double RateLimiter::burst_bytes_locked() const {
+    return static_cast<double>(bytes_per_second) * RATE_LIMITER_BURST_SECONDS;
+}
+
+void RateLimiter::refill_locked(std::chrono::steady_clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - last_refill).count();
+    last_refill = now;
+    available_bytes = std::min(burst_bytes_locked(), available_bytes + elapsed * bytes_per_second);
+}
+
+void RateLimiter::request(size_t bytes) {
+    double wait_seconds = 0;
+    {
+        std::lock_guard<std::mutex> lock(limiter_mutex);
+        total_bytes += bytes;
+        if (bytes_per_second == 0) {
+            return;
+        }
+        refill_locked(std::chrono::steady_clock::now());
+        available_bytes -= static_cast<double>(bytes);
+        if (available_bytes < 0) {
+            wait_seconds = -available_bytes / bytes_per_second;
+        }
+    }
+
+    if (wait_seconds > 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait_seconds));
+    }
+}
+
+void RateLimiter::set_rate(size_t rate) {
+    std::lock_guard<std::mutex> lock(limiter_mutex);
+    refill_locked(std::chrono::steady_clock::now());
+    bytes_per_second = rate;
+    available_bytes = std::min(available_bytes, burst_bytes_locked());
+}
+
+size_t RateLimiter::get_rate() const {
+    std::lock_guard<std::mutex> lock(limiter_mutex);
+    return bytes_per_second;
+}
+
+size_t RateLimiter::get_total_bytes() const {
+    std::lock_guard<std::mutex> lock(limiter_mutex);
+    return total_bytes;
+}
+
+#endif
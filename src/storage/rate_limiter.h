@@ -0,0 +1,40 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+
+// Token bucket that paces background I/O to a number of bytes per second.
+// Tokens refill continuously up to one burst; a request larger than what is
+// available runs the bucket into debt and sleeps until it is paid back, so
+// large sequential writes keep their size but the average rate holds.
+class RateLimiter {
+private:
+    mutable std::mutex limiter_mutex;
+    size_t bytes_per_second;   // 0 means unlimited
+    double available_bytes;
+    std::chrono::steady_clock::time_point last_refill;
+    size_t total_bytes;
+
+    void refill_locked(std::chrono::steady_clock::time_point now);
+    double burst_bytes_locked() const;
+
+public:
+    explicit RateLimiter(size_t rate = 0);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Blocks until `bytes` may be read or written
+    void request(size_t bytes);
+
+    void set_rate(size_t rate);
+    size_t get_rate() const;
+    // Bytes requested so far, limited or not
+    size_t get_total_bytes() const;
+};
+
+#include "rate_limiter.cpp"
+
+#endif
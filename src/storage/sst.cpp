@@ -2,20 +2,35 @@
 #define SST_CPP
 
 #include "sst.h"
+#include "sst_builder.h"
+#include "sst_iterator.h"
 #include <iostream>
 #include <algorithm>
+#include <queue>
+#include <map>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <cstring>
+#include <cerrno>
+#include <filesystem>
 
 template<typename K, typename V>
 SST<K, V>::SST(const std::string& file_path, BufferPool* bp, size_t sst_level, double false_positive_rate)
-    : filename(file_path), entry_count(0), buffer_pool(bp), level(sst_level), bloom_filter_fpr(false_positive_rate) {
+    : filename(file_path), entry_count(0), buffer_pool(bp), level(sst_level), bloom_filter_fpr(false_positive_rate),
+      format_version(SST_FORMAT_VERSION), leaf_count(0), internal_start_offset(0), internal_node_count(0),
+      file_size(0), tombstone_count(0), run_id(0), read_mode(SSTReadMode::BUFFER_POOL), mapped_data(nullptr), mapped_size(0),
+      active_mapped_scans(0) {
     bloom_filter = nullptr;
 }
 
 template<typename K, typename V>
 SST<K, V>::~SST() {
+    unmap_file();
 }
 
 template<typename K, typename V>
@@ -25,188 +40,281 @@ bool SST<K, V>::create_from_memtable(const std::string& file_path, const std::ve
         return true;
     }
 
-    min_key = sorted_data[0].first;
-    max_key = sorted_data[entry_count - 1].first;
-    filename = file_path;
-
-    // Initialize Bloom Filter
-    bloom_filter = std::make_unique<BloomFilter<K>>(entry_count, bloom_filter_fpr);
-
-    size_t data_index = 0;
-    size_t current_offset = sizeof(SSTHeader);
-    leaf_start_offset = current_offset;
-    std::vector<size_t> leaf_node_offsets;
-    std::vector<K> leaf_separator_keys;
-
-    // Create the b-tree from bottom up
-    // leaf nodes
-    while (data_index < entry_count) {
-        auto leaf_node = std::make_unique<LeafNode<K, V>>();
-        leaf_node->is_leaf = true;
-        leaf_node->count = 0;
-
-        // Create leaf nodes with key-value pairs (each node stores a page worth of <K, V> pairs)
-        while (leaf_node->count < LeafNode<K,V>::PAIRS_COUNT && data_index < entry_count) {
-            leaf_node->pairs[leaf_node->count] = sorted_data[data_index];
-            // add leaf node keys to filter
-            bloom_filter->add(sorted_data[data_index].first);
-            leaf_node->count++;
-            data_index++;
+    SSTBuilder<K, V> builder(file_path, sst_level, bloom_filter_fpr, sorted_data.size());
+    for (const auto& [key, value] : sorted_data) {
+        if (!builder.add(key, value)) {
+            return false;
         }
+    }
+    return builder.finish(*this);
+}
 
-        // Store largest key of leaf node
-        leaf_separator_keys.push_back(leaf_node->pairs[leaf_node->count - 1].first);
+template<typename K, typename V>
+std::vector<K> SST<K, V>::choose_split_keys(const std::vector<SST<K, V>*>& inputs, size_t partitions) {
+    // every fence key closes one leaf, so equal shares of them hold about equal data
+    std::vector<K> fences;
+    for (const SST<K, V>* input : inputs) {
+        fences.insert(fences.end(), input->fence_keys.begin(), input->fence_keys.end());
+    }
+    std::sort(fences.begin(), fences.end());
+
+    std::vector<K> split_keys;
+    for (size_t i = 1; i < partitions; i++) {
+        const K& key = fences[i * fences.size() / partitions];
+        if (split_keys.empty() || split_keys.back() < key) {
+            split_keys.push_back(key);
+        }
+    }
+    // the last range must not be empty
+    while (!split_keys.empty() && !(split_keys.back() < fences.back())) {
+        split_keys.pop_back();
+    }
+    return split_keys;
+}
 
-        // Write leaf node to file
-        if (!write_page_to_disk(current_offset, reinterpret_cast<char*>(leaf_node.get()))) {
-            return false;
+// Streams a k-way merge of the inputs into one builder after another. Each
+// input is read through its own iterator, so memory use is a few pages per
+// input no matter how large the files are.
+template<typename K, typename V>
+bool SST<K, V>::merge_range(const std::function<std::string()>& next_file_path,
+                            const std::vector<SST<K, V>*>& inputs,
+                            size_t target_level,
+                            std::vector<std::unique_ptr<SST<K, V>>>& outputs,
+                            const SSTMergeOptions& options,
+                            const K* lower,
+                            const K* upper,
+                            size_t expected_entries) {
+    outputs.clear();
+    std::vector<std::unique_ptr<SSTIterator<K, V>>> iterators;
+    for (SST<K, V>* input : inputs) {
+        iterators.push_back(std::make_unique<SSTIterator<K, V>>(*input, SST_ITERATOR_READAHEAD_PAGES,
+                                                                options.limiter));
+        if (lower) {
+            iterators.back()->seek_past(*lower);
+        } else {
+            iterators.back()->seek_to_first();
         }
-        leaf_node_offsets.push_back(current_offset);
+    }
+    auto in_range = [&iterators, upper](size_t i) {
+        return iterators[i]->valid() && (!upper || !(*upper < iterators[i]->key()));
+    };
 
-        current_offset += PAGE_SIZE;
+    // smallest key on top; on equal keys the newest input comes first
+    auto after = [&iterators](size_t a, size_t b) {
+        const K& key_a = iterators[a]->key();
+        const K& key_b = iterators[b]->key();
+        if (key_b < key_a) {
+            return true;
+        }
+        return !(key_a < key_b) && a < b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(after)> heap(after);
+    for (size_t i = 0; i < iterators.size(); i++) {
+        if (in_range(i)) {
+            heap.push(i);
+        }
     }
 
-    // Create internal nodes
-    std::vector<size_t> current_level_nodes = leaf_node_offsets;
-    std::vector<K> current_level_keys = leaf_separator_keys;
-    size_t internal_node_offset = current_offset;
+    // Output files are cut only after a full leaf, so each holds whole leaves
+    // and no key is split across files
+    size_t entries_per_file = std::numeric_limits<size_t>::max();
+    if (options.max_file_size > 0) {
+        entries_per_file = std::max<size_t>(options.max_file_size / PAGE_SIZE, 1) * LeafNode<K, V>::PAIRS_COUNT;
+    }
 
-    // iterate until we have one node left
-    while (current_level_nodes.size() > 1) {
-        std::vector<size_t> next_level_nodes;
-        std::vector<K> next_level_keys;
+    std::vector<std::string> paths;
+    std::unique_ptr<SST<K, V>> current;
+    std::unique_ptr<SSTBuilder<K, V>> builder;
+    size_t remaining_entries = expected_entries;
+    bool ok = true;
 
-        for (size_t i = 0; i < current_level_nodes.size(); ) {
-            auto internal_node = std::make_unique<InternalNode<K>>();
-            internal_node->is_leaf = false;
-            internal_node->count = 0;
+    while (!heap.empty() && ok) {
+        size_t top = heap.top();
+        heap.pop();
+        K key = iterators[top]->key();
+        V value = iterators[top]->value();
+        remaining_entries -= std::min<size_t>(remaining_entries, 1);
 
-            // Iterate over (each node holds page size worth of leaf node pointers)
-            for (size_t j = 0; j < InternalNode<K>::MAX_KEYS && i < current_level_nodes.size(); j++) {
-                internal_node->keys[j] = current_level_keys[i];
+        iterators[top]->next();
+        if (in_range(top)) {
+            heap.push(top);
+        }
 
-                internal_node->children[j] = current_level_nodes[i];
-                internal_node->count++;
-                i++;
+        // drop older versions of the same key
+        while (!heap.empty() && !(key < iterators[heap.top()]->key())) {
+            size_t older = heap.top();
+            heap.pop();
+            remaining_entries -= std::min<size_t>(remaining_entries, 1);
+            iterators[older]->next();
+            if (in_range(older)) {
+                heap.push(older);
             }
-            // Store largest key of new internal node for next level
-            next_level_keys.push_back(internal_node->keys[internal_node->count - 1]);
+        }
 
-            // Write internal node to file
-            if (!write_page_to_disk(internal_node_offset, reinterpret_cast<char*>(internal_node.get()))) {
-                return false;
-            }
-            next_level_nodes.push_back(internal_node_offset);
-            internal_node_offset += PAGE_SIZE;
+        // with nothing older left below, a tombstone has nothing to hide
+        if (options.drop_tombstones && value == tombstone_value<V>()) {
+            continue;
         }
-        current_level_nodes = next_level_nodes;
-        current_level_keys = next_level_keys;
-    }
 
-    // root node (last remaining node)
-    root_page_offset = current_level_nodes.empty() ? 0 : current_level_nodes[0];
+        if (!builder) {
+            paths.push_back(next_file_path());
+            current = std::make_unique<SST<K, V>>(paths.back(), options.buffer_pool, target_level,
+                                                  options.false_positive_rate);
+            builder = std::make_unique<SSTBuilder<K, V>>(paths.back(), target_level, current->bloom_filter_fpr,
+                                                         std::min(entries_per_file, remaining_entries + 1),
+                                                         options.limiter);
+        }
+        ok = builder->add(key, value);
 
-    // Bloom filter begins after all internal nodes
-    current_offset = internal_node_offset;
-    std::vector<char> bloom_filter_data;
-    size_t padded_bloom_filter_size = 0;
-    if (bloom_filter) {
-        // Calculate number of bytes needed for bit_array
-        size_t num_bits = bloom_filter->num_bits;
-        size_t num_bytes = (num_bits + 7) / 8;
-
-        // Round up to the nearest multiple of PAGE_SIZE
-        padded_bloom_filter_size = ((num_bytes + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
-        bloom_filter_data.resize(padded_bloom_filter_size);
-
-        // Manually serialize into bytes
-        for (size_t i = 0; i < num_bits; ++i) {
-            if (bloom_filter->bit_array[i]) {
-                bloom_filter_data[i / 8] |= (1 << (i % 8));
-            }
+        if (ok && builder->get_entry_count() == entries_per_file) {
+            ok = builder->finish(*current);
+            builder.reset();
+            outputs.push_back(std::move(current));
         }
     }
+    if (ok && builder) {
+        ok = builder->finish(*current);
+        builder.reset();
+        outputs.push_back(std::move(current));
+    }
 
-    size_t bloom_filter_offset = current_offset;
-    size_t bloom_filter_size = padded_bloom_filter_size;
-
-    if (!bloom_filter_data.empty()) {
-        // Write bloom filter data to file
-        if (!write_page_to_disk(bloom_filter_offset, bloom_filter_data.data(), bloom_filter_size)) {
-            return false;
+    for (size_t i = 0; i < iterators.size(); i++) {
+        if (iterators[i]->has_error()) {
+            std::cerr << "Failed to read SST " << inputs[i]->filename << " during merge" << std::endl;
+            ok = false;
         }
     }
-
-    SSTHeader header;
-    header.root_page_offset = root_page_offset;
-    header.leaf_start_offset = leaf_start_offset;
-    header.entry_count = entry_count;
-    header.level = sst_level;
-    header.false_positive_rate = bloom_filter_fpr;
-    header.bloom_filter_offset = bloom_filter_offset;
-    header.bloom_filter_size = bloom_filter_size; // Store the padded size
-    header.bloom_filter_num_hash_functions = bloom_filter->num_hash_functions;
-    header.bloom_filter_num_bits = bloom_filter->num_bits;
-
-    // Write header to file
-    if (!write_page_to_disk(0, reinterpret_cast<char*>(&header), sizeof(SSTHeader))) {
-        return false;
+    if (!ok) {
+        builder.reset();
+        outputs.clear();
+        for (const auto& path : paths) {
+            remove_file(path);
+        }
     }
-
-    return true;
+    return ok;
 }
 
 template<typename K, typename V>
-bool SST<K, V>::create_from_merge(const std::string& file_path,
-                                 SST<K, V>* sst1,
-                                  SST<K, V>* sst2,
+bool SST<K, V>::create_from_merge(const std::function<std::string()>& next_file_path,
+                                  const std::vector<SST<K, V>*>& inputs,
                                   size_t target_level,
-                                  std::unique_ptr<SST<K, V>>& result_sst) {
-    constexpr size_t BUFFER_SIZE = 1024;
-
-
-    std::vector<std::pair<K, V>> input_buffer1;
-    std::vector<std::pair<K, V>> input_buffer2;
-    std::vector<std::pair<K, V>> output_buffer;
-    output_buffer.reserve(BUFFER_SIZE * 2);
-
-    std::vector<std::pair<K, V>> all_merged_data;
-
-    K min_key1 = sst1->get_min_key();
-    K max_key1 = sst1->get_max_key();
-    K min_key2 = sst2->get_min_key();
-    K max_key2 = sst2->get_max_key();
-
-    auto data1 = sst1->scan(min_key1, max_key1, SearchMode::B_TREE_SEARCH);
-    auto data2 = sst2->scan(min_key2, max_key2, SearchMode::B_TREE_SEARCH);
-
-    size_t idx1 = 0, idx2 = 0;
-
-    while (idx1 < data1.size() || idx2 < data2.size()) {
-        if (idx1 >= data1.size()) {
-            all_merged_data.push_back(data2[idx2++]);
-        } else if (idx2 >= data2.size()) {
-            all_merged_data.push_back(data1[idx1++]);
-        } else {
-            if (data1[idx1].first < data2[idx2].first) {
-                all_merged_data.push_back(data1[idx1++]);
-
-            } else if (data1[idx1].first > data2[idx2].first) {
-                all_merged_data.push_back(data2[idx2++]);
-
+                                  std::vector<std::unique_ptr<SST<K, V>>>& outputs,
+                                  const SSTMergeOptions& options) {
+    outputs.clear();
+    size_t total_entries = 0;
+    size_t total_leaves = 0;
+    for (const SST<K, V>* input : inputs) {
+        total_entries += input->entry_count;
+        total_leaves += input->fence_keys.size();
+    }
+
+    size_t partitions = 1;
+    if (options.max_file_size > 0 && options.max_subcompactions > 1) {
+        size_t leaves_per_file = std::max<size_t>(options.max_file_size / PAGE_SIZE, 1);
+        partitions = std::clamp<size_t>(total_leaves / leaves_per_file, 1, options.max_subcompactions);
+    }
+    std::vector<K> split_keys;
+    if (partitions > 1) {
+        split_keys = choose_split_keys(inputs, partitions);
+    }
+    if (split_keys.empty()) {
+        return merge_range(next_file_path, inputs, target_level, outputs, options, nullptr, nullptr, total_entries);
+    }
+
+    // part i holds the keys in (split_keys[i - 1], split_keys[i]]
+    size_t part_count = split_keys.size() + 1;
+    std::mutex path_mutex;
+    auto locked_next_file_path = [&]() {
+        std::lock_guard<std::mutex> guard(path_mutex);
+        return next_file_path();
+    };
+    std::vector<std::vector<std::unique_ptr<SST<K, V>>>> part_outputs(part_count);
+    std::vector<char> part_ok(part_count, 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < part_count; i++) {
+        const K* lower = i > 0 ? &split_keys[i - 1] : nullptr;
+        const K* upper = i < split_keys.size() ? &split_keys[i] : nullptr;
+        workers.emplace_back([&, i, lower, upper]() {
+            part_ok[i] = merge_range(locked_next_file_path, inputs, target_level, part_outputs[i], options,
+                                     lower, upper, total_entries / part_count);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // the parts are key ranges in order, so together they form one sorted run
+    bool ok = true;
+    for (size_t i = 0; i < part_count; i++) {
+        ok = ok && part_ok[i];
+    }
+    for (auto& part : part_outputs) {
+        for (auto& sst : part) {
+            if (ok) {
+                outputs.push_back(std::move(sst));
             } else {
-                all_merged_data.push_back(data2[idx2]);
-                idx1++;
-                idx2++;
+                remove_file(sst->filename);
             }
         }
     }
+    return ok;
+}
 
-    result_sst = std::make_unique<SST<K, V>>(file_path, nullptr, target_level);
+template<typename K, typename V>
+std::vector<LeafHeat<K>> SST<K, V>::drop_cached_pages() {
+    std::vector<LeafHeat<K>> heat;
+    if (!buffer_pool) {
+        return heat;
+    }
+    std::vector<std::pair<size_t, size_t>> dropped;
+    buffer_pool->remove_file_pages(filename, &dropped);
+
+    size_t leaf_end = leaf_start_offset + fence_keys.size() * PAGE_SIZE;
+    for (const auto& [offset, hits] : dropped) {
+        if (offset < leaf_start_offset || offset >= leaf_end) {
+            continue;
+        }
+        // a leaf holds the keys after the previous leaf's fence key, up to its own
+        size_t leaf = (offset - leaf_start_offset) / PAGE_SIZE;
+        const K& first_key = leaf == 0 ? min_key : fence_keys[leaf - 1];
+        // being cached at all counts as one read
+        heat.push_back({first_key, fence_keys[leaf], hits + 1});
+    }
+    return heat;
+}
+
+template<typename K, typename V>
+std::vector<std::pair<size_t, size_t>> SST<K, V>::map_leaf_heat(const std::vector<LeafHeat<K>>& heat) const {
+    std::map<size_t, size_t> leaf_hits;
+    if (fence_keys.empty()) {
+        return {};
+    }
+    for (const auto& range : heat) {
+        if (range.last_key < min_key || max_key < range.first_key) {
+            continue;
+        }
+        size_t first = static_cast<size_t>(
+            std::lower_bound(fence_keys.begin(), fence_keys.end(), range.first_key) - fence_keys.begin());
+        size_t last = static_cast<size_t>(
+            std::lower_bound(fence_keys.begin(), fence_keys.end(), range.last_key) - fence_keys.begin());
+        last = std::min(last, fence_keys.size() - 1);
+        for (size_t leaf = first; leaf <= last; leaf++) {
+            leaf_hits[leaf] += range.hits;
+        }
+    }
 
-    return result_sst->create_from_memtable(file_path, all_merged_data, target_level);
+    std::vector<std::pair<size_t, size_t>> leaves;
+    for (const auto& [leaf, hits] : leaf_hits) {
+        leaves.push_back({leaf_start_offset + leaf * PAGE_SIZE, hits});
+    }
+    return leaves;
 }
 
+template<typename K, typename V>
+bool SST<K, V>::preload_page(size_t page_offset) const {
+    char page_data[PAGE_SIZE];
+    return get_page_from_source(page_offset, page_data);
+}
 
 template<typename K, typename V>
 bool SST<K, V>::get(const K& key, V& value, SearchMode mode) const {
@@ -222,6 +330,53 @@ bool SST<K, V>::get(const K& key, V& value, SearchMode mode) const {
     }
 }
 
+template<typename K, typename V>
+size_t SST<K, V>::multi_get(const std::vector<K>& keys, std::vector<V>& values, std::vector<bool>& found) const {
+    values.resize(keys.size());
+    found.assign(keys.size(), false);
+    if (entry_count == 0 || fence_keys.empty()) {
+        return 0;
+    }
+
+    size_t hits = 0;
+    size_t i = 0;
+    char scratch[PAGE_SIZE];
+    while (i < keys.size()) {
+        if (keys[i] < min_key || max_key < keys[i] || !bloom_filter_contains(keys[i])) {
+            i++;
+            continue;
+        }
+
+        // this key's leaf also holds every following key up to the leaf's fence key
+        size_t leaf = static_cast<size_t>(
+            std::lower_bound(fence_keys.begin(), fence_keys.end(), keys[i]) - fence_keys.begin());
+        const char* page = get_page(leaf_start_offset + leaf * PAGE_SIZE, scratch);
+        if (!page) {
+            return hits;
+        }
+        const LeafNode<K, V>* leaf_node = reinterpret_cast<const LeafNode<K, V>*>(page);
+        const std::pair<K, V>* begin = leaf_node->pairs;
+        const std::pair<K, V>* end = leaf_node->pairs + leaf_node->count;
+
+        // keys[i] has passed the bloom filter above; only the keys after it are probed here
+        for (size_t first = i; i < keys.size() && !(fence_keys[leaf] < keys[i]); i++) {
+            if (i != first && !bloom_filter_contains(keys[i])) {
+                continue;
+            }
+            const std::pair<K, V>* pair = std::lower_bound(begin, end, keys[i],
+                [](const std::pair<K, V>& entry, const K& target) { return entry.first < target; });
+            if (pair != end && pair->first == keys[i]) {
+                values[i] = pair->second;
+                found[i] = true;
+                hits++;
+            }
+            // later keys are larger, so they cannot be before this one
+            begin = pair;
+        }
+    }
+    return hits;
+}
+
 template<typename K, typename V>
 std::vector<std::pair<K, V>> SST<K, V>::scan(const K& start_key, const K& end_key, SearchMode mode) const {
     std::vector<std::pair<K, V>> results;
@@ -230,16 +385,7 @@ std::vector<std::pair<K, V>> SST<K, V>::scan(const K& start_key, const K& end_ke
         return results;
     }
 
-    SSTHeader header;
-    char header_data[PAGE_SIZE];
-    // load page (first check buffer pool, then check disk)
-    if (!get_page_from_source(0, header_data)) {
-        return results;
-    }
-    header = *reinterpret_cast<SSTHeader*>(header_data);
-
-    size_t pairs_per_leaf = LeafNode<K,V>::PAIRS_COUNT;
-    size_t num_leaf_nodes = (header.entry_count + pairs_per_leaf - 1) / pairs_per_leaf;
+    size_t num_leaf_nodes = leaf_count;
     size_t current_leaf_offset = 0;
 
     // Find starting leaf with B-Tree search
@@ -248,7 +394,7 @@ std::vector<std::pair<K, V>> SST<K, V>::scan(const K& start_key, const K& end_ke
         // if the start key is smaller than any key, start from the first leaf node
         current_leaf_offset = find_leaf_node(start_key);
         if (current_leaf_offset == 0) {
-            current_leaf_offset = header.leaf_start_offset;
+            current_leaf_offset = leaf_start_offset;
         }
     }
 
@@ -260,13 +406,14 @@ std::vector<std::pair<K, V>> SST<K, V>::scan(const K& start_key, const K& end_ke
 
         while (left < right) {
             size_t mid = left + (right - left) / 2;
-            size_t page_offset = header.leaf_start_offset + (mid * PAGE_SIZE);
+            size_t page_offset = leaf_start_offset + (mid * PAGE_SIZE);
 
             char page_data[PAGE_SIZE];
-            if (!get_page_from_source(page_offset, page_data)) {
+            const char* page = get_page(page_offset, page_data);
+            if (!page) {
                 return results;
             }
-            LeafNode<K, V>* leaf_node = reinterpret_cast<LeafNode<K, V>*>(page_data);
+            const LeafNode<K, V>* leaf_node = reinterpret_cast<const LeafNode<K, V>*>(page);
 
             if (leaf_node->pairs[leaf_node->count - 1].first < start_key) {
                 left = mid + 1;
@@ -276,20 +423,25 @@ std::vector<std::pair<K, V>> SST<K, V>::scan(const K& start_key, const K& end_ke
             }
         }
         start_leaf_index = left;
-        current_leaf_offset = header.leaf_start_offset + (start_leaf_index * PAGE_SIZE);
+        current_leaf_offset = leaf_start_offset + (start_leaf_index * PAGE_SIZE);
     }
 
     // start scanning
-    size_t current_leaf_index = (current_leaf_offset - header.leaf_start_offset) / PAGE_SIZE;
+    size_t current_leaf_index = (current_leaf_offset - leaf_start_offset) / PAGE_SIZE;
     bool first_leaf_processed = false;
+    bool scan_done = false;
+
+    // The leaves in range are read front to back, so a mapping can read ahead
+    begin_mapped_scan();
 
     // scan through leaves
-    while (current_leaf_index < num_leaf_nodes) {
+    while (!scan_done && current_leaf_index < num_leaf_nodes) {
         char page_data[PAGE_SIZE];
-        if (!get_page_from_source(current_leaf_offset, page_data)) {
+        const char* page = get_page(current_leaf_offset, page_data);
+        if (!page) {
             break;
         }
-        LeafNode<K, V>* leaf_node = reinterpret_cast<LeafNode<K, V>*>(page_data);
+        const LeafNode<K, V>* leaf_node = reinterpret_cast<const LeafNode<K, V>*>(page);
 
         size_t start_pos_in_leaf = 0;
         // binary search to find starting position in leaf (only for first leaf)
@@ -313,14 +465,22 @@ std::vector<std::pair<K, V>> SST<K, V>::scan(const K& start_key, const K& end_ke
             }
             else {
                 // finished scan
-                return results;
+                scan_done = true;
+                break;
             }
         }
 
+        // the next leaf only holds larger keys
+        if (current_leaf_index < fence_keys.size() && !(fence_keys[current_leaf_index] < end_key)) {
+            break;
+        }
+
         // move to next leaf
         current_leaf_index++;
-        current_leaf_offset = header.leaf_start_offset + (current_leaf_index * PAGE_SIZE);
+        current_leaf_offset = leaf_start_offset + (current_leaf_index * PAGE_SIZE);
     }
+
+    end_mapped_scan();
     return results;
 }
 
@@ -332,10 +492,11 @@ bool SST<K, V>::b_tree_search(const K& key, V& value) const {
     }
 
     char page_data[PAGE_SIZE];
-    if (!get_page_from_source(leaf_node_offset, page_data)) {
+    const char* page = get_page(leaf_node_offset, page_data);
+    if (!page) {
         return false;
     }
-    LeafNode<K, V>* leaf_node = reinterpret_cast<LeafNode<K, V>*>(page_data);
+    const LeafNode<K, V>* leaf_node = reinterpret_cast<const LeafNode<K, V>*>(page);
 
     // binary search in leaf node
     size_t left = 0;
@@ -359,75 +520,64 @@ bool SST<K, V>::b_tree_search(const K& key, V& value) const {
     return false;
 }
 
+// Picks the leaf from the resident fence keys; returns 0 if the key is past the last leaf
 template<typename K, typename V>
 size_t SST<K, V>::find_leaf_node(const K& key) const {
-    SSTHeader header;
-    char header_data[PAGE_SIZE];
-    if (!get_page_from_source(0, header_data)) {
-        return -1;
+    auto it = std::lower_bound(fence_keys.begin(), fence_keys.end(), key);
+    if (it == fence_keys.end()) {
+        return 0;
     }
-    header = *reinterpret_cast<SSTHeader*>(header_data);
+    return leaf_start_offset + static_cast<size_t>(it - fence_keys.begin()) * PAGE_SIZE;
+}
 
-    char page_data[PAGE_SIZE];
-    if (!get_page_from_source(root_page_offset, page_data)) {
-        return -1;
+// The first level of internal nodes holds one separator (the largest key)
+// per leaf, in leaf order, so reading it once rebuilds the fence keys
+template<typename K, typename V>
+bool SST<K, V>::load_fence_keys() {
+    fence_keys.clear();
+    if (leaf_count == 0) {
+        return true;
+    }
+    if (leaf_count == 1) {
+        // the root is the only leaf
+        fence_keys.push_back(max_key);
+        return true;
     }
-    // root node
-    BTreeNode* current_node = reinterpret_cast<BTreeNode*>(page_data);
-
-    size_t current_offset = root_page_offset;
-
-    // while the current node is internal, binary search to find pointer to correct leaf within internal node
-    while (!current_node->is_leaf) {
-        InternalNode<K>* internal_node = reinterpret_cast<InternalNode<K>*>(current_node);
 
-        // binary search to find first value equal or greater than key
-        size_t left = 0;
-        size_t right = internal_node->count;
-        while (left < right) {
-            size_t mid = left + (right - left) / 2;
-            if (internal_node->keys[mid] < key) {
-                left = mid + 1;
-            } else {
-                right = mid;
-            }
-        }
-        size_t i = left;
+    size_t bottom_nodes = (leaf_count + InternalNode<K>::MAX_KEYS - 1) / InternalNode<K>::MAX_KEYS;
+    std::vector<char> pages(bottom_nodes * PAGE_SIZE);
+    if (!read_page_from_disk(internal_start_offset, pages.data(), pages.size())) {
+        return false;
+    }
 
-        current_offset = internal_node->children[i];
-        if (!get_page_from_source(current_offset, page_data)) {
-            return -1;
+    fence_keys.reserve(leaf_count);
+    for (size_t i = 0; i < bottom_nodes; i++) {
+        InternalNode<K>* node = reinterpret_cast<InternalNode<K>*>(pages.data() + i * PAGE_SIZE);
+        if (node->is_leaf || node->count > InternalNode<K>::MAX_KEYS) {
+            return false;
         }
-        current_node = reinterpret_cast<BTreeNode*>(page_data);
+        fence_keys.insert(fence_keys.end(), node->keys, node->keys + node->count);
     }
-
-    return current_offset;
+    return fence_keys.size() == leaf_count;
 }
 
 template<typename K, typename V>
 bool SST<K, V>::binary_search_file(const K& target_key, V& value) const {
-    SSTHeader header;
-    char header_data[PAGE_SIZE];
-    if (!get_page_from_source(0, header_data)) {
-        return false;
-    }
-    header = *reinterpret_cast<SSTHeader*>(header_data);
-
-    size_t pairs_per_leaf = LeafNode<K,V>::PAIRS_COUNT;
-    size_t num_leaf_nodes = (header.entry_count + pairs_per_leaf - 1) / pairs_per_leaf;
+    size_t num_leaf_nodes = leaf_count;
 
     size_t left = 0;
     size_t right = num_leaf_nodes;
 
     while (left < right) {
         size_t mid = left + (right - left) / 2;
-        size_t page_offset = header.leaf_start_offset + (mid * PAGE_SIZE);
+        size_t page_offset = leaf_start_offset + (mid * PAGE_SIZE);
 
         char page_data[PAGE_SIZE];
-        if (!get_page_from_source(page_offset, page_data)) {
+        const char* page = get_page(page_offset, page_data);
+        if (!page) {
             return false;
         }
-        LeafNode<K, V>* leaf_node = reinterpret_cast<LeafNode<K, V>*>(page_data);
+        const LeafNode<K, V>* leaf_node = reinterpret_cast<const LeafNode<K, V>*>(page);
 
         // last key in leaf less than target
         if (leaf_node->pairs[leaf_node->count - 1].first < target_key) {
@@ -439,12 +589,13 @@ bool SST<K, V>::binary_search_file(const K& target_key, V& value) const {
     }
 
     if (left < num_leaf_nodes) {
-        size_t page_offset = header.leaf_start_offset + (left * PAGE_SIZE);
+        size_t page_offset = leaf_start_offset + (left * PAGE_SIZE);
         char page_data[PAGE_SIZE];
-        if (!get_page_from_source(page_offset, page_data)) {
+        const char* page = get_page(page_offset, page_data);
+        if (!page) {
             return false;
         }
-        LeafNode<K, V>* leaf_node = reinterpret_cast<LeafNode<K, V>*>(page_data);
+        const LeafNode<K, V>* leaf_node = reinterpret_cast<const LeafNode<K, V>*>(page);
 
         // binary search within leaf node
         size_t l = 0;
@@ -468,24 +619,27 @@ bool SST<K, V>::binary_search_file(const K& target_key, V& value) const {
     return false;
 }
 
+// Opening reads the header page, the bloom filter and the fence keys straight
+// from disk, so it neither depends on nor fills the buffer pool
 template<typename K, typename V>
 bool SST<K, V>::load_existing_sst(const std::string& file_path,
                                  std::unique_ptr<SST<K, V>>& sst_ptr,
                                  BufferPool* bp) {
-    SSTHeader header;
+    SSTHeader<K> header;
     char header_data[PAGE_SIZE];
     SST<K, V> sst(file_path, bp);
-    if (!sst.get_page_from_source(0, header_data)) {
+    if (!sst.read_page_from_disk(0, header_data)) {
         // failed to load header
         return false;
     }
-    header = *reinterpret_cast<SSTHeader*>(header_data);
+    header = *reinterpret_cast<SSTHeader<K>*>(header_data);
 
     // Create a new SST object to populate header data
     sst_ptr = std::make_unique<SST<K, V>>(file_path, bp, header.level, header.false_positive_rate);
     sst_ptr->entry_count = header.entry_count;
     sst_ptr->root_page_offset = header.root_page_offset;
     sst_ptr->leaf_start_offset = header.leaf_start_offset;
+    sst_ptr->file_size = header.bloom_filter_offset + header.bloom_filter_size;
 
     // Load Bloom filter
     if (header.bloom_filter_size > 0) {
@@ -502,33 +656,161 @@ bool SST<K, V>::load_existing_sst(const std::string& file_path,
         );
     }
 
-    // populate min_key
-    if (header.entry_count > 0) {
-        char first_leaf_data[PAGE_SIZE];
-        if (sst.get_page_from_source(header.leaf_start_offset, first_leaf_data)) {
-            LeafNode<K, V>* first_leaf = reinterpret_cast<LeafNode<K, V>*>(first_leaf_data);
-            if (first_leaf->count > 0) {
-                sst_ptr->min_key = first_leaf->pairs[0].first;
-            }
+    if (header.has_key_range()) {
+        sst_ptr->format_version = header.format_version;
+        sst_ptr->leaf_count = header.leaf_count;
+        sst_ptr->internal_start_offset = header.internal_start_offset;
+        sst_ptr->internal_node_count = header.internal_node_count;
+        sst_ptr->min_key = header.min_key;
+        sst_ptr->max_key = header.max_key;
+        if (header.has_tombstone_count()) {
+            sst_ptr->tombstone_count = header.tombstone_count;
         }
+        return sst_ptr->load_fence_keys();
     }
 
-    // populate last_key
+    // Version 1 files: derive the layout, read min_key from the first leaf and
+    // take max_key from the fence keys
     size_t pairs_per_leaf = LeafNode<K,V>::PAIRS_COUNT;
-    size_t num_leaf_nodes = (header.entry_count + pairs_per_leaf - 1) / pairs_per_leaf;
-    size_t last_leaf_offset = header.leaf_start_offset + ((num_leaf_nodes - 1) * PAGE_SIZE);
+    sst_ptr->format_version = 1;
+    sst_ptr->leaf_count = (header.entry_count + pairs_per_leaf - 1) / pairs_per_leaf;
+    sst_ptr->internal_start_offset = header.leaf_start_offset + sst_ptr->leaf_count * PAGE_SIZE;
+    sst_ptr->internal_node_count = header.bloom_filter_offset > sst_ptr->internal_start_offset
+        ? (header.bloom_filter_offset - sst_ptr->internal_start_offset) / PAGE_SIZE : 0;
+
+    if (header.entry_count == 0) {
+        return true;
+    }
+
+    // populate min_key
+    char first_leaf_data[PAGE_SIZE];
+    if (sst.read_page_from_disk(header.leaf_start_offset, first_leaf_data)) {
+        LeafNode<K, V>* first_leaf = reinterpret_cast<LeafNode<K, V>*>(first_leaf_data);
+        if (first_leaf->count > 0) {
+            sst_ptr->min_key = first_leaf->pairs[0].first;
+        }
+    }
 
-    char last_leaf_data[PAGE_SIZE];
-    if (sst.get_page_from_source(last_leaf_offset, last_leaf_data)) {
-        LeafNode<K, V>* last_leaf = reinterpret_cast<LeafNode<K, V>*>(last_leaf_data);
-        if (last_leaf->count > 0) {
-            sst_ptr->max_key = last_leaf->pairs[last_leaf->count - 1].first;
+    // populate max_key: the last leaf's fence key, or the single leaf itself
+    if (sst_ptr->leaf_count == 1) {
+        LeafNode<K, V>* only_leaf = reinterpret_cast<LeafNode<K, V>*>(first_leaf_data);
+        if (only_leaf->count > 0) {
+            sst_ptr->max_key = only_leaf->pairs[only_leaf->count - 1].first;
         }
     }
+    if (!sst_ptr->load_fence_keys()) {
+        return false;
+    }
+    if (!sst_ptr->fence_keys.empty()) {
+        sst_ptr->max_key = sst_ptr->fence_keys.back();
+    }
 
     return true;
 }
 
+// Pages of a mapped SST are used in place; otherwise they are copied into
+// `scratch` through the buffer pool
+template<typename K, typename V>
+const char* SST<K, V>::get_page(size_t page_offset, char* scratch) const {
+    if (mapped_data && page_offset + PAGE_SIZE <= mapped_size) {
+        return mapped_data + page_offset;
+    }
+    return get_page_from_source(page_offset, scratch) ? scratch : nullptr;
+}
+
+template<typename K, typename V>
+bool SST<K, V>::set_read_mode(SSTReadMode mode) {
+    read_mode = mode;
+    if (mode == SSTReadMode::MMAP) {
+        return map_file();
+    }
+    unmap_file();
+    return true;
+}
+
+template<typename K, typename V>
+SSTReadMode SST<K, V>::get_read_mode() const {
+    return read_mode;
+}
+
+template<typename K, typename V>
+bool SST<K, V>::is_mapped() const {
+    return mapped_data != nullptr;
+}
+
+template<typename K, typename V>
+bool SST<K, V>::map_file() {
+    if (mapped_data || entry_count == 0) {
+        return true;
+    }
+
+    auto handle = FileTable::instance().acquire(filename);
+    struct stat file_stat;
+    if (!handle || ::fstat(handle->get_fd(), &file_stat) != 0 || file_stat.st_size == 0) {
+        return false;
+    }
+
+    // the mapping outlives the descriptor, so the file table may close it
+    void* data = ::mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED,
+                        handle->get_fd(), 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map SST file " << filename << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mapped_data = static_cast<const char*>(data);
+    mapped_size = static_cast<size_t>(file_stat.st_size);
+
+    // point lookups touch one leaf each, so read-ahead would only waste memory
+    advise(0, mapped_size, MADV_RANDOM);
+    return true;
+}
+
+template<typename K, typename V>
+void SST<K, V>::unmap_file() {
+    if (mapped_data) {
+        ::munmap(const_cast<char*>(mapped_data), mapped_size);
+        mapped_data = nullptr;
+        mapped_size = 0;
+    }
+}
+
+template<typename K, typename V>
+void SST<K, V>::advise(size_t offset, size_t length, int advice) const {
+    if (!mapped_data || length == 0 || offset >= mapped_size) {
+        return;
+    }
+
+    // madvise needs a start aligned to the system page size
+    size_t system_page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t aligned_offset = offset - (offset % system_page);
+    length = std::min(length + (offset - aligned_offset), mapped_size - aligned_offset);
+    ::madvise(const_cast<char*>(mapped_data) + aligned_offset, length, advice);
+}
+
+// The advice covers the whole mapping's leaves and is shared by every reader,
+// so only the first scan to start and the last to end change it
+template<typename K, typename V>
+void SST<K, V>::begin_mapped_scan() const {
+    if (!mapped_data) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(scan_advice_mutex);
+    if (active_mapped_scans++ == 0) {
+        advise(leaf_start_offset, leaf_count * PAGE_SIZE, MADV_SEQUENTIAL);
+    }
+}
+
+template<typename K, typename V>
+void SST<K, V>::end_mapped_scan() const {
+    if (!mapped_data) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(scan_advice_mutex);
+    if (active_mapped_scans > 0 && --active_mapped_scans == 0) {
+        advise(leaf_start_offset, leaf_count * PAGE_SIZE, MADV_RANDOM);
+    }
+}
+
 // scans buffer pool for page, then scans disk
 template<typename K, typename V>
 bool SST<K, V>::get_page_from_source(size_t page_offset, char* page_data) const {
@@ -571,6 +853,46 @@ size_t SST<K, V>::get_level() const {
     return level;
 }
 
+template<typename K, typename V>
+size_t SST<K, V>::get_leaf_count() const {
+    return leaf_count;
+}
+
+template<typename K, typename V>
+size_t SST<K, V>::get_file_size() const {
+    return file_size;
+}
+
+template<typename K, typename V>
+size_t SST<K, V>::get_tombstone_count() const {
+    return tombstone_count;
+}
+
+template<typename K, typename V>
+double SST<K, V>::get_false_positive_rate() const {
+    return bloom_filter_fpr;
+}
+
+template<typename K, typename V>
+void SST<K, V>::set_level(size_t sst_level) {
+    level = sst_level;
+}
+
+template<typename K, typename V>
+uint64_t SST<K, V>::get_run_id() const {
+    return run_id;
+}
+
+template<typename K, typename V>
+void SST<K, V>::set_run_id(uint64_t id) {
+    run_id = id;
+}
+
+template<typename K, typename V>
+uint32_t SST<K, V>::get_format_version() const {
+    return format_version;
+}
+
 template<typename K, typename V>
 bool SST<K, V>::bloom_filter_contains(const K& key) const {
     if (bloom_filter) {
@@ -584,69 +906,78 @@ bool SST<K, V>::is_valid() const {
     return entry_count > 0 && !filename.empty();
 }
 
+template<typename K, typename V>
+bool SST<K, V>::sync_file() const {
+    auto handle = FileTable::instance().acquire(filename);
+    return handle && ::fsync(handle->get_fd()) == 0;
+}
+
+template<typename K, typename V>
+bool SST<K, V>::remove_file(const std::string& file_path) {
+    FileTable::instance().evict(file_path);
+    std::error_code ec;
+    return std::filesystem::remove(file_path, ec);
+}
+
 // Page I/O helper methods
 template<typename K, typename V>
 bool SST<K, V>::read_page_from_disk(size_t page_offset, char* page_data, size_t bytes_to_read) const {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+    auto handle = FileTable::instance().acquire(filename);
+    if (!handle) {
         return false;
     }
 
-    file.seekg(page_offset);
-    file.read(page_data, bytes_to_read);
+    size_t total_read = 0;
+    while (total_read < bytes_to_read) {
+        ssize_t n = ::pread(handle->get_fd(), page_data + total_read, bytes_to_read - total_read,
+                            static_cast<off_t>(page_offset + total_read));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        total_read += static_cast<size_t>(n);
+    }
 
     // Handle partial reads at EOF gracefully
-    if (static_cast<size_t>(file.gcount()) < bytes_to_read) {
+    if (total_read < bytes_to_read) {
         // Zero out the rest of the page
-        std::memset(page_data + file.gcount(), 0, bytes_to_read - static_cast<size_t>(file.gcount()));
+        std::memset(page_data + total_read, 0, bytes_to_read - total_read);
     }
-
-    file.close();
     return true;
 }
 
 template<typename K, typename V>
-bool SST<K, V>::write_page_to_disk(size_t page_offset, const char* page_data, size_t bytes_to_write) const {
-    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
-    if (!file.is_open()) {
-        file.clear();
-        // Create file
-        file.open(filename, std::ios::binary | std::ios::out);
-        if (!file.is_open()) {
-            // Failed to create
-            return false;
-        }
-        file.close(); // Close and reopen in read/write mode
-        file.open(filename, std::ios::binary | std::ios::in | std::ios::out);
-        if (!file.is_open()) {
+bool SST<K, V>::pwrite_all(int fd, size_t offset, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             return false;
         }
+        data += n;
+        offset += static_cast<size_t>(n);
+        length -= static_cast<size_t>(n);
     }
-
-    file.seekp(page_offset);
-    file.write(page_data, bytes_to_write);
-    if (file.fail()) {
-        file.close();
-        return false;
-    }
-
-    file.close();
     return true;
 }
 
+// page_offset is a byte offset, like the PageID offsets handed to the buffer pool
 template<typename K, typename V>
 bool SST<K, V>::write_page_to_file(const std::string& filename,
                                    size_t page_offset,
                                    const char* page_data) {
-    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
-    if (!file.is_open()) {
+    auto handle = FileTable::instance().acquire(filename);
+    if (!handle) {
         return false;
     }
-
-    file.seekp(page_offset * PAGE_SIZE);
-    file.write(page_data, PAGE_SIZE);
-    file.close();
-    return true;
+    return pwrite_all(handle->get_fd(), page_offset, page_data, PAGE_SIZE);
 }
 
 
@@ -5,17 +5,77 @@
 #include <vector>
 #include <fstream>
 #include <utility>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
 #include "../buffer/buffer_pool.h"
 #include "../filter/bloom_filter.h"
+#include "file_table.h"
 
 class BufferPool;
+class RateLimiter;
+
+template<typename K, typename V>
+class SSTBuilder;
+
+template<typename K, typename V>
+class SSTIterator;
+
+template<typename K, typename V>
+class SSTCursor;
 
 enum class SearchMode {
     B_TREE_SEARCH,
     BINARY_SEARCH
 };
 
-struct SSTHeader {
+// How SST pages are read: copied through the buffer pool, or used in place
+// from a read-only memory mapping of the file
+enum class SSTReadMode {
+    BUFFER_POOL,
+    MMAP
+};
+
+// Marks headers that carry the fields after bloom_filter_num_bits. Files
+// written before them have uninitialized bytes there.
+constexpr uint64_t SST_HEADER_MAGIC = 0x3230545353444b4cULL;
+constexpr uint32_t SST_FORMAT_VERSION = 3;
+
+// Value that marks a deleted key. It shadows older versions of the key until
+// a compaction writes it into the last level that could hold one.
+template<typename V>
+constexpr V tombstone_value() {
+    return std::numeric_limits<V>::min();
+}
+
+// Keys of a leaf that was cached when its SST was dropped, and how often it was read
+template<typename K>
+struct LeafHeat {
+    K first_key;
+    K last_key;
+    size_t hits;
+};
+
+// How SST::create_from_merge writes its output
+struct SSTMergeOptions {
+    // A new output file is started once one holds this many bytes of leaves (0 = one file)
+    size_t max_file_size = 0;
+    // Large merges are split by key range into up to this many parts, each
+    // merged on its own thread; a part is at least one output file's worth of leaves
+    size_t max_subcompactions = 1;
+    // Leave deleted keys out entirely; only safe when no older version of
+    // them exists outside the inputs
+    bool drop_tombstones = false;
+    // Bloom filter rate and buffer pool of the output files
+    double false_positive_rate = 0.01;
+    BufferPool* buffer_pool = nullptr;
+    // Paces reads and writes if given
+    RateLimiter* limiter = nullptr;
+};
+
+template<typename K>
+struct SSTHeaderFields {
     size_t root_page_offset;
     size_t leaf_start_offset;
     size_t entry_count;
@@ -25,7 +85,31 @@ struct SSTHeader {
     size_t bloom_filter_size;
     size_t bloom_filter_num_hash_functions;
     size_t bloom_filter_num_bits;
-    char padding[PAGE_SIZE - (8 * sizeof(size_t) + sizeof(double))];
+
+    // Format version 2: everything needed to open the SST from this page alone
+    uint64_t magic;
+    uint32_t format_version;
+    size_t leaf_count;
+    size_t internal_start_offset;
+    size_t internal_node_count;
+    K min_key;
+    K max_key;
+
+    // Format version 3
+    size_t tombstone_count;
+};
+
+template<typename K>
+struct SSTHeader : public SSTHeaderFields<K> {
+    char padding[PAGE_SIZE - sizeof(SSTHeaderFields<K>)];
+
+    bool has_key_range() const {
+        return this->magic == SST_HEADER_MAGIC && this->format_version >= 2;
+    }
+
+    bool has_tombstone_count() const {
+        return this->magic == SST_HEADER_MAGIC && this->format_version >= 3;
+    }
 };
 
 struct BTreeNode {
@@ -54,6 +138,10 @@ struct LeafNode : public BTreeNode {
 
 template<typename K, typename V>
 class SST {
+    friend class SSTBuilder<K, V>;
+    friend class SSTIterator<K, V>;
+    friend class SSTCursor<K, V>;
+
 private:
     std::string filename;
     size_t entry_count;
@@ -65,6 +153,26 @@ private:
     size_t leaf_start_offset;
     std::unique_ptr<BloomFilter<K>> bloom_filter;
     double bloom_filter_fpr;
+    uint32_t format_version;
+    size_t leaf_count;
+    size_t internal_start_offset;
+    size_t internal_node_count;
+    size_t file_size;
+    // Entries holding tombstone_value(); 0 for files older than format version 3
+    size_t tombstone_count;
+    // Sorted run this SST belongs to within its level; the manifest records it
+    uint64_t run_id;
+    // Largest key of every leaf, in leaf order. Kept in memory so a point
+    // lookup reads only the one leaf that can hold the key.
+    std::vector<K> fence_keys;
+
+    SSTReadMode read_mode;
+    const char* mapped_data;
+    size_t mapped_size;
+    // Scans running on the mapping. The leaves are advised sequential while
+    // any runs, and random again once the last one ends.
+    mutable std::mutex scan_advice_mutex;
+    mutable size_t active_mapped_scans;
 
     struct SSTEntry {
         K key;
@@ -78,11 +186,27 @@ private:
 
     bool b_tree_search(const K& key, V& value) const;
     size_t find_leaf_node(const K& key) const;
+    bool load_fence_keys();
 
     // Page I/O helpers
     bool read_page_from_disk(size_t page_offset, char* page_data, size_t bytes_to_read = PAGE_SIZE) const;
-    bool write_page_to_disk(size_t page_offset, const char* page_data, size_t bytes_to_write = PAGE_SIZE) const;
     bool get_page_from_source(size_t page_offset, char* page_data) const;
+    const char* get_page(size_t page_offset, char* scratch) const;
+    bool map_file();
+    void unmap_file();
+    void advise(size_t offset, size_t length, int advice) const;
+    void begin_mapped_scan() const;
+    void end_mapped_scan() const;
+    static bool pwrite_all(int fd, size_t offset, const char* data, size_t length);
+
+    // Key boundaries that cut the inputs into `partitions` ranges of about as
+    // many leaves each, taken from the inputs' fence keys
+    static std::vector<K> choose_split_keys(const std::vector<SST<K, V>*>& inputs, size_t partitions);
+    // Merges the entries with keys in (lower, upper]; a null bound is open
+    static bool merge_range(const std::function<std::string()>& next_file_path,
+                            const std::vector<SST<K, V>*>& inputs, size_t target_level,
+                            std::vector<std::unique_ptr<SST<K, V>>>& outputs, const SSTMergeOptions& options,
+                            const K* lower, const K* upper, size_t expected_entries);
 
 
 public:
@@ -93,13 +217,29 @@ public:
                              const std::vector<std::pair<K, V>>& sorted_data,
                              size_t sst_level = 0);
 
-    static bool create_from_merge(const std::string& file_path,
-                                  SST<K, V>* sst1,
-                                  SST<K, V>* sst2,
+    // Merges `inputs`, ordered oldest to newest, into one sorted run of new
+    // SSTs named by `next_file_path`. On equal keys the newest input wins. On
+    // failure no output file is left behind.
+    static bool create_from_merge(const std::function<std::string()>& next_file_path,
+                                  const std::vector<SST<K, V>*>& inputs,
                                   size_t target_level,
-                                  std::unique_ptr<SST<K, V>>& result_sst);
+                                  std::vector<std::unique_ptr<SST<K, V>>>& outputs,
+                                  const SSTMergeOptions& options = SSTMergeOptions());
+
+    // Drops this SST's pages from the buffer pool at once and returns the key
+    // range and read count of each leaf that was cached
+    std::vector<LeafHeat<K>> drop_cached_pages();
+    // Offsets of this SST's leaves that cover the keys in `heat`, each with
+    // the reads of the ranges it covers
+    std::vector<std::pair<size_t, size_t>> map_leaf_heat(const std::vector<LeafHeat<K>>& heat) const;
+    // Reads a page into the buffer pool ahead of use
+    bool preload_page(size_t page_offset) const;
 
     bool get(const K& key, V& value, SearchMode mode) const;
+    // Looks up `keys`, which must be sorted, skipping those the bloom filter
+    // rules out. Keys that land in the same leaf share one read of it. Sets
+    // found[i] and values[i] for every key present and returns how many were.
+    size_t multi_get(const std::vector<K>& keys, std::vector<V>& values, std::vector<bool>& found) const;
     std::vector<std::pair<K, V>> scan(const K& start_key, const K& end_key, SearchMode mode) const;
 
     const std::string& get_filename() const;
@@ -107,8 +247,28 @@ public:
     const K& get_min_key() const;
     const K& get_max_key() const;
     size_t get_level() const;
+    // Moves the SST to another level in memory only; the manifest records
+    // where a file lives, so the header keeps the level it was written for
+    void set_level(size_t sst_level);
+    size_t get_leaf_count() const;
+    // Bytes on disk, through the end of the bloom filter
+    size_t get_file_size() const;
+    size_t get_tombstone_count() const;
+    double get_false_positive_rate() const;
+    uint64_t get_run_id() const;
+    void set_run_id(uint64_t id);
+    uint32_t get_format_version() const;
+
+    // MMAP maps the file now; reads then bypass the buffer pool
+    bool set_read_mode(SSTReadMode mode);
+    SSTReadMode get_read_mode() const;
+    bool is_mapped() const;
 
     bool is_valid() const;
+    // fsync the SST file so data that only lives in the WAL can be dropped
+    bool sync_file() const;
+    // Deletes an SST file and closes any handle the file table holds for it
+    static bool remove_file(const std::string& file_path);
 
     static bool load_existing_sst(const std::string& file_path,
                                   std::unique_ptr<SST<K, V>>& sst_ptr,
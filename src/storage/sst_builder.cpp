@@ -0,0 +1,290 @@
+#ifndef SST_BUILDER_CPP
+#define SST_BUILDER_CPP
+
+#include "sst_builder.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+template<typename K, typename V>
+SSTBuilder<K, V>::SSTBuilder(const std::string& file_path, size_t sst_level, double false_positive_rate,
+                             size_t expected_entries, RateLimiter* rate_limiter)
+    : filename(file_path), level(sst_level), bloom_filter_fpr(false_positive_rate), fd(-1), failed(false),
+      limiter(rate_limiter),
+      buffer_capacity(0), buffer_used(0), buffer_file_offset(0), entry_count(0), tombstone_count(0),
+      current_leaf(nullptr), leaf_count(0) {
+    // a cached handle could still point at an older, deleted file of the same name
+    FileTable::instance().evict(filename);
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create SST file " << filename << ": " << std::strerror(errno) << std::endl;
+        failed = true;
+        return;
+    }
+
+    size_t expected_leaves = (expected_entries + LeafNode<K, V>::PAIRS_COUNT - 1) / LeafNode<K, V>::PAIRS_COUNT;
+    size_t expected_internal = expected_leaves / InternalNode<K>::MAX_KEYS + 1;
+    bloom_filter = std::make_unique<BloomFilter<K>>(std::max<size_t>(expected_entries, 1), false_positive_rate);
+    size_t bloom_bytes = (bloom_filter->num_bits + 7) / 8;
+    size_t expected_bytes = (1 + expected_leaves + expected_internal) * PAGE_SIZE + bloom_bytes;
+
+    // reserve the blocks up front without changing the file size
+    ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(expected_bytes));
+
+    buffer_capacity = std::min(SST_BUILDER_BUFFER_SIZE, (expected_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE);
+    buffer.reset(static_cast<char*>(std::aligned_alloc(PAGE_SIZE, buffer_capacity)));
+    if (!buffer) {
+        failed = true;
+        return;
+    }
+
+    // page 0 is the header, written once everything else is in place
+    std::memset(next_page(), 0, PAGE_SIZE);
+}
+
+template<typename K, typename V>
+SSTBuilder<K, V>::~SSTBuilder() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+template<typename K, typename V>
+bool SSTBuilder<K, V>::is_open() const {
+    return !failed;
+}
+
+template<typename K, typename V>
+bool SSTBuilder<K, V>::flush_buffer() {
+    const char* data = buffer.get();
+    size_t remaining = buffer_used;
+    size_t offset = buffer_file_offset;
+    if (limiter && remaining > 0) {
+        limiter->request(remaining);
+    }
+    while (remaining > 0) {
+        ssize_t written = ::pwrite(fd, data, remaining, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Failed to write SST file " << filename << ": " << std::strerror(errno) << std::endl;
+            failed = true;
+            return false;
+        }
+        data += written;
+        offset += static_cast<size_t>(written);
+        remaining -= static_cast<size_t>(written);
+    }
+
+    // start write-back now so the final fsync has little left to do
+    ::sync_file_range(fd, static_cast<off_t>(buffer_file_offset), static_cast<off_t>(buffer_used),
+                      SYNC_FILE_RANGE_WRITE);
+    buffer_file_offset += buffer_used;
+    buffer_used = 0;
+    return true;
+}
+
+// Returns the next page slot in the write buffer, flushing the buffer first if it is full
+template<typename K, typename V>
+char* SSTBuilder<K, V>::next_page() {
+    if (buffer_used + PAGE_SIZE > buffer_capacity && !flush_buffer()) {
+        return nullptr;
+    }
+    char* page = buffer.get() + buffer_used;
+    buffer_used += PAGE_SIZE;
+    return page;
+}
+
+template<typename K, typename V>
+bool SSTBuilder<K, V>::append(const char* data, size_t length) {
+    while (length > 0) {
+        if (buffer_used == buffer_capacity && !flush_buffer()) {
+            return false;
+        }
+        size_t chunk = std::min(length, buffer_capacity - buffer_used);
+        std::memcpy(buffer.get() + buffer_used, data, chunk);
+        buffer_used += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+// Adds a child pointer to the open node of an internal level. When that node
+// fills up, a new one is opened and the full node's largest key moves up a level.
+template<typename K, typename V>
+void SSTBuilder<K, V>::add_child(size_t internal_level, const K& separator, size_t child_index) {
+    if (internal_levels.size() <= internal_level) {
+        internal_levels.emplace_back();
+    }
+
+    auto& nodes = internal_levels[internal_level];
+    if (nodes.empty() || nodes.back().count == InternalNode<K>::MAX_KEYS) {
+        if (!nodes.empty()) {
+            add_child(internal_level + 1, nodes.back().keys[nodes.back().count - 1], nodes.size() - 1);
+        }
+        internal_levels[internal_level].emplace_back();
+        InternalNode<K>& node = internal_levels[internal_level].back();
+        std::memset(static_cast<void*>(&node), 0, sizeof(InternalNode<K>));
+        node.is_leaf = false;
+        node.count = 0;
+    }
+
+    InternalNode<K>& node = internal_levels[internal_level].back();
+    node.keys[node.count] = separator;
+    node.children[node.count] = child_index;
+    node.count++;
+}
+
+template<typename K, typename V>
+void SSTBuilder<K, V>::finish_leaf() {
+    K fence_key = current_leaf->pairs[current_leaf->count - 1].first;
+    fence_keys.push_back(fence_key);
+    add_child(0, fence_key, leaf_count);
+    leaf_count++;
+    current_leaf = nullptr;
+}
+
+template<typename K, typename V>
+bool SSTBuilder<K, V>::add(const K& key, const V& value) {
+    if (failed) {
+        return false;
+    }
+
+    if (!current_leaf) {
+        char* page = next_page();
+        if (!page) {
+            return false;
+        }
+        std::memset(page, 0, PAGE_SIZE);
+        current_leaf = reinterpret_cast<LeafNode<K, V>*>(page);
+        current_leaf->is_leaf = true;
+        current_leaf->count = 0;
+    }
+
+    current_leaf->pairs[current_leaf->count++] = {key, value};
+    bloom_filter->add(key);
+    if (entry_count == 0) {
+        min_key = key;
+    }
+    max_key = key;
+    entry_count++;
+    if (value == tombstone_value<V>()) {
+        tombstone_count++;
+    }
+
+    if (current_leaf->count == LeafNode<K, V>::PAIRS_COUNT) {
+        finish_leaf();
+    }
+    return true;
+}
+
+template<typename K, typename V>
+bool SSTBuilder<K, V>::finish(SST<K, V>& sst) {
+    if (failed || entry_count == 0) {
+        return false;
+    }
+    if (current_leaf) {
+        finish_leaf();
+    }
+
+    const size_t leaf_start_offset = PAGE_SIZE;
+    const size_t internal_start_offset = leaf_start_offset + leaf_count * PAGE_SIZE;
+    size_t root_page_offset = leaf_start_offset;
+    size_t internal_node_count = 0;
+
+    // A single leaf is its own root. Otherwise close the levels bottom-up: a
+    // level with more than one node still owes its last node to the level above.
+    if (leaf_count == 1) {
+        internal_levels.clear();
+    } else {
+        for (size_t i = 0; i < internal_levels.size() && internal_levels[i].size() > 1; i++) {
+            const auto& last = internal_levels[i].back();
+            add_child(i + 1, last.keys[last.count - 1], internal_levels[i].size() - 1);
+        }
+    }
+
+    // Levels are stored bottom-up after the leaves; turn child indexes into offsets
+    size_t level_offset = internal_start_offset;
+    size_t child_level_offset = leaf_start_offset;
+    for (auto& nodes : internal_levels) {
+        for (auto& node : nodes) {
+            for (size_t c = 0; c < node.count; c++) {
+                node.children[c] = child_level_offset + node.children[c] * PAGE_SIZE;
+            }
+            if (!append(reinterpret_cast<const char*>(&node), PAGE_SIZE)) {
+                return false;
+            }
+        }
+        root_page_offset = level_offset;
+        child_level_offset = level_offset;
+        level_offset += nodes.size() * PAGE_SIZE;
+        internal_node_count += nodes.size();
+    }
+
+    // Bloom filter begins after all internal nodes, padded to whole pages
+    size_t bloom_filter_offset = level_offset;
+    size_t num_bytes = (bloom_filter->num_bits + 7) / 8;
+    size_t bloom_filter_size = ((num_bytes + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    std::vector<char> bloom_filter_data(bloom_filter_size, 0);
+    for (size_t i = 0; i < bloom_filter->num_bits; ++i) {
+        if (bloom_filter->bit_array[i]) {
+            bloom_filter_data[i / 8] |= (1 << (i % 8));
+        }
+    }
+    if (!append(bloom_filter_data.data(), bloom_filter_size) || !flush_buffer()) {
+        return false;
+    }
+
+    SSTHeader<K> header{};
+    header.root_page_offset = root_page_offset;
+    header.leaf_start_offset = leaf_start_offset;
+    header.entry_count = entry_count;
+    header.level = level;
+    header.false_positive_rate = bloom_filter_fpr;
+    header.bloom_filter_offset = bloom_filter_offset;
+    header.bloom_filter_size = bloom_filter_size;
+    header.bloom_filter_num_hash_functions = bloom_filter->num_hash_functions;
+    header.bloom_filter_num_bits = bloom_filter->num_bits;
+    header.magic = SST_HEADER_MAGIC;
+    header.format_version = SST_FORMAT_VERSION;
+    header.leaf_count = leaf_count;
+    header.internal_start_offset = internal_start_offset;
+    header.internal_node_count = internal_node_count;
+    header.min_key = min_key;
+    header.max_key = max_key;
+    header.tombstone_count = tombstone_count;
+    if (::pwrite(fd, &header, sizeof(SSTHeader<K>), 0) != static_cast<ssize_t>(sizeof(SSTHeader<K>))) {
+        failed = true;
+        return false;
+    }
+
+    sst.filename = filename;
+    sst.level = level;
+    sst.bloom_filter_fpr = bloom_filter_fpr;
+    sst.entry_count = entry_count;
+    sst.min_key = min_key;
+    sst.max_key = max_key;
+    sst.root_page_offset = root_page_offset;
+    sst.leaf_start_offset = leaf_start_offset;
+    sst.format_version = SST_FORMAT_VERSION;
+    sst.leaf_count = leaf_count;
+    sst.internal_start_offset = internal_start_offset;
+    sst.internal_node_count = internal_node_count;
+    sst.file_size = bloom_filter_offset + bloom_filter_size;
+    sst.tombstone_count = tombstone_count;
+    sst.fence_keys = std::move(fence_keys);
+    sst.bloom_filter = std::move(bloom_filter);
+    return true;
+}
+
+template<typename K, typename V>
+size_t SSTBuilder<K, V>::get_entry_count() const {
+    return entry_count;
+}
+
+#endif
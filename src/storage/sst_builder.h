@@ -0,0 +1,78 @@
+#ifndef SST_BUILDER_H
+#define SST_BUILDER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include "sst.h"
+#include "rate_limiter.h"
+
+// Largest write issued by the builder; small SSTs get a smaller buffer
+constexpr size_t SST_BUILDER_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// Writes an SST front to back from keys added in ascending order. Pages are
+// laid out in a page-aligned buffer that is written in large sequential
+// chunks, and the internal B-tree levels grow as leaves complete, so memory
+// use does not depend on the number of entries apart from the internal nodes,
+// the fence keys and the bloom filter. The header goes to page 0 last.
+template<typename K, typename V>
+class SSTBuilder {
+private:
+    struct FreeDeleter {
+        void operator()(char* ptr) const { std::free(ptr); }
+    };
+
+    std::string filename;
+    size_t level;
+    double bloom_filter_fpr;
+    int fd;
+    bool failed;
+    RateLimiter* limiter;
+
+    std::unique_ptr<char, FreeDeleter> buffer;
+    size_t buffer_capacity;
+    size_t buffer_used;
+    size_t buffer_file_offset;   // file offset of buffer[0]
+
+    std::unique_ptr<BloomFilter<K>> bloom_filter;
+    size_t entry_count;
+    size_t tombstone_count;
+    K min_key;
+    K max_key;
+
+    LeafNode<K, V>* current_leaf;
+    size_t leaf_count;
+    std::vector<K> fence_keys;
+
+    // Internal nodes per level; children hold indexes into the level below
+    // until finish() knows where each level lands in the file
+    std::vector<std::vector<InternalNode<K>>> internal_levels;
+
+    char* next_page();
+    bool append(const char* data, size_t length);
+    bool flush_buffer();
+    void finish_leaf();
+    void add_child(size_t internal_level, const K& separator, size_t child_index);
+
+public:
+    SSTBuilder(const std::string& file_path, size_t sst_level, double false_positive_rate,
+               size_t expected_entries, RateLimiter* rate_limiter = nullptr);
+    ~SSTBuilder();
+
+    SSTBuilder(const SSTBuilder&) = delete;
+    SSTBuilder& operator=(const SSTBuilder&) = delete;
+
+    bool is_open() const;
+    // Keys must arrive in strictly ascending order
+    bool add(const K& key, const V& value);
+    // Writes the internal nodes, bloom filter and header, and hands the
+    // finished file's metadata to `sst`
+    bool finish(SST<K, V>& sst);
+
+    size_t get_entry_count() const;
+};
+
+#include "sst_builder.cpp"
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef SST_CURSOR_CPP
+#define SST_CURSOR_CPP
+
+#include "sst_cursor.h"
+#include <algorithm>
+
+template<typename K, typename V>
+SSTCursor<K, V>::SSTCursor()
+    : sst(nullptr), leaf(nullptr), leaf_index(0), position_in_leaf(0), error(false) {}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::reset(const SST<K, V>* source) {
+    sst = source;
+    leaf = nullptr;
+    leaf_index = 0;
+    position_in_leaf = 0;
+    error = false;
+}
+
+template<typename K, typename V>
+bool SSTCursor<K, V>::load_leaf(size_t index) {
+    leaf = nullptr;
+    position_in_leaf = 0;
+    leaf_index = index;
+    if (!sst || index >= sst->leaf_count) {
+        return false;
+    }
+
+    const char* page = sst->get_page(sst->leaf_start_offset + index * PAGE_SIZE, scratch);
+    if (!page) {
+        error = true;
+        return false;
+    }
+    leaf = reinterpret_cast<const LeafNode<K, V>*>(page);
+    return true;
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::skip_empty_leaves() {
+    while (leaf && position_in_leaf >= leaf->count) {
+        load_leaf(leaf_index + 1);
+    }
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::step_back_from(size_t position) {
+    position_in_leaf = position;
+    while (leaf && position_in_leaf == 0) {
+        if (leaf_index == 0) {
+            leaf = nullptr;
+            return;
+        }
+        if (load_leaf(leaf_index - 1)) {
+            position_in_leaf = leaf->count;
+        }
+    }
+    if (leaf) {
+        position_in_leaf--;
+    }
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::seek_to_first() {
+    if (sst && sst->entry_count > 0) {
+        load_leaf(0);
+        skip_empty_leaves();
+    }
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::seek(const K& key) {
+    if (!sst || sst->entry_count == 0) {
+        return;
+    }
+    const auto& fences = sst->fence_keys;
+    size_t index = static_cast<size_t>(std::lower_bound(fences.begin(), fences.end(), key) - fences.begin());
+    if (!load_leaf(index)) {
+        return;
+    }
+    const auto* begin = leaf->pairs;
+    const auto* end = leaf->pairs + leaf->count;
+    position_in_leaf = static_cast<size_t>(std::lower_bound(begin, end, key,
+        [](const std::pair<K, V>& pair, const K& target) { return pair.first < target; }) - begin);
+    skip_empty_leaves();
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::seek_to_last() {
+    if (sst && sst->entry_count > 0 && load_leaf(sst->leaf_count - 1)) {
+        step_back_from(leaf->count);
+    }
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::seek_for_prev(const K& key) {
+    if (!sst || sst->entry_count == 0) {
+        return;
+    }
+    // the leaf that would hold `key`; the last one if every key is smaller
+    const auto& fences = sst->fence_keys;
+    size_t index = static_cast<size_t>(std::lower_bound(fences.begin(), fences.end(), key) - fences.begin());
+    if (!load_leaf(std::min(index, sst->leaf_count - 1))) {
+        return;
+    }
+    const auto* begin = leaf->pairs;
+    const auto* end = leaf->pairs + leaf->count;
+    step_back_from(static_cast<size_t>(std::upper_bound(begin, end, key,
+        [](const K& target, const std::pair<K, V>& pair) { return target < pair.first; }) - begin));
+}
+
+template<typename K, typename V>
+bool SSTCursor<K, V>::valid() const {
+    return leaf != nullptr;
+}
+
+template<typename K, typename V>
+const K& SSTCursor<K, V>::key() const {
+    return leaf->pairs[position_in_leaf].first;
+}
+
+template<typename K, typename V>
+const V& SSTCursor<K, V>::value() const {
+    return leaf->pairs[position_in_leaf].second;
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::next() {
+    if (!leaf) {
+        return;
+    }
+    position_in_leaf++;
+    skip_empty_leaves();
+}
+
+template<typename K, typename V>
+void SSTCursor<K, V>::prev() {
+    if (leaf) {
+        step_back_from(position_in_leaf);
+    }
+}
+
+template<typename K, typename V>
+bool SSTCursor<K, V>::has_error() const {
+    return error;
+}
+
+#endif
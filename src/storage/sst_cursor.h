@@ -0,0 +1,53 @@
+#ifndef SST_CURSOR_H
+#define SST_CURSOR_H
+
+#include "sst.h"
+
+// Walks an SST in key order from a seek position, one entry at a time in
+// either direction. Leaves are read on demand through the SST's read mode (the
+// buffer pool or the mapping), one page at a time, so a cursor costs only the
+// pages the caller walks over. A seek finds its leaf through the fence keys;
+// leaves are contiguous, so stepping back past a leaf reads the page before it.
+template<typename K, typename V>
+class SSTCursor {
+private:
+    const SST<K, V>* sst;
+    char scratch[PAGE_SIZE];
+    const LeafNode<K, V>* leaf;
+    size_t leaf_index;
+    size_t position_in_leaf;
+    bool error;
+
+    bool load_leaf(size_t index);
+    void skip_empty_leaves();
+    // Moves to the entry before `position` of the current leaf, going back
+    // through earlier leaves if needed
+    void step_back_from(size_t position);
+
+public:
+    SSTCursor();
+    SSTCursor(const SSTCursor&) = delete;
+    SSTCursor& operator=(const SSTCursor&) = delete;
+
+    // Points the cursor at `source`; it is not valid until a seek
+    void reset(const SST<K, V>* source);
+    void seek_to_first();
+    // Moves to the first entry whose key is not less than `key`
+    void seek(const K& key);
+    void seek_to_last();
+    // Moves to the last entry whose key is not greater than `key`
+    void seek_for_prev(const K& key);
+
+    bool valid() const;
+    const K& key() const;
+    const V& value() const;
+    void next();
+    void prev();
+
+    // True if a read failed; the cursor then reports !valid()
+    bool has_error() const;
+};
+
+#include "sst_cursor.cpp"
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SST_ITERATOR_CPP
+#define SST_ITERATOR_CPP
+
+#include "sst_iterator.h"
+#include <algorithm>
+#include <fcntl.h>
+
+template<typename K, typename V>
+SSTIterator<K, V>::SSTIterator(const SST<K, V>& source, size_t readahead, RateLimiter* rate_limiter)
+    : sst(&source), limiter(rate_limiter), readahead_pages(readahead == 0 ? 1 : readahead), next_leaf(0), buffered_leaves(0),
+      leaf_in_buffer(0), position_in_leaf(0), error(false) {
+    if (sst->entry_count == 0) {
+        return;
+    }
+
+    // the whole leaf range is read once, front to back
+    auto handle = FileTable::instance().acquire(sst->filename);
+    if (handle) {
+        ::posix_fadvise(handle->get_fd(), static_cast<off_t>(sst->leaf_start_offset),
+                        static_cast<off_t>(sst->leaf_count * PAGE_SIZE), POSIX_FADV_SEQUENTIAL);
+    }
+
+    pages.resize(std::min(readahead_pages, sst->leaf_count) * PAGE_SIZE);
+}
+
+template<typename K, typename V>
+const LeafNode<K, V>* SSTIterator<K, V>::current_leaf() const {
+    return reinterpret_cast<const LeafNode<K, V>*>(pages.data() + leaf_in_buffer * PAGE_SIZE);
+}
+
+template<typename K, typename V>
+bool SSTIterator<K, V>::load_next_pages() {
+    buffered_leaves = 0;
+    leaf_in_buffer = 0;
+    position_in_leaf = 0;
+    if (next_leaf >= sst->leaf_count) {
+        return false;
+    }
+
+    size_t count = std::min(readahead_pages, sst->leaf_count - next_leaf);
+    if (limiter) {
+        limiter->request(count * PAGE_SIZE);
+    }
+    if (!sst->read_page_from_disk(sst->leaf_start_offset + next_leaf * PAGE_SIZE, pages.data(), count * PAGE_SIZE)) {
+        error = true;
+        return false;
+    }
+    next_leaf += count;
+    buffered_leaves = count;
+    return true;
+}
+
+// Moves past exhausted leaves, refilling the buffer as needed
+template<typename K, typename V>
+void SSTIterator<K, V>::skip_empty_leaves() {
+    while (buffered_leaves > 0 && position_in_leaf >= current_leaf()->count) {
+        position_in_leaf = 0;
+        if (++leaf_in_buffer == buffered_leaves) {
+            load_next_pages();
+        }
+    }
+}
+
+template<typename K, typename V>
+bool SSTIterator<K, V>::valid() const {
+    return !error && buffered_leaves > 0;
+}
+
+template<typename K, typename V>
+const K& SSTIterator<K, V>::key() const {
+    return current_leaf()->pairs[position_in_leaf].first;
+}
+
+template<typename K, typename V>
+const V& SSTIterator<K, V>::value() const {
+    return current_leaf()->pairs[position_in_leaf].second;
+}
+
+template<typename K, typename V>
+void SSTIterator<K, V>::next() {
+    if (!valid()) {
+        return;
+    }
+    position_in_leaf++;
+    skip_empty_leaves();
+}
+
+template<typename K, typename V>
+void SSTIterator<K, V>::seek_to_first() {
+    if (error || sst->entry_count == 0) {
+        return;
+    }
+    // already on the first leaf, e.g. after a seek to a small key
+    if (buffered_leaves > 0 && next_leaf == buffered_leaves) {
+        leaf_in_buffer = 0;
+        position_in_leaf = 0;
+    } else {
+        next_leaf = 0;
+        load_next_pages();
+    }
+    skip_empty_leaves();
+}
+
+template<typename K, typename V>
+void SSTIterator<K, V>::seek_past(const K& key) {
+    if (error || sst->entry_count == 0) {
+        return;
+    }
+    const auto& fences = sst->fence_keys;
+    size_t leaf = static_cast<size_t>(std::upper_bound(fences.begin(), fences.end(), key) - fences.begin());
+    if (buffered_leaves > 0 && leaf == next_leaf - buffered_leaves + leaf_in_buffer) {
+        position_in_leaf = 0;
+    } else {
+        next_leaf = leaf;
+        load_next_pages();
+    }
+    while (valid() && !(key < this->key())) {
+        position_in_leaf++;
+        skip_empty_leaves();
+    }
+}
+
+template<typename K, typename V>
+bool SSTIterator<K, V>::has_error() const {
+    return error;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SST_ITERATOR_H
+#define SST_ITERATOR_H
+
+#include <vector>
+#include "sst.h"
+#include "rate_limiter.h"
+
+// Leaves read from disk per refill
+constexpr size_t SST_ITERATOR_READAHEAD_PAGES = 16;
+
+// Walks every entry of an SST in key order, reading runs of leaf pages
+// straight from the file. It bypasses the buffer pool so a compaction does
+// not evict pages that queries are using, and it never holds more than
+// `readahead_pages` leaves in memory. Nothing is read until the first seek.
+template<typename K, typename V>
+class SSTIterator {
+private:
+    const SST<K, V>* sst;
+    RateLimiter* limiter;
+    size_t readahead_pages;
+    std::vector<char> pages;
+
+    size_t next_leaf;         // first leaf not yet read from the file
+    size_t buffered_leaves;   // leaves currently in `pages`
+    size_t leaf_in_buffer;
+    size_t position_in_leaf;
+    bool error;
+
+    const LeafNode<K, V>* current_leaf() const;
+    bool load_next_pages();
+    void skip_empty_leaves();
+
+public:
+    // Not valid until a seek
+    explicit SSTIterator(const SST<K, V>& source, size_t readahead = SST_ITERATOR_READAHEAD_PAGES,
+                         RateLimiter* rate_limiter = nullptr);
+
+    bool valid() const;
+    const K& key() const;
+    const V& value() const;
+    void next();
+    void seek_to_first();
+    // Moves to the first entry whose key is greater than `key`, using the
+    // fence keys to skip the leaves before it
+    void seek_past(const K& key);
+
+    // True if a read failed; the iterator then reports !valid()
+    bool has_error() const;
+};
+
+#include "sst_iterator.cpp"
+
+#endif
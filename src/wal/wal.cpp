@@ -0,0 +1,542 @@
+#ifndef WAL_CPP
+#define WAL_CPP
+
+#include "wal.h"
+#include "../../utils/crc32.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include <queue>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+template<typename K, typename V>
+void WALRecord<K, V>::encode(char* out, uint64_t sequence, const K& key, const V& value) {
+    std::memcpy(out + SEQUENCE_OFFSET, &sequence, sizeof(uint64_t));
+    std::memcpy(out + KEY_OFFSET, &key, sizeof(K));
+    std::memcpy(out + VALUE_OFFSET, &value, sizeof(V));
+    uint32_t checksum = crc32(out + CHECKSUM_SIZE, SIZE - CHECKSUM_SIZE);
+    std::memcpy(out, &checksum, CHECKSUM_SIZE);
+}
+
+template<typename K, typename V>
+bool WALRecord<K, V>::decode(const char* in, uint64_t& sequence, K& key, V& value) {
+    uint32_t stored_checksum;
+    std::memcpy(&stored_checksum, in, CHECKSUM_SIZE);
+    if (stored_checksum != crc32(in + CHECKSUM_SIZE, SIZE - CHECKSUM_SIZE)) {
+        return false;
+    }
+
+    std::memcpy(&sequence, in + SEQUENCE_OFFSET, sizeof(uint64_t));
+    std::memcpy(&key, in + KEY_OFFSET, sizeof(K));
+    std::memcpy(&value, in + VALUE_OFFSET, sizeof(V));
+    return true;
+}
+
+template<typename K, typename V>
+WriteAheadLog<K, V>::WriteAheadLog(const std::string& dir, WalSyncPolicy policy, size_t sync_interval_ms)
+    : directory(dir), sync_policy(policy), sync_interval(sync_interval_ms), fd(-1), segment_number(0),
+      next_sequence(0), durable_sequence(0), leader_active(false), write_error(false),
+      last_sync(std::chrono::steady_clock::now()), stop_sync_thread(false), sync_thread_idle(false), records_appended(0), commit_groups(0) {
+    pending.reserve(WAL_BUFFER_SIZE);
+}
+
+template<typename K, typename V>
+WriteAheadLog<K, V>::~WriteAheadLog() {
+    close();
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::open(uint64_t first_segment_number, uint64_t last_sequence) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    next_sequence = last_sequence;
+    durable_sequence = last_sequence;
+    write_error = false;
+    if (!open_segment(first_segment_number)) {
+        return false;
+    }
+    if (sync_policy == WalSyncPolicy::INTERVAL && !sync_thread.joinable()) {
+        stop_sync_thread = false;
+        sync_thread = std::thread(&WriteAheadLog::sync_worker, this);
+    }
+    return true;
+}
+
+// Waits for buffered records, then for the sync interval to run out, and
+// writes and fsyncs whatever an append has not written in the meantime
+template<typename K, typename V>
+void WriteAheadLog<K, V>::sync_worker() {
+    std::unique_lock<std::mutex> lock(log_mutex);
+    while (!stop_sync_thread) {
+        if (pending.empty() || fd < 0) {
+            sync_thread_idle = true;
+            sync_cv.wait(lock);
+            sync_thread_idle = false;
+            continue;
+        }
+        auto deadline = last_sync + sync_interval;
+        if (std::chrono::steady_clock::now() < deadline) {
+            sync_cv.wait_until(lock, deadline);
+            continue;
+        }
+        if (!leader_active && !write_error) {
+            commit_groups++;
+            write_pending_locked(true);
+        }
+    }
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::open_segment(uint64_t number) {
+    std::string path = segment_path(directory, number);
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open WAL segment " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    segment_number = number;
+    last_sync = std::chrono::steady_clock::now();
+    return true;
+}
+
+template<typename K, typename V>
+void WriteAheadLog<K, V>::close() {
+    if (sync_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            stop_sync_thread = true;
+        }
+        sync_cv.notify_one();
+        sync_thread.join();
+    }
+
+    std::unique_lock<std::mutex> lock(log_mutex);
+    commit_cv.wait(lock, [this] { return !leader_active; });
+    if (fd < 0) {
+        return;
+    }
+
+    write_pending_locked(sync_policy != WalSyncPolicy::NEVER);
+    ::close(fd);
+    fd = -1;
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::write_all(int file_fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(file_fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::write_pending_locked(bool sync) {
+    if (fd < 0 || write_error) {
+        return false;
+    }
+
+    if (!pending.empty()) {
+        if (!write_all(fd, pending.data(), pending.size())) {
+            write_error = true;
+            return false;
+        }
+        pending.clear();
+    }
+
+    if (sync) {
+        if (::fdatasync(fd) != 0) {
+            write_error = true;
+            return false;
+        }
+        last_sync = std::chrono::steady_clock::now();
+    }
+
+    durable_sequence = next_sequence;
+    return true;
+}
+
+// Decides, per sync policy, whether the records queued up to `sequence` have
+// to reach the file before the caller returns
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::commit_locked(std::unique_lock<std::mutex>& lock, uint64_t sequence) {
+    switch (sync_policy) {
+        case WalSyncPolicy::NEVER:
+            if (pending.size() >= WAL_BUFFER_SIZE) {
+                commit_groups++;
+                return write_pending_locked(false);
+            }
+            return !write_error;
+
+        case WalSyncPolicy::INTERVAL:
+            if (pending.size() >= WAL_BUFFER_SIZE ||
+                std::chrono::steady_clock::now() - last_sync >= sync_interval) {
+                commit_groups++;
+                return write_pending_locked(true);
+            }
+            // the sync thread writes these if no later append does in time
+            if (sync_thread_idle) {
+                sync_cv.notify_one();
+            }
+            return !write_error;
+
+        case WalSyncPolicy::ALWAYS:
+            break;
+    }
+
+    // Group commit: wait while another caller is writing, it may cover our records too
+    commit_cv.wait(lock, [&] { return durable_sequence >= sequence || !leader_active || write_error; });
+    if (write_error) {
+        return false;
+    }
+    if (durable_sequence >= sequence) {
+        return true;
+    }
+
+    // Become the leader and write everything queued so far in one write + fsync
+    leader_active = true;
+    std::vector<char> batch;
+    batch.swap(pending);
+    pending.reserve(WAL_BUFFER_SIZE);
+    uint64_t batch_sequence = next_sequence;
+    int batch_fd = fd;
+
+    lock.unlock();
+    bool ok = write_all(batch_fd, batch.data(), batch.size()) && ::fdatasync(batch_fd) == 0;
+    lock.lock();
+
+    leader_active = false;
+    commit_groups++;
+    if (ok) {
+        durable_sequence = std::max(durable_sequence, batch_sequence);
+        last_sync = std::chrono::steady_clock::now();
+    } else {
+        write_error = true;
+    }
+    commit_cv.notify_all();
+    return ok;
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::append(const K& key, const V& value) {
+    std::unique_lock<std::mutex> lock(log_mutex);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t offset = pending.size();
+    pending.resize(offset + WALRecord<K, V>::SIZE);
+    WALRecord<K, V>::encode(pending.data() + offset, ++next_sequence, key, value);
+    records_appended++;
+
+    return commit_locked(lock, next_sequence);
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::append_batch(const std::vector<std::pair<K, V>>& records) {
+    if (records.empty()) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(log_mutex);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t offset = pending.size();
+    pending.resize(offset + records.size() * WALRecord<K, V>::SIZE);
+    for (const auto& record : records) {
+        WALRecord<K, V>::encode(pending.data() + offset, ++next_sequence, record.first, record.second);
+        offset += WALRecord<K, V>::SIZE;
+    }
+    records_appended += records.size();
+
+    return commit_locked(lock, next_sequence);
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::sync() {
+    std::unique_lock<std::mutex> lock(log_mutex);
+    commit_cv.wait(lock, [this] { return !leader_active; });
+    if (fd < 0) {
+        return false;
+    }
+    return write_pending_locked(true);
+}
+
+template<typename K, typename V>
+uint64_t WriteAheadLog<K, V>::rotate() {
+    std::unique_lock<std::mutex> lock(log_mutex);
+    commit_cv.wait(lock, [this] { return !leader_active; });
+
+    uint64_t sealed = segment_number;
+    if (fd >= 0) {
+        write_pending_locked(sync_policy != WalSyncPolicy::NEVER);
+        ::close(fd);
+        fd = -1;
+    }
+    open_segment(sealed + 1);
+    return sealed;
+}
+
+template<typename K, typename V>
+uint64_t WriteAheadLog<K, V>::get_segment_number() const {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    return segment_number;
+}
+
+template<typename K, typename V>
+uint64_t WriteAheadLog<K, V>::get_last_sequence() const {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    return next_sequence;
+}
+
+template<typename K, typename V>
+size_t WriteAheadLog<K, V>::get_records_appended() const {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    return records_appended;
+}
+
+template<typename K, typename V>
+size_t WriteAheadLog<K, V>::get_commit_groups() const {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    return commit_groups;
+}
+
+template<typename K, typename V>
+std::string WriteAheadLog<K, V>::segment_filename(uint64_t number) {
+    std::ostringstream name;
+    name << "wal_" << std::setw(8) << std::setfill('0') << number << ".log";
+    return name.str();
+}
+
+template<typename K, typename V>
+std::string WriteAheadLog<K, V>::segment_path(const std::string& dir, uint64_t number) {
+    return dir + "/" + segment_filename(number);
+}
+
+template<typename K, typename V>
+std::vector<uint64_t> WriteAheadLog<K, V>::list_segments(const std::string& dir) {
+    std::vector<uint64_t> segments;
+    if (!std::filesystem::exists(dir)) {
+        return segments;
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::string name = entry.path().filename().string();
+        if (name.size() <= 8 || name.compare(0, 4, "wal_") != 0 ||
+            name.compare(name.size() - 4, 4, ".log") != 0) {
+            continue;
+        }
+        try {
+            segments.push_back(std::stoull(name.substr(4, name.size() - 8)));
+        } catch (const std::exception&) {
+            // not one of ours
+        }
+    }
+
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::remove_segment(const std::string& dir, uint64_t number) {
+    std::error_code ec;
+    return std::filesystem::remove(segment_path(dir, number), ec);
+}
+
+// One contiguous range of records inside a segment, parsed by a single thread
+struct WALReplayChunk {
+    size_t segment_index;
+    size_t first_record;
+    size_t record_count;
+    size_t valid_records = 0;
+    bool hit_invalid_record = false;
+};
+
+template<typename K, typename V>
+bool WriteAheadLog<K, V>::replay_segments(const std::string& dir, const std::vector<uint64_t>& segments,
+                                          std::vector<std::pair<K, V>>& sorted_records, uint64_t& last_sequence,
+                                          size_t max_threads) {
+    constexpr size_t RECORD_SIZE = WALRecord<K, V>::SIZE;
+    sorted_records.clear();
+    last_sequence = 0;
+
+    // Open every segment once and cut it into chunks of whole records
+    std::vector<int> fds;
+    std::vector<WALReplayChunk> chunks;
+    size_t total_records = 0;
+    std::vector<size_t> segment_records;
+    for (uint64_t number : segments) {
+        std::string path = segment_path(dir, number);
+        int segment_fd = ::open(path.c_str(), O_RDONLY);
+        if (segment_fd < 0) {
+            for (int open_fd : fds) {
+                ::close(open_fd);
+            }
+            return false;
+        }
+        struct stat st;
+        size_t records = (::fstat(segment_fd, &st) == 0) ? static_cast<size_t>(st.st_size) / RECORD_SIZE : 0;
+        fds.push_back(segment_fd);
+        segment_records.push_back(records);
+        total_records += records;
+    }
+
+    size_t num_threads = max_threads > 0 ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_records = std::max(WAL_REPLAY_MIN_RECORDS_PER_CHUNK, (total_records + num_threads - 1) / num_threads);
+    for (size_t seg = 0; seg < segments.size(); seg++) {
+        for (size_t first = 0; first < segment_records[seg]; first += chunk_records) {
+            chunks.push_back({seg, first, std::min(chunk_records, segment_records[seg] - first)});
+        }
+    }
+
+    // Each chunk is parsed and sorted by key independently; a stable sort keeps
+    // log order among equal keys so the last one is the newest
+    std::vector<std::vector<std::pair<K, V>>> runs(chunks.size());
+    std::vector<uint64_t> run_max_sequence(chunks.size(), 0);
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<bool> io_error{false};
+
+    auto worker = [&]() {
+        std::vector<char> buffer;
+        size_t index;
+        while ((index = next_chunk.fetch_add(1)) < chunks.size()) {
+            WALReplayChunk& chunk = chunks[index];
+            buffer.resize(chunk.record_count * RECORD_SIZE);
+
+            size_t done = 0;
+            off_t offset = static_cast<off_t>(chunk.first_record * RECORD_SIZE);
+            while (done < buffer.size()) {
+                ssize_t n = ::pread(fds[chunk.segment_index], buffer.data() + done, buffer.size() - done,
+                                    offset + static_cast<off_t>(done));
+                if (n <= 0) {
+                    if (n < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    break;
+                }
+                done += static_cast<size_t>(n);
+            }
+            if (done < buffer.size()) {
+                io_error = true;
+                continue;
+            }
+
+            auto& run = runs[index];
+            run.reserve(chunk.record_count);
+            for (size_t i = 0; i < chunk.record_count; i++) {
+                uint64_t sequence;
+                K key;
+                V value;
+                if (!WALRecord<K, V>::decode(buffer.data() + i * RECORD_SIZE, sequence, key, value)) {
+                    chunk.hit_invalid_record = true;
+                    break;
+                }
+                run_max_sequence[index] = std::max(run_max_sequence[index], sequence);
+                run.emplace_back(key, value);
+            }
+            chunk.valid_records = run.size();
+
+            std::stable_sort(run.begin(), run.end(),
+                             [](const std::pair<K, V>& a, const std::pair<K, V>& b) { return a.first < b.first; });
+            size_t out = 0;
+            for (size_t i = 0; i < run.size(); i++) {
+                if (i + 1 < run.size() && run[i + 1].first == run[i].first) {
+                    continue;
+                }
+                run[out++] = run[i];
+            }
+            run.resize(out);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t worker_count = std::min(num_threads, chunks.size());
+    for (size_t t = 1; t < worker_count; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    for (int open_fd : fds) {
+        ::close(open_fd);
+    }
+    if (io_error) {
+        return false;
+    }
+
+    // Drop everything after the first bad record of each segment
+    std::vector<bool> segment_truncated(segments.size(), false);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (segment_truncated[chunks[i].segment_index]) {
+            runs[i].clear();
+            continue;
+        }
+        if (chunks[i].hit_invalid_record) {
+            segment_truncated[chunks[i].segment_index] = true;
+            std::cerr << "WAL segment " << segment_filename(segments[chunks[i].segment_index])
+                      << ": ignoring records after offset "
+                      << (chunks[i].first_record + chunks[i].valid_records) * RECORD_SIZE << std::endl;
+        }
+        last_sequence = std::max(last_sequence, run_max_sequence[i]);
+    }
+
+    // k-way merge of the sorted runs; on equal keys the later run (newer log data) wins
+    using HeapEntry = std::pair<size_t, size_t>; // run index, position
+    auto heap_greater = [&runs](const HeapEntry& a, const HeapEntry& b) {
+        const K& key_a = runs[a.first][a.second].first;
+        const K& key_b = runs[b.first][b.second].first;
+        if (key_a == key_b) {
+            return a.first < b.first;
+        }
+        return key_b < key_a;
+    };
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, decltype(heap_greater)> heap(heap_greater);
+    size_t merged_upper_bound = 0;
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (!runs[i].empty()) {
+            heap.push({i, 0});
+            merged_upper_bound += runs[i].size();
+        }
+    }
+    sorted_records.reserve(merged_upper_bound);
+
+    while (!heap.empty()) {
+        HeapEntry top = heap.top();
+        heap.pop();
+        const auto& record = runs[top.first][top.second];
+
+        if (!sorted_records.empty() && sorted_records.back().first == record.first) {
+            // an older version of a key that was already emitted from a newer run
+        } else {
+            sorted_records.push_back(record);
+        }
+
+        if (top.second + 1 < runs[top.first].size()) {
+            heap.push({top.first, top.second + 1});
+        }
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <condition_variable>
+#include <thread>
+#include <type_traits>
+
+constexpr size_t WAL_BUFFER_SIZE = 64 * 1024;
+// Smallest amount of log handed to one replay thread
+constexpr size_t WAL_REPLAY_MIN_RECORDS_PER_CHUNK = 16 * 1024;
+
+enum class WalSyncPolicy {
+    ALWAYS,     // every commit group is written and fsynced before put returns
+    INTERVAL,   // buffered, written and fsynced once the sync interval has passed,
+                // by the next append or by a background thread if none comes
+    NEVER       // buffered, written when the buffer fills; left to the OS to persist
+};
+
+// Fixed-size log record: crc32 | sequence | key | value. The checksum covers
+// everything after itself so torn or garbage tails are detected on replay.
+template<typename K, typename V>
+struct WALRecord {
+    static constexpr size_t CHECKSUM_SIZE = sizeof(uint32_t);
+    static constexpr size_t SEQUENCE_OFFSET = CHECKSUM_SIZE;
+    static constexpr size_t KEY_OFFSET = SEQUENCE_OFFSET + sizeof(uint64_t);
+    static constexpr size_t VALUE_OFFSET = KEY_OFFSET + sizeof(K);
+    static constexpr size_t SIZE = VALUE_OFFSET + sizeof(V);
+
+    static void encode(char* out, uint64_t sequence, const K& key, const V& value);
+    static bool decode(const char* in, uint64_t& sequence, K& key, V& value);
+};
+
+// Append-only write-ahead log made of numbered segment files, one per
+// memtable. Appends from concurrent callers are coalesced: under the ALWAYS
+// policy one caller becomes the leader and writes and fsyncs every record
+// queued so far, while the others wait for it instead of issuing their own.
+template<typename K, typename V>
+class WriteAheadLog {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "WAL records are stored as raw bytes");
+
+private:
+    std::string directory;
+    WalSyncPolicy sync_policy;
+    std::chrono::milliseconds sync_interval;
+
+    mutable std::mutex log_mutex;
+    std::condition_variable commit_cv;
+    int fd;
+    uint64_t segment_number;
+    std::vector<char> pending;
+    uint64_t next_sequence;
+    uint64_t durable_sequence;
+    bool leader_active;
+    bool write_error;
+    std::chrono::steady_clock::time_point last_sync;
+
+    // INTERVAL policy: syncs records that no later append has written once
+    // the interval has passed since the last sync
+    std::thread sync_thread;
+    std::condition_variable sync_cv;
+    bool stop_sync_thread;
+    bool sync_thread_idle;   // waiting for records rather than for the interval
+
+    // Group commit statistics
+    size_t records_appended;
+    size_t commit_groups;
+
+    bool open_segment(uint64_t number);
+    bool write_pending_locked(bool sync);
+    bool commit_locked(std::unique_lock<std::mutex>& lock, uint64_t sequence);
+    void sync_worker();
+    static bool write_all(int file_fd, const char* data, size_t length);
+
+public:
+    WriteAheadLog(const std::string& dir, WalSyncPolicy policy = WalSyncPolicy::INTERVAL,
+                  size_t sync_interval_ms = 100);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    bool open(uint64_t first_segment_number, uint64_t last_sequence = 0);
+    void close();
+
+    bool append(const K& key, const V& value);
+    bool append_batch(const std::vector<std::pair<K, V>>& records);
+    bool sync();
+
+    // Seals the current segment and starts the next one; returns the sealed number
+    uint64_t rotate();
+
+    uint64_t get_segment_number() const;
+    uint64_t get_last_sequence() const;
+    size_t get_records_appended() const;
+    size_t get_commit_groups() const;
+
+    static std::string segment_filename(uint64_t number);
+    static std::string segment_path(const std::string& dir, uint64_t number);
+    static std::vector<uint64_t> list_segments(const std::string& dir);
+    static bool remove_segment(const std::string& dir, uint64_t number);
+
+    // Reads the given segments (oldest first) in parallel chunks, validating
+    // every record's checksum, and returns the newest value per key sorted by
+    // key. A bad record ends its segment: everything after it is ignored.
+    static bool replay_segments(const std::string& dir, const std::vector<uint64_t>& segments,
+                                std::vector<std::pair<K, V>>& sorted_records, uint64_t& last_sequence,
+                                size_t max_threads = 0);
+};
+
+#include "wal.cpp"
+
+#endif
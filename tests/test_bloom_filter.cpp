@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <numeric>
+#include <cmath>
 
 void test_bloom_filter_add_contains() {
     // expect 100 elements, 1% FPR
@@ -89,6 +90,43 @@ void test_bloom_filter_false_positive_rate() {
     ASSERT_TRUE(false_positive_rate < (0.01 * 2));
 }
 
+void test_monkey_rates_follow_level_sizes() {
+    // a tree with a size ratio of 10 and 10 bits per entry on average
+    std::vector<size_t> level_entries = {1000, 10000, 100000};
+    const double bits_per_entry = 10;
+    std::vector<double> rates = monkey_false_positive_rates(level_entries, bits_per_entry);
+    ASSERT_EQUAL(static_cast<size_t>(3), rates.size());
+
+    // rates grow with the level, in proportion to its size
+    ASSERT_TRUE(rates[0] < rates[1] && rates[1] < rates[2]);
+    ASSERT_TRUE(std::abs(rates[1] / rates[0] - 10.0) < 1e-6);
+
+    // the filters use exactly the budget
+    const double ln2_squared = std::log(2) * std::log(2);
+    double bits = 0;
+    double total = 0;
+    for (size_t i = 0; i < rates.size(); i++) {
+        bits += level_entries[i] * std::log(1 / rates[i]) / ln2_squared;
+        total += level_entries[i];
+    }
+    ASSERT_TRUE(std::abs(bits - bits_per_entry * total) < 1.0);
+
+    // and a lookup that finds nothing costs less than with the same rate everywhere
+    double uniform = std::exp(-bits_per_entry * ln2_squared);
+    ASSERT_TRUE(rates[0] + rates[1] + rates[2] < 3 * uniform);
+}
+
+void test_monkey_rates_small_budget() {
+    // too few bits for the largest level: it gets no filter and the rest share the budget
+    std::vector<double> rates = monkey_false_positive_rates({10, 100, 100000}, 0.01);
+    ASSERT_EQUAL(1.0, rates[2]);
+    ASSERT_TRUE(rates[0] < 1.0);
+
+    // empty levels need no filter
+    rates = monkey_false_positive_rates({0, 500}, 8);
+    ASSERT_EQUAL(1.0, rates[0]);
+    ASSERT_TRUE(std::abs(rates[1] - std::exp(-8 * std::log(2) * std::log(2))) < 1e-9);
+}
 
 int main() {
     std::cout << "Running Bloom Filter Tests" << std::endl;
@@ -98,6 +136,8 @@ int main() {
     RUN_TEST(test_bloom_filter_empty);
     RUN_TEST(test_bloom_filter_multiple_adds);
     RUN_TEST(test_bloom_filter_false_positive_rate);
+    RUN_TEST(test_monkey_rates_follow_level_sizes);
+    RUN_TEST(test_monkey_rates_small_budget);
 
     TestFramework::print_results();
 
@@ -2,6 +2,8 @@
 #include "../src/buffer/buffer_pool.h"
 #include <cstring>
 #include <iostream>
+#include <thread>
+#include <atomic>
 
 void test_page_id_equality() {
     PageID page1("file1.sst", 0);
@@ -345,6 +347,113 @@ void test_mixed_operations_expandable() {
     }
 }
 
+void test_remove_file_pages() {
+    BufferPool pool(2, 10, 4, 64, true);
+    char data[PAGE_SIZE];
+    std::memset(data, 7, PAGE_SIZE);
+    for (size_t i = 0; i < 8; i++) {
+        ASSERT_TRUE(pool.put_page(PageID("old.sst", i * PAGE_SIZE), data));
+        ASSERT_TRUE(pool.put_page(PageID("new.sst", i * PAGE_SIZE), data));
+    }
+
+    // page 2 of the old file is read three times
+    char out[PAGE_SIZE];
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(pool.get_page(PageID("old.sst", 2 * PAGE_SIZE), out));
+    }
+
+    std::vector<std::pair<size_t, size_t>> dropped;
+    ASSERT_EQUAL(static_cast<size_t>(8), pool.remove_file_pages("old.sst", &dropped));
+    ASSERT_EQUAL(static_cast<size_t>(8), dropped.size());
+    ASSERT_EQUAL(8, static_cast<int>(pool.get_page_count()));
+    size_t hits = 0;
+    for (const auto& page : dropped) {
+        hits += page.first == 2 * PAGE_SIZE ? page.second : 0;
+    }
+    ASSERT_EQUAL(static_cast<size_t>(3), hits);
+    ASSERT_FALSE(pool.contains_page(PageID("old.sst", 2 * PAGE_SIZE)));
+    ASSERT_TRUE(pool.contains_page(PageID("new.sst", 2 * PAGE_SIZE)));
+
+    // the freed slots are reused, and eviction still walks a valid ring
+    for (size_t i = 0; i < 100; i++) {
+        ASSERT_TRUE(pool.put_page(PageID("more.sst", i * PAGE_SIZE), data));
+    }
+    ASSERT_EQUAL(64, static_cast<int>(pool.get_page_count()));
+    ASSERT_EQUAL(static_cast<size_t>(0), pool.remove_file_pages("old.sst"));
+}
+
+void test_remove_page_then_evict() {
+    BufferPool pool(2, 10, 4, 4, true);
+    char data[PAGE_SIZE];
+    std::memset(data, 1, PAGE_SIZE);
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(pool.put_page(PageID("file.sst", i * PAGE_SIZE), data));
+    }
+    ASSERT_TRUE(pool.remove_page(PageID("file.sst", 0)));
+
+    // eviction must not find the removed page in the clock ring
+    for (size_t i = 4; i < 12; i++) {
+        ASSERT_TRUE(pool.put_page(PageID("file.sst", i * PAGE_SIZE), data));
+    }
+    ASSERT_EQUAL(4, static_cast<int>(pool.get_page_count()));
+}
+
+void test_sharded_pool_capacity() {
+    BufferPool pool(2, 10, 4, 100, true, nullptr, 10, 4);
+    ASSERT_EQUAL(static_cast<size_t>(4), pool.get_shard_count());
+    ASSERT_EQUAL(16, static_cast<int>(pool.get_directory_size()));
+    ASSERT_EQUAL(2, static_cast<int>(pool.get_global_depth()));
+
+    char data[PAGE_SIZE];
+    std::memset(data, 3, PAGE_SIZE);
+    for (size_t i = 0; i < 500; i++) {
+        ASSERT_TRUE(pool.put_page(PageID("file.sst", i * PAGE_SIZE), data));
+    }
+    // every shard evicts within its share, so the pool never grows past its limit
+    ASSERT_EQUAL(100, static_cast<int>(pool.get_page_count()));
+    ASSERT_TRUE(pool.is_full());
+
+    // a pool too small to split keeps one shard
+    BufferPool small_pool(2, 10, 4, 20, true, nullptr, 10, 8);
+    ASSERT_EQUAL(static_cast<size_t>(1), small_pool.get_shard_count());
+}
+
+void test_concurrent_readers_and_writers() {
+    BufferPool pool(2, 10, 4, 256, true, nullptr, 10, 8);
+    const size_t thread_count = 4;
+    const size_t pages_per_thread = 200;
+    std::atomic<size_t> corrupt_reads(0);
+
+    // each thread writes its own file, whose page bytes are the thread number,
+    // and reads back both its own pages and those of the other threads
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            char data[PAGE_SIZE];
+            char out[PAGE_SIZE];
+            std::memset(data, static_cast<int>(t), PAGE_SIZE);
+            std::string filename = "thread_" + std::to_string(t) + ".sst";
+            for (size_t round = 0; round < 5; round++) {
+                for (size_t i = 0; i < pages_per_thread; i++) {
+                    pool.put_page(PageID(filename, i * PAGE_SIZE), data);
+                    size_t other = (t + i) % thread_count;
+                    if (pool.get_page(PageID("thread_" + std::to_string(other) + ".sst", i * PAGE_SIZE), out) &&
+                        (out[0] != static_cast<char>(other) || out[PAGE_SIZE - 1] != static_cast<char>(other))) {
+                        corrupt_reads++;
+                    }
+                }
+                pool.remove_file_pages(filename);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQUAL(static_cast<size_t>(0), corrupt_reads.load());
+    ASSERT_EQUAL(0, static_cast<int>(pool.get_page_count()));
+}
+
 int main() {
     TestFramework::reset();
 
@@ -370,6 +479,12 @@ int main() {
     RUN_TEST(test_stress_expandable);
     RUN_TEST(test_pages_persist_after_split);
     RUN_TEST(test_mixed_operations_expandable);
+    RUN_TEST(test_remove_file_pages);
+    RUN_TEST(test_remove_page_then_evict);
+
+    std::cout << "\n=  Sharding Tests   =" << std::endl;
+    RUN_TEST(test_sharded_pool_capacity);
+    RUN_TEST(test_concurrent_readers_and_writers);
 
     TestFramework::print_results();
 
@@ -2,6 +2,7 @@
 #include "../src/core/database.h"
 #include <string>
 #include <filesystem>
+#include <chrono>
 
 void test_database_open_close() {
     // Clear SSTs from previous run
@@ -592,6 +593,318 @@ void test_sst_with_buffer_pool_caching() {
     ASSERT_TRUE(db.close());
 }
 
+void test_mmap_read_mode() {
+    std::filesystem::remove_all("data/test_mmap_read_mode");
+    Database<int, int> db("test_mmap_read_mode", 50);
+    db.set_read_mode(SSTReadMode::MMAP);
+    ASSERT_TRUE(db.open());
+
+    // several flushes and compactions, all served from mapped files
+    for (int i = 0; i < 500; i++) {
+        ASSERT_TRUE(db.put(i, i * 7));
+    }
+    db.put(10, -1);
+    db.flush_memtable_to_sst();
+    ASSERT_TRUE(db.get_sst_count() > 0);
+
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < 500; i++) {
+        int expected = i == 10 ? -1 : i * 7;
+        if (!db.get(i, value) || value != expected ||
+            !db.get(i, value, SearchMode::BINARY_SEARCH) || value != expected) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+
+    size_t result_size = 0;
+    auto results = db.scan(100, 199, result_size);
+    ASSERT_EQUAL(100, static_cast<int>(result_size));
+    ASSERT_EQUAL(100, results[0].first);
+    delete[] results;
+    ASSERT_TRUE(db.close());
+
+    // the same files read back through the buffer pool
+    Database<int, int> reopened("test_mmap_read_mode", 50);
+    ASSERT_TRUE(reopened.open());
+    ASSERT_TRUE(reopened.get(499, value));
+    ASSERT_EQUAL(499 * 7, value);
+    ASSERT_TRUE(reopened.close());
+}
+
+void test_background_compaction_rate_limit() {
+    std::filesystem::remove_all("data/test_background_compaction_rate_limit");
+    Database<int, int> db("test_background_compaction_rate_limit", 100);
+    db.set_compaction_rate_limit(4 * 1024 * 1024);
+    ASSERT_TRUE(db.open());
+
+    // puts hand full memtables to the flush thread; merges run behind them.
+    // Every memtable spans the whole key range, so level 0 cannot simply move down.
+    for (int i = 0; i < 2000; i++) {
+        int key = (i * 7) % 2000;
+        ASSERT_TRUE(db.put(key, key * 3));
+    }
+    db.flush_memtable_to_sst();
+
+    // level 0 has been merged down
+    ASSERT_TRUE(db.get_level_sst_count(0) < 2);
+    ASSERT_TRUE(db.get_level_sst_count(1) > 0);
+    ASSERT_TRUE(db.get_compaction_bytes() > 0);
+
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < 2000; i++) {
+        if (!db.get(i, value) || value != i * 3) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(db.close());
+}
+
+void test_rate_limiter_paces_requests() {
+    RateLimiter limiter(1024 * 1024);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 3; i++) {
+        limiter.request(256 * 1024);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 768 KB at 1 MB/s, starting from an empty bucket
+    ASSERT_TRUE(elapsed >= 0.6);
+    ASSERT_TRUE(elapsed < 5.0);
+    ASSERT_EQUAL(3 * 256 * 1024, static_cast<int>(limiter.get_total_bytes()));
+
+    // unlimited requests only count bytes
+    limiter.set_rate(0);
+    start = std::chrono::steady_clock::now();
+    limiter.request(64 * 1024 * 1024);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(elapsed < 0.1);
+}
+
+void test_iterator_merges_memtable_and_ssts() {
+    std::filesystem::remove_all("data/test_iterator_merges");
+    Database<int, int> db("test_iterator_merges", 50);
+    ASSERT_TRUE(db.open());
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+    db.flush_memtable_to_sst();
+    for (int i = 0; i < 100; i += 2) {
+        ASSERT_TRUE(db.put(i, i + 1000));
+    }
+    db.flush_memtable_to_sst();
+    // tombstones stay in the memtable
+    for (int i = 0; i < 100; i += 10) {
+        ASSERT_TRUE(db.remove(i));
+    }
+
+    auto it = db.new_iterator();
+    ASSERT_TRUE(it != nullptr);
+    int expected = 1;
+    bool all_match = true;
+    for (it->seek_to_first(); it->valid(); it->next()) {
+        int expected_value = expected % 2 == 0 ? expected + 1000 : expected;
+        if (it->key() != expected || it->value() != expected_value) {
+            all_match = false;
+        }
+        expected += expected % 10 == 9 ? 2 : 1;
+    }
+    ASSERT_TRUE(all_match);
+    ASSERT_EQUAL(101, expected);
+
+    it->seek(55);
+    ASSERT_EQUAL(55, it->key());
+    it->seek(60);
+    ASSERT_EQUAL(61, it->key());
+    it->seek(100);
+    ASSERT_FALSE(it->valid());
+    ASSERT_FALSE(it->has_error());
+    it.reset();
+    ASSERT_TRUE(db.close());
+}
+
+void test_scan_with_limit_and_reverse() {
+    std::filesystem::remove_all("data/test_scan_with_limit");
+    Database<int, int> db("test_scan_with_limit", 50);
+    ASSERT_TRUE(db.open());
+
+    // odd keys 1..199 over several SSTs, 101..109 deleted from the memtable
+    for (int i = 1; i < 200; i += 2) {
+        ASSERT_TRUE(db.put(i, i * 10));
+    }
+    db.flush_memtable_to_sst();
+    for (int i = 101; i < 110; i += 2) {
+        ASSERT_TRUE(db.remove(i));
+    }
+
+    size_t result_size = 0;
+    auto results = db.scan(50, 150, result_size, 5);
+    ASSERT_EQUAL(static_cast<size_t>(5), result_size);
+    ASSERT_EQUAL(51, results[0].first);
+    ASSERT_EQUAL(59, results[4].first);
+    delete[] results;
+
+    results = db.scan(50, 112, result_size, 3, ScanDirection::REVERSE);
+    ASSERT_EQUAL(static_cast<size_t>(3), result_size);
+    ASSERT_EQUAL(111, results[0].first);
+    ASSERT_EQUAL(1110, results[0].second);
+    ASSERT_EQUAL(99, results[1].first);
+    ASSERT_EQUAL(97, results[2].first);
+    delete[] results;
+
+    // a limit larger than the range returns the whole range, backwards
+    results = db.scan(0, 20, result_size, 100, ScanDirection::REVERSE);
+    ASSERT_EQUAL(static_cast<size_t>(10), result_size);
+    ASSERT_EQUAL(19, results[0].first);
+    ASSERT_EQUAL(1, results[9].first);
+    delete[] results;
+
+    results = db.scan(0, 20, result_size, 0);
+    ASSERT_TRUE(results == nullptr);
+    ASSERT_EQUAL(static_cast<size_t>(0), result_size);
+    ASSERT_TRUE(db.close());
+}
+
+void test_iterator_changes_direction() {
+    std::filesystem::remove_all("data/test_iterator_changes_direction");
+    Database<int, int> db("test_iterator_changes_direction", 50);
+    ASSERT_TRUE(db.open());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+    db.flush_memtable_to_sst();
+    ASSERT_TRUE(db.remove(51));
+    ASSERT_TRUE(db.put(52, 520));
+
+    auto it = db.new_iterator();
+    it->seek(50);
+    it->next();
+    ASSERT_EQUAL(52, it->key());
+    ASSERT_EQUAL(520, it->value());
+    it->prev();
+    ASSERT_EQUAL(50, it->key());
+    it->prev();
+    ASSERT_EQUAL(49, it->key());
+    it->next();
+    it->next();
+    ASSERT_EQUAL(52, it->key());
+
+    it->seek_to_last();
+    ASSERT_EQUAL(99, it->key());
+    int count = 0;
+    for (; it->valid(); it->prev()) {
+        count++;
+    }
+    ASSERT_EQUAL(99, count);
+    it.reset();
+    ASSERT_TRUE(db.close());
+}
+
+void test_multi_get_matches_get() {
+    std::filesystem::remove_all("data/test_multi_get");
+    Database<int, int> db("test_multi_get", 50);
+    ASSERT_TRUE(db.open());
+
+    // versions spread over levels, the memtable and tombstones
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+    for (int i = 0; i < 1000; i += 3) {
+        ASSERT_TRUE(db.put(i, i + 5000));
+    }
+    for (int i = 0; i < 1000; i += 7) {
+        ASSERT_TRUE(db.remove(i));
+    }
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(db.put(i * 11, -i));
+    }
+    ASSERT_TRUE(db.get_level_count() > 1);
+
+    // out of order, with duplicates and keys that were never written
+    std::vector<int> keys;
+    for (int i = 0; i < 600; i++) {
+        keys.push_back((i * 389) % 1200 - 100);
+    }
+    keys.push_back(21);
+    keys.push_back(21);
+
+    std::vector<int> values;
+    std::vector<bool> found = db.multi_get(keys, values);
+    ASSERT_EQUAL(keys.size(), found.size());
+    bool all_match = true;
+    size_t found_count = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        int value;
+        bool expected = db.get(keys[i], value);
+        if (found[i] != expected || (expected && values[i] != value)) {
+            all_match = false;
+        }
+        found_count += found[i] ? 1 : 0;
+    }
+    ASSERT_TRUE(all_match);
+    ASSERT_TRUE(found_count > 300);
+
+    std::vector<int> no_keys;
+    ASSERT_TRUE(db.multi_get(no_keys, values).empty());
+    ASSERT_TRUE(db.close());
+}
+
+size_t count_sst_files(const std::string& directory) {
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".sst") {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_iterator_outlives_compaction() {
+    std::filesystem::remove_all("data/test_iterator_outlives_compaction");
+    Database<int, int> db("test_iterator_outlives_compaction", 50);
+    ASSERT_TRUE(db.open());
+    for (int i = 0; i < 200; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+    db.flush_memtable_to_sst();
+
+    auto it = db.new_iterator();
+    it->seek(0);
+    ASSERT_EQUAL(0, it->key());
+
+    // rewrite every key a few times so compactions replace the SSTs the iterator reads
+    for (int round = 1; round <= 3; round++) {
+        for (int i = 0; i < 200; i++) {
+            ASSERT_TRUE(db.put(i, i + 1000 * round));
+        }
+        db.flush_memtable_to_sst();
+    }
+    ASSERT_TRUE(db.get_compaction_bytes_written() > 0);
+    ASSERT_TRUE(count_sst_files("data/test_iterator_outlives_compaction") > db.get_sst_count());
+
+    // each key once, in order, in one of its versions
+    int expected = 0;
+    bool all_match = true;
+    for (; it->valid(); it->next()) {
+        if (it->key() != expected || it->value() % 1000 != expected) {
+            all_match = false;
+        }
+        expected++;
+    }
+    ASSERT_TRUE(all_match);
+    ASSERT_EQUAL(200, expected);
+    ASSERT_FALSE(it->has_error());
+
+    // the replaced files go with the last iterator
+    it.reset();
+    ASSERT_EQUAL(db.get_sst_count(), count_sst_files("data/test_iterator_outlives_compaction"));
+    ASSERT_TRUE(db.close());
+}
+
 int main() {
     std::cout << "Running Database Tests" << std::endl;
 
@@ -624,6 +937,15 @@ int main() {
 
     RUN_TEST(test_sst_with_buffer_pool_caching);
 
+    RUN_TEST(test_mmap_read_mode);
+    RUN_TEST(test_background_compaction_rate_limit);
+    RUN_TEST(test_rate_limiter_paces_requests);
+    RUN_TEST(test_iterator_merges_memtable_and_ssts);
+    RUN_TEST(test_iterator_outlives_compaction);
+    RUN_TEST(test_scan_with_limit_and_reverse);
+    RUN_TEST(test_iterator_changes_direction);
+    RUN_TEST(test_multi_get_matches_get);
+
     TestFramework::print_results();
 
     return TestFramework::tests_run == TestFramework::tests_passed ? 0 : 1;
@@ -2,6 +2,9 @@
 #include "../src/core/database.h"
 #include <string>
 #include <filesystem>
+#include <map>
+#include <algorithm>
+#include <cstdint>
 
 void test_delete_basic() {
     std::filesystem::remove_all("data/test_delete_basic");
@@ -116,7 +119,10 @@ void test_compaction_basic() {
     db.put(6, 600);
     db.flush_memtable_to_sst();
 
-    ASSERT_EQUAL(1, static_cast<int>(db.get_sst_count()));
+    // the two SSTs share no keys, so they move to level 1 without a merge
+    ASSERT_EQUAL(0, static_cast<int>(db.get_level_sst_count(0)));
+    ASSERT_EQUAL(2, static_cast<int>(db.get_level_sst_count(1)));
+    ASSERT_EQUAL(1, static_cast<int>(db.get_trivial_move_count()));
 
     int value;
     ASSERT_TRUE(db.get(1, value));
@@ -328,6 +334,395 @@ void test_reopen_after_compaction() {
     }
 }
 
+// Overwrites and deletes spread over many flushes; returns whether every key reads back as expected
+bool run_mixed_workload(Database<int, int>& db, std::map<int, int>& expected) {
+    for (int i = 0; i < 12000; i++) {
+        int key = (i * 7919) % 6000;
+        if (i % 13 == 0) {
+            db.remove(key);
+            expected.erase(key);
+        } else {
+            db.put(key, i);
+            expected[key] = i;
+        }
+    }
+    db.flush_memtable_to_sst();
+
+    int value;
+    bool all_match = true;
+    for (int key = 0; key < 6000; key++) {
+        bool found = db.get(key, value);
+        auto it = expected.find(key);
+        if (found != (it != expected.end()) || (found && value != it->second)) {
+            all_match = false;
+        }
+    }
+    return all_match;
+}
+
+// Loads the SSTs the manifest lists for each level
+std::vector<std::vector<std::unique_ptr<SST<int, int>>>> load_levels(const std::string& dir) {
+    std::vector<std::vector<std::unique_ptr<SST<int, int>>>> loaded;
+    Manifest manifest(dir);
+    if (!manifest.open()) {
+        return loaded;
+    }
+    for (const auto& files : manifest.get_layout()) {
+        loaded.emplace_back();
+        for (const auto& filename : files) {
+            std::unique_ptr<SST<int, int>> sst;
+            if (SST<int, int>::load_existing_sst(dir + "/" + filename, sst)) {
+                loaded.back().push_back(std::move(sst));
+            }
+        }
+    }
+    manifest.close();
+    return loaded;
+}
+
+bool level_is_disjoint(const std::vector<std::unique_ptr<SST<int, int>>>& files) {
+    std::vector<std::pair<int, int>> ranges;
+    for (const auto& sst : files) {
+        ranges.push_back({sst->get_min_key(), sst->get_max_key()});
+    }
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first <= ranges[i - 1].second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CompactionOptions small_levels() {
+    CompactionOptions options;
+    options.size_ratio = 3;
+    options.level0_file_limit = 2;
+    options.level1_max_bytes = 32 * 1024;
+    options.target_file_size = 8 * 1024;
+    return options;
+}
+
+void test_leveled_compaction_shape() {
+    std::filesystem::remove_all("data/test_leveled_shape");
+    std::map<int, int> expected;
+    {
+        Database<int, int> db("test_leveled_shape", 200);
+        db.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LEVELED, small_levels()));
+        ASSERT_TRUE(db.open());
+        ASSERT_TRUE(run_mixed_workload(db, expected));
+        ASSERT_TRUE(db.get_level_count() > 2);
+        ASSERT_TRUE(db.close());
+    }
+
+    // every level below 0 is sorted, non-overlapping and within its size limit,
+    // and its files hold at most target_file_size bytes of leaves
+    auto loaded = load_levels("data/test_leveled_shape");
+    bool disjoint = true;
+    bool within_limit = true;
+    bool files_bounded = true;
+    size_t max_bytes = small_levels().level1_max_bytes;
+    size_t max_file_entries = small_levels().target_file_size / PAGE_SIZE * LeafNode<int, int>::PAIRS_COUNT;
+    for (size_t level = 1; level < loaded.size(); level++) {
+        size_t bytes = 0;
+        for (const auto& sst : loaded[level]) {
+            bytes += sst->get_file_size();
+            files_bounded = files_bounded && sst->get_entry_count() <= max_file_entries;
+        }
+        disjoint = disjoint && level_is_disjoint(loaded[level]);
+        within_limit = within_limit && bytes <= max_bytes;
+        max_bytes *= small_levels().size_ratio;
+    }
+    ASSERT_TRUE(disjoint);
+    ASSERT_TRUE(within_limit);
+    ASSERT_TRUE(files_bounded);
+}
+
+void test_tiered_compaction_writes_less() {
+    std::filesystem::remove_all("data/test_tiered_wa");
+    std::filesystem::remove_all("data/test_leveled_wa");
+    std::map<int, int> tiered_expected;
+    std::map<int, int> leveled_expected;
+
+    Database<int, int> tiered("test_tiered_wa", 200);
+    tiered.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::TIERED, small_levels()));
+    ASSERT_TRUE(tiered.open());
+    ASSERT_TRUE(run_mixed_workload(tiered, tiered_expected));
+    ASSERT_EQUAL(std::string("tiered"), std::string(tiered.get_compaction_strategy().get_name()));
+
+    Database<int, int> leveled("test_leveled_wa", 200);
+    leveled.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LEVELED, small_levels()));
+    ASSERT_TRUE(leveled.open());
+    ASSERT_TRUE(run_mixed_workload(leveled, leveled_expected));
+
+    // runs are merged once per level instead of into every overlapping SST
+    ASSERT_TRUE(tiered.get_write_amplification() > 1.0);
+    ASSERT_TRUE(tiered.get_write_amplification() < leveled.get_write_amplification());
+    ASSERT_TRUE(tiered.close());
+    ASSERT_TRUE(leveled.close());
+
+    // the runs of each level come back in age order
+    Database<int, int> reopened("test_tiered_wa", 200);
+    reopened.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::TIERED, small_levels()));
+    ASSERT_TRUE(reopened.open());
+    int value;
+    bool all_match = true;
+    for (int key = 0; key < 6000; key++) {
+        bool found = reopened.get(key, value);
+        auto it = tiered_expected.find(key);
+        if (found != (it != tiered_expected.end()) || (found && value != it->second)) {
+            all_match = false;
+        }
+    }
+    ASSERT_TRUE(all_match);
+    ASSERT_TRUE(reopened.close());
+}
+
+void test_tiered_runs_survive_reopen() {
+    std::filesystem::remove_all("data/test_tiered_runs_reopen");
+    std::vector<size_t> run_counts;
+    {
+        Database<int, int> db("test_tiered_runs_reopen", 200);
+        db.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::TIERED, small_levels()));
+        ASSERT_TRUE(db.open());
+        // two level-0 runs merge into one level-1 run; the second such run
+        // holds larger keys, so it does not overlap the first
+        for (int base : {0, 10000}) {
+            for (int flush = 0; flush < 2; flush++) {
+                for (int i = 0; i < 200; i++) {
+                    ASSERT_TRUE(db.put(base + flush * 200 + i, i));
+                }
+                db.flush_memtable_to_sst();
+            }
+        }
+        ASSERT_EQUAL(static_cast<size_t>(2), db.get_level_run_count(1));
+        for (size_t level = 0; level < db.get_level_count(); level++) {
+            run_counts.push_back(db.get_level_run_count(level));
+        }
+        ASSERT_TRUE(db.close());
+    }
+
+    Database<int, int> reopened("test_tiered_runs_reopen", 200);
+    reopened.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::TIERED, small_levels()));
+    ASSERT_TRUE(reopened.open());
+    ASSERT_EQUAL(run_counts.size(), reopened.get_level_count());
+    for (size_t level = 0; level < run_counts.size(); level++) {
+        ASSERT_EQUAL(run_counts[level], reopened.get_level_run_count(level));
+    }
+    ASSERT_TRUE(reopened.close());
+}
+
+void test_lazy_leveled_compaction_shape() {
+    std::filesystem::remove_all("data/test_lazy_leveled");
+    std::map<int, int> expected;
+    {
+        Database<int, int> db("test_lazy_leveled", 200);
+        db.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LAZY_LEVELED, small_levels()));
+        ASSERT_TRUE(db.open());
+        ASSERT_TRUE(run_mixed_workload(db, expected));
+        ASSERT_TRUE(db.get_level_count() > 2);
+        ASSERT_TRUE(db.close());
+    }
+
+    // only the last level has to be one sorted run
+    auto loaded = load_levels("data/test_lazy_leveled");
+    ASSERT_TRUE(loaded.size() > 2);
+    ASSERT_TRUE(!loaded.back().empty());
+    ASSERT_TRUE(level_is_disjoint(loaded.back()));
+
+    // opening it as leveled is refused rather than searching overlapping runs by key
+    bool upper_levels_overlap = false;
+    for (size_t level = 1; level + 1 < loaded.size(); level++) {
+        upper_levels_overlap = upper_levels_overlap || !level_is_disjoint(loaded[level]);
+    }
+    if (upper_levels_overlap) {
+        Database<int, int> leveled("test_lazy_leveled", 200);
+        ASSERT_FALSE(leveled.open());
+    }
+}
+
+void test_trivial_move_for_sequential_keys() {
+    std::filesystem::remove_all("data/test_trivial_move");
+    const int num_keys = 6000;
+    {
+        Database<int, int> db("test_trivial_move", 200);
+        db.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LEVELED, small_levels()));
+        ASSERT_TRUE(db.open());
+        for (int key = 0; key < num_keys; key++) {
+            ASSERT_TRUE(db.put(key, key * 2));
+        }
+        db.flush_memtable_to_sst();
+
+        // ascending keys never overlap, so every SST moves down without being rewritten
+        ASSERT_TRUE(db.get_level_count() > 2);
+        ASSERT_TRUE(db.get_trivial_move_count() > 0);
+        ASSERT_EQUAL(static_cast<size_t>(0), db.get_compaction_bytes_written());
+        ASSERT_TRUE(db.close());
+    }
+
+    // the manifest holds the new levels, and every level below 0 stays sorted
+    auto loaded = load_levels("data/test_trivial_move");
+    bool disjoint = true;
+    for (size_t level = 1; level < loaded.size(); level++) {
+        disjoint = disjoint && level_is_disjoint(loaded[level]);
+    }
+    ASSERT_TRUE(disjoint);
+
+    Database<int, int> reopened("test_trivial_move", 200);
+    reopened.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LEVELED, small_levels()));
+    ASSERT_TRUE(reopened.open());
+    int value;
+    bool all_found = true;
+    for (int key = 0; key < num_keys; key++) {
+        if (!reopened.get(key, value) || value != key * 2) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(reopened.close());
+}
+
+void test_tombstones_dropped_at_bottom_level() {
+    std::filesystem::remove_all("data/test_tombstone_gc");
+    const int num_keys = 2000;
+    {
+        Database<int, int> db("test_tombstone_gc", 100);
+        ASSERT_TRUE(db.open());
+        // interleaved keys make every flush overlap the others, so they are merged
+        for (int i = 0; i < num_keys; i++) {
+            int key = (i * 7) % num_keys;
+            ASSERT_TRUE(db.put(key, key));
+        }
+        for (int i = 0; i < num_keys; i++) {
+            int key = (i * 7) % num_keys;
+            if (key % 2 == 0) {
+                ASSERT_TRUE(db.remove(key));
+            }
+        }
+        db.flush_memtable_to_sst();
+        ASSERT_TRUE(db.close());
+    }
+
+    // level 1 is the last level, so merges into it drop tombstones along with
+    // the versions they deleted
+    auto loaded = load_levels("data/test_tombstone_gc");
+    ASSERT_TRUE(loaded.size() == 2);
+    size_t bottom_entries = 0;
+    size_t bottom_tombstones = 0;
+    for (const auto& sst : loaded[1]) {
+        bottom_entries += sst->get_entry_count();
+        bottom_tombstones += sst->get_tombstone_count();
+    }
+    ASSERT_EQUAL(static_cast<size_t>(0), bottom_tombstones);
+    ASSERT_TRUE(bottom_entries < static_cast<size_t>(num_keys));
+
+    Database<int, int> reopened("test_tombstone_gc", 100);
+    ASSERT_TRUE(reopened.open());
+    int value;
+    bool all_match = true;
+    for (int key = 0; key < num_keys; key++) {
+        bool found = reopened.get(key, value);
+        if (found != (key % 2 == 1) || (found && value != key)) {
+            all_match = false;
+        }
+    }
+    ASSERT_TRUE(all_match);
+    ASSERT_TRUE(reopened.close());
+}
+
+void test_delete_heavy_sst_compacted_first() {
+    const std::string dir = "data/test_delete_heavy_pick";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // three disjoint SSTs in level 1; the middle one is mostly tombstones
+    SSTLevels<int, int> levels(2);
+    for (int file = 0; file < 3; file++) {
+        std::string path = dir + "/l1_" + std::to_string(file) + ".sst";
+        std::vector<std::pair<int, int>> data;
+        for (int key = file * 1000; key < file * 1000 + 500; key++) {
+            bool deleted = file == 1 && key % 2 == 0;
+            data.push_back({key, deleted ? tombstone_value<int>() : key});
+        }
+        auto sst = std::make_unique<SST<int, int>>(path);
+        ASSERT_TRUE(sst->create_from_memtable(path, data, 1));
+        levels[1].push_back(std::move(sst));
+    }
+
+    CompactionOptions options;
+    options.level1_max_bytes = 1;
+    LeveledCompaction<int, int> strategy(options);
+    CompactionJob<int, int> job;
+    ASSERT_TRUE(strategy.pick(levels, job));
+    ASSERT_EQUAL(static_cast<size_t>(1), job.level);
+    ASSERT_EQUAL(static_cast<size_t>(1), job.inputs.size());
+    ASSERT_TRUE(job.inputs[0] == levels[1][1].get());
+}
+
+void test_bloom_filter_budget_per_level() {
+    std::filesystem::remove_all("data/test_bloom_budget");
+    std::map<int, int> expected;
+    {
+        Database<int, int> db("test_bloom_budget", 200);
+        db.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LEVELED, small_levels()));
+        db.set_bloom_filter_budget(8);
+        ASSERT_TRUE(db.open());
+        ASSERT_TRUE(run_mixed_workload(db, expected));
+        ASSERT_TRUE(db.get_level_count() > 2);
+        ASSERT_TRUE(db.close());
+    }
+
+    // compaction outputs follow the budget: deeper, larger levels get looser filters
+    auto loaded = load_levels("data/test_bloom_budget");
+    std::vector<double> level_rates;
+    for (size_t level = 1; level < loaded.size(); level++) {
+        double max_rate = 0;
+        for (const auto& sst : loaded[level]) {
+            max_rate = std::max(max_rate, sst->get_false_positive_rate());
+        }
+        level_rates.push_back(max_rate);
+    }
+    ASSERT_TRUE(level_rates.size() >= 2);
+    ASSERT_TRUE(level_rates.front() < level_rates.back());
+    ASSERT_TRUE(level_rates.back() != 0.01);
+}
+
+// Overlapping flushes with reads in between, so the SSTs that compaction
+// replaces have cached leaves
+size_t warm_up_pages_after_compaction(const std::string& name, bool warm_up) {
+    std::filesystem::remove_all("data/" + name);
+    Database<int, int> db(name, 200);
+    db.set_compaction_strategy(make_compaction_strategy<int, int>(CompactionStyle::LEVELED, small_levels()));
+    db.set_compaction_warm_up(warm_up);
+    if (!db.open()) {
+        return SIZE_MAX;
+    }
+    for (int i = 0; i < 2000; i++) {
+        int key = (i * 7) % 2000;
+        db.put(key, key + 1);
+        if (i % 200 == 199) {
+            db.flush_memtable_to_sst();
+            for (int j = 0; j <= i; j++) {
+                int value;
+                int read_key = (j * 7) % 2000;
+                if (!db.get(read_key, value) || value != read_key + 1) {
+                    return SIZE_MAX;
+                }
+            }
+        }
+    }
+    size_t pages = db.get_warm_up_page_count();
+    db.close();
+    return pages;
+}
+
+void test_compaction_warms_up_buffer_pool() {
+    size_t warmed = warm_up_pages_after_compaction("test_warm_up_on", true);
+    ASSERT_TRUE(warmed != SIZE_MAX);
+    ASSERT_TRUE(warmed > 0);
+    ASSERT_TRUE(warm_up_pages_after_compaction("test_warm_up_off", false) == 0);
+}
+
 int main() {
     std::cout << "\n=== Running LSM-Tree Tests ===" << std::endl;
 
@@ -348,6 +743,15 @@ int main() {
     RUN_TEST(test_delete_persists_after_compaction);
     RUN_TEST(test_delete_and_compact);
     RUN_TEST(test_reopen_after_compaction);
+    RUN_TEST(test_leveled_compaction_shape);
+    RUN_TEST(test_tiered_compaction_writes_less);
+    RUN_TEST(test_tiered_runs_survive_reopen);
+    RUN_TEST(test_lazy_leveled_compaction_shape);
+    RUN_TEST(test_trivial_move_for_sequential_keys);
+    RUN_TEST(test_tombstones_dropped_at_bottom_level);
+    RUN_TEST(test_delete_heavy_sst_compacted_first);
+    RUN_TEST(test_bloom_filter_budget_per_level);
+    RUN_TEST(test_compaction_warms_up_buffer_pool);
 
     TestFramework::print_results();
 
@@ -0,0 +1,257 @@
+#include "test_framework.h"
+#include "../src/storage/manifest.h"
+#include "../src/core/database.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <csignal>
+#include <sys/resource.h>
+
+void test_manifest_log_and_reload() {
+    std::filesystem::remove_all("data/test_manifest_reload");
+    std::filesystem::create_directories("data/test_manifest_reload");
+
+    {
+        Manifest manifest("data/test_manifest_reload");
+        ASSERT_TRUE(manifest.create({}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "c.sst"}}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "a.sst"}}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "b.sst"}}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 1, "merged.sst"},
+                                       {ManifestChangeType::REMOVE, 0, "c.sst"},
+                                       {ManifestChangeType::REMOVE, 0, "a.sst"}}));
+    }
+
+    Manifest reloaded("data/test_manifest_reload");
+    ASSERT_TRUE(Manifest::exists("data/test_manifest_reload"));
+    ASSERT_TRUE(reloaded.open());
+    auto layout = reloaded.get_layout();
+    ASSERT_EQUAL(2, static_cast<int>(layout.size()));
+    ASSERT_EQUAL(1, static_cast<int>(layout[0].size()));
+    ASSERT_EQUAL(std::string("b.sst"), layout[0][0]);
+    ASSERT_EQUAL(std::string("merged.sst"), layout[1][0]);
+
+    // opening compacts the log into a single snapshot edit
+    ASSERT_EQUAL(0, static_cast<int>(reloaded.get_edits_since_snapshot()));
+    ASSERT_TRUE(reloaded.get_last_sequence() > 5);
+}
+
+void test_manifest_keeps_run_ids() {
+    std::filesystem::remove_all("data/test_manifest_run_ids");
+    std::filesystem::create_directories("data/test_manifest_run_ids");
+
+    {
+        Manifest manifest("data/test_manifest_run_ids");
+        ASSERT_TRUE(manifest.create({}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 1, "a.sst", 4},
+                                       {ManifestChangeType::ADD, 1, "b.sst", 4},
+                                       {ManifestChangeType::ADD, 1, "c.sst", 5}}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "old.sst"}}));
+        // a move records the run the file joins
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::REMOVE, 1, "c.sst"},
+                                       {ManifestChangeType::ADD, 2, "c.sst", 9}}));
+        ASSERT_EQUAL(static_cast<uint64_t>(9), manifest.get_run_id("c.sst"));
+    }
+
+    // kept through the log and through the snapshot open() writes
+    for (int round = 0; round < 2; round++) {
+        Manifest reloaded("data/test_manifest_run_ids");
+        ASSERT_TRUE(reloaded.open());
+        ASSERT_EQUAL(static_cast<uint64_t>(4), reloaded.get_run_id("a.sst"));
+        ASSERT_EQUAL(static_cast<uint64_t>(4), reloaded.get_run_id("b.sst"));
+        ASSERT_EQUAL(static_cast<uint64_t>(9), reloaded.get_run_id("c.sst"));
+        ASSERT_EQUAL(static_cast<uint64_t>(0), reloaded.get_run_id("old.sst"));
+        ASSERT_TRUE(reloaded.log_edit({{ManifestChangeType::REMOVE, 0, "old.sst"}}));
+        ASSERT_TRUE(reloaded.log_edit({{ManifestChangeType::ADD, 0, "old.sst"}}));
+    }
+}
+
+void test_manifest_rejects_unknown_remove() {
+    std::filesystem::remove_all("data/test_manifest_reject");
+    std::filesystem::create_directories("data/test_manifest_reject");
+
+    Manifest manifest("data/test_manifest_reject");
+    ASSERT_TRUE(manifest.create({{"a.sst"}}));
+    ASSERT_FALSE(manifest.log_edit({{ManifestChangeType::ADD, 1, "b.sst"},
+                                    {ManifestChangeType::REMOVE, 0, "missing.sst"}}));
+
+    // the rejected edit left no trace
+    auto layout = manifest.get_layout();
+    ASSERT_EQUAL(1, static_cast<int>(layout.size()));
+    ASSERT_EQUAL(std::string("a.sst"), layout[0][0]);
+}
+
+void test_manifest_ignores_torn_edit() {
+    std::filesystem::remove_all("data/test_manifest_torn");
+    std::filesystem::create_directories("data/test_manifest_torn");
+
+    {
+        Manifest manifest("data/test_manifest_torn");
+        ASSERT_TRUE(manifest.create({}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "a.sst"}}));
+    }
+    {
+        std::ofstream file("data/test_manifest_torn/MANIFEST", std::ios::binary | std::ios::app);
+        file.write("\x12\x34\x56\x78\x40\x00\x00\x00partial", 15);
+    }
+
+    Manifest manifest("data/test_manifest_torn");
+    ASSERT_TRUE(manifest.open());
+    auto layout = manifest.get_layout();
+    ASSERT_EQUAL(1, static_cast<int>(layout.size()));
+    ASSERT_EQUAL(1, static_cast<int>(layout[0].size()));
+    ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "b.sst"}}));
+}
+
+void test_manifest_failed_append_leaves_no_torn_edit() {
+    std::filesystem::remove_all("data/test_manifest_failed_append");
+    std::filesystem::create_directories("data/test_manifest_failed_append");
+    const std::string path = "data/test_manifest_failed_append/MANIFEST";
+
+    {
+        Manifest manifest("data/test_manifest_failed_append");
+        ASSERT_TRUE(manifest.create({}));
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "a.sst"}}));
+        size_t size_before = std::filesystem::file_size(path);
+
+        // the file may grow by a few bytes only, so the edit is written in part
+        std::signal(SIGXFSZ, SIG_IGN);
+        struct rlimit unlimited;
+        getrlimit(RLIMIT_FSIZE, &unlimited);
+        struct rlimit limited = unlimited;
+        limited.rlim_cur = size_before + 8;
+        setrlimit(RLIMIT_FSIZE, &limited);
+        bool logged = manifest.log_edit({{ManifestChangeType::ADD, 0, std::string(200, 'b') + ".sst"}});
+        setrlimit(RLIMIT_FSIZE, &unlimited);
+        std::cout.clear();
+        std::cerr.clear();
+        ASSERT_FALSE(logged);
+        ASSERT_EQUAL(size_before, static_cast<size_t>(std::filesystem::file_size(path)));
+
+        ASSERT_TRUE(manifest.log_edit({{ManifestChangeType::ADD, 0, "c.sst"}}));
+    }
+
+    // the edit after the failed one is not hidden behind it
+    Manifest reloaded("data/test_manifest_failed_append");
+    ASSERT_TRUE(reloaded.open());
+    auto layout = reloaded.get_layout();
+    ASSERT_EQUAL(1, static_cast<int>(layout.size()));
+    ASSERT_EQUAL(2, static_cast<int>(layout[0].size()));
+    ASSERT_EQUAL(std::string("a.sst"), layout[0][0]);
+    ASSERT_EQUAL(std::string("c.sst"), layout[0][1]);
+}
+
+void test_manifest_snapshot_bounds_size() {
+    std::filesystem::remove_all("data/test_manifest_snapshot");
+    std::filesystem::create_directories("data/test_manifest_snapshot");
+
+    Manifest manifest("data/test_manifest_snapshot");
+    ASSERT_TRUE(manifest.create({}));
+    for (size_t i = 0; i < MANIFEST_MAX_EDITS; i++) {
+        std::string name = "f" + std::to_string(i) + ".sst";
+        manifest.log_edit({{ManifestChangeType::ADD, 0, name}});
+        if (i > 0) {
+            manifest.log_edit({{ManifestChangeType::REMOVE, 0, "f" + std::to_string(i - 1) + ".sst"}});
+        }
+    }
+
+    ASSERT_TRUE(manifest.get_edits_since_snapshot() < MANIFEST_MAX_EDITS);
+    ASSERT_TRUE(std::filesystem::file_size("data/test_manifest_snapshot/MANIFEST") < 64 * 1024);
+}
+
+void test_database_keeps_level_order() {
+    std::filesystem::remove_all("data/test_manifest_order");
+    std::filesystem::create_directories("data/test_manifest_order");
+
+    // the newer file sorts first by name, so only the manifest knows the order
+    SST<int, int> older("data/test_manifest_order/sst_z_older.sst");
+    ASSERT_TRUE(older.create_from_memtable("data/test_manifest_order/sst_z_older.sst", {{1, 100}, {2, 200}}));
+    SST<int, int> newer("data/test_manifest_order/sst_a_newer.sst");
+    ASSERT_TRUE(newer.create_from_memtable("data/test_manifest_order/sst_a_newer.sst", {{1, 111}}));
+    {
+        Manifest manifest("data/test_manifest_order");
+        ASSERT_TRUE(manifest.create({{"sst_z_older.sst", "sst_a_newer.sst"}}));
+    }
+
+    Database<int, int> db("test_manifest_order", 100);
+    ASSERT_TRUE(db.open());
+    ASSERT_EQUAL(2, static_cast<int>(db.get_sst_count()));
+    int value;
+    ASSERT_TRUE(db.get(1, value));
+    ASSERT_EQUAL(111, value);
+    ASSERT_TRUE(db.get(2, value));
+    ASSERT_EQUAL(200, value);
+    ASSERT_TRUE(db.close());
+}
+
+void test_database_removes_sst_not_in_manifest() {
+    std::filesystem::remove_all("data/test_manifest_orphan");
+    {
+        Database<int, int> db("test_manifest_orphan", 10);
+        ASSERT_TRUE(db.open());
+        for (int i = 0; i < 25; i++) {
+            db.put(i, i);
+        }
+        ASSERT_TRUE(db.close());
+    }
+
+    // as if a compaction had written its output and stopped before the manifest edit
+    SST<int, int> orphan("data/test_manifest_orphan/sst_L1_orphan.sst");
+    ASSERT_TRUE(orphan.create_from_memtable("data/test_manifest_orphan/sst_L1_orphan.sst", {{5, -5}}));
+
+    Database<int, int> db("test_manifest_orphan", 10);
+    ASSERT_TRUE(db.open());
+    ASSERT_FALSE(std::filesystem::exists("data/test_manifest_orphan/sst_L1_orphan.sst"));
+    int value;
+    ASSERT_TRUE(db.get(5, value));
+    ASSERT_EQUAL(5, value);
+    ASSERT_TRUE(db.close());
+}
+
+void test_database_without_manifest_is_migrated() {
+    std::filesystem::remove_all("data/test_manifest_migrate");
+    size_t sst_count;
+    {
+        Database<int, int> db("test_manifest_migrate", 10);
+        ASSERT_TRUE(db.open());
+        for (int i = 0; i < 45; i++) {
+            db.put(i, i * 2);
+        }
+        ASSERT_TRUE(db.close());
+        sst_count = db.get_sst_count();
+    }
+    std::filesystem::remove("data/test_manifest_migrate/MANIFEST");
+
+    Database<int, int> db("test_manifest_migrate", 10);
+    ASSERT_TRUE(db.open());
+    ASSERT_TRUE(Manifest::exists("data/test_manifest_migrate"));
+    ASSERT_EQUAL(static_cast<int>(sst_count), static_cast<int>(db.get_sst_count()));
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < 45; i++) {
+        if (!db.get(i, value) || value != i * 2) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(db.close());
+}
+
+int main() {
+    std::cout << "Running Manifest Tests" << std::endl;
+
+    RUN_TEST(test_manifest_log_and_reload);
+    RUN_TEST(test_manifest_keeps_run_ids);
+    RUN_TEST(test_manifest_rejects_unknown_remove);
+    RUN_TEST(test_manifest_ignores_torn_edit);
+    RUN_TEST(test_manifest_failed_append_leaves_no_torn_edit);
+    RUN_TEST(test_manifest_snapshot_bounds_size);
+    RUN_TEST(test_database_keeps_level_order);
+    RUN_TEST(test_database_removes_sst_not_in_manifest);
+    RUN_TEST(test_database_without_manifest_is_migrated);
+
+    TestFramework::print_results();
+
+    return TestFramework::tests_run == TestFramework::tests_passed ? 0 : 1;
+}
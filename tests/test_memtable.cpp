@@ -363,6 +363,141 @@ void test_memtable_scan_empty_tree() {
     ASSERT_EQUAL(0, static_cast<int>(results.size()));
 }
 
+void test_arena_updates_do_not_allocate() {
+    RedBlackTree<int, int> tree(100);
+    for (int i = 0; i < 50; i++) {
+        tree.put(i, i);
+    }
+    size_t memory_after_inserts = tree.get_arena_memory_usage();
+
+    // overwrite every key several times
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < 50; i++) {
+            ASSERT_TRUE(tree.put(i, i * round));
+        }
+    }
+    ASSERT_EQUAL(static_cast<int>(memory_after_inserts), static_cast<int>(tree.get_arena_memory_usage()));
+    ASSERT_EQUAL(50, static_cast<int>(tree.size()));
+}
+
+void test_arena_reused_after_clear() {
+    RedBlackTree<int, std::string> tree(200);
+    for (int i = 0; i < 200; i++) {
+        tree.put(i, std::to_string(i));
+    }
+    size_t memory_full = tree.get_arena_memory_usage();
+
+    tree.clear();
+    ASSERT_EQUAL(0, static_cast<int>(tree.size()));
+
+    // refill in a different order, the arena should hand out the same blocks again
+    for (int i = 199; i >= 0; i--) {
+        ASSERT_TRUE(tree.put(i, "v" + std::to_string(i)));
+    }
+    ASSERT_EQUAL(static_cast<int>(memory_full), static_cast<int>(tree.get_arena_memory_usage()));
+    ASSERT_TRUE(tree.verify_red_black_properties());
+
+    std::string value;
+    ASSERT_TRUE(tree.get(123, value));
+    ASSERT_EQUAL(std::string("v123"), value);
+}
+
+void test_arena_multiple_blocks() {
+    Arena arena(256);
+    for (int i = 0; i < 100; i++) {
+        void* ptr = arena.allocate(24, 8);
+        ASSERT_TRUE(reinterpret_cast<uintptr_t>(ptr) % 8 == 0);
+    }
+    ASSERT_TRUE(arena.get_block_count() > 1);
+    size_t blocks = arena.get_block_count();
+
+    arena.reset();
+    ASSERT_EQUAL(0, static_cast<int>(arena.get_bytes_allocated()));
+    for (int i = 0; i < 100; i++) {
+        arena.allocate(24, 8);
+    }
+    ASSERT_EQUAL(static_cast<int>(blocks), static_cast<int>(arena.get_block_count()));
+}
+
+void test_bulk_load_builds_valid_tree() {
+    for (int n : {0, 1, 2, 7, 8, 100, 1023, 1024}) {
+        RedBlackTree<int, int> tree(2000);
+        tree.put(-1, -1);  // replaced by the load
+
+        std::vector<std::pair<int, int>> data;
+        for (int i = 0; i < n; i++) {
+            data.push_back({i * 2, i});
+        }
+        ASSERT_TRUE(tree.bulk_load(data));
+        ASSERT_EQUAL(n, static_cast<int>(tree.size()));
+        ASSERT_TRUE(tree.verify_red_black_properties());
+
+        int value;
+        ASSERT_FALSE(tree.get(-1, value));
+        bool all_found = true;
+        for (int i = 0; i < n; i++) {
+            if (!tree.get(i * 2, value) || value != i) {
+                all_found = false;
+            }
+        }
+        ASSERT_TRUE(all_found);
+
+        // still a normal tree afterwards
+        tree.put(1, 1);
+        ASSERT_TRUE(tree.verify_red_black_properties());
+    }
+
+    RedBlackTree<int, int> small(4);
+    ASSERT_FALSE(small.bulk_load({{1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}}));
+}
+
+void test_memtable_cursor_walks_in_order() {
+    RedBlackTree<int, int> tree(200);
+    // even keys 0..198, inserted out of order
+    for (int i = 0; i < 100; i++) {
+        tree.put((i * 37) % 100 * 2, i);
+    }
+
+    ASSERT_EQUAL(0, tree.lower_bound(-5)->key);
+    ASSERT_TRUE(tree.lower_bound(199) == nullptr);
+
+    const RedBlackNode<int, int>* node = tree.lower_bound(51);
+    ASSERT_EQUAL(52, node->key);
+    int expected = 52;
+    bool in_order = true;
+    for (; node; node = tree.successor(node)) {
+        if (node->key != expected) {
+            in_order = false;
+        }
+        expected += 2;
+    }
+    ASSERT_TRUE(in_order);
+    ASSERT_EQUAL(200, expected);
+}
+
+void test_memtable_cursor_walks_backwards() {
+    RedBlackTree<int, int> tree(200);
+    for (int i = 0; i < 100; i++) {
+        tree.put((i * 37) % 100 * 2, i);
+    }
+
+    ASSERT_EQUAL(198, tree.floor(500)->key);
+    ASSERT_TRUE(tree.floor(-1) == nullptr);
+
+    const RedBlackNode<int, int>* node = tree.floor(51);
+    ASSERT_EQUAL(50, node->key);
+    int expected = 50;
+    bool in_order = true;
+    for (; node; node = tree.predecessor(node)) {
+        if (node->key != expected) {
+            in_order = false;
+        }
+        expected -= 2;
+    }
+    ASSERT_TRUE(in_order);
+    ASSERT_EQUAL(-2, expected);
+}
+
 int main() {
     std::cout << "Running Red-Black Tree Memtable Tests" << std::endl;
 
@@ -393,6 +528,14 @@ int main() {
     RUN_TEST(test_memtable_scan_integer_keys);
     RUN_TEST(test_memtable_scan_empty_tree);
 
+    // Arena allocation tests
+    RUN_TEST(test_arena_updates_do_not_allocate);
+    RUN_TEST(test_arena_reused_after_clear);
+    RUN_TEST(test_arena_multiple_blocks);
+    RUN_TEST(test_bulk_load_builds_valid_tree);
+    RUN_TEST(test_memtable_cursor_walks_in_order);
+    RUN_TEST(test_memtable_cursor_walks_backwards);
+
     TestFramework::print_results();
 
     return TestFramework::tests_run == TestFramework::tests_passed ? 0 : 1;
@@ -0,0 +1,158 @@
+#include "test_framework.h"
+#include "../src/cache/row_cache.h"
+#include "../src/core/database.h"
+#include <string>
+#include <filesystem>
+
+void test_row_cache_get_put_erase() {
+    RowCache<int, int> cache(64);
+    int value;
+    ASSERT_FALSE(cache.get(1, value));
+
+    cache.put(1, 10, cache.fill_epoch(1));
+    ASSERT_TRUE(cache.get(1, value));
+    ASSERT_EQUAL(10, value);
+
+    cache.put(1, 11, cache.fill_epoch(1));
+    ASSERT_TRUE(cache.get(1, value));
+    ASSERT_EQUAL(11, value);
+    ASSERT_EQUAL(static_cast<size_t>(1), cache.size());
+
+    cache.erase(1);
+    ASSERT_FALSE(cache.get(1, value));
+    ASSERT_EQUAL(static_cast<size_t>(2), cache.get_hit_count());
+    ASSERT_EQUAL(static_cast<size_t>(2), cache.get_miss_count());
+}
+
+void test_row_cache_stale_fill_is_dropped() {
+    RowCache<int, int> cache(64);
+    // a lookup starts, a write to the key lands, then the lookup fills
+    uint64_t epoch = cache.fill_epoch(7);
+    cache.erase(7);
+    cache.put(7, 70, epoch);
+    int value;
+    ASSERT_FALSE(cache.get(7, value));
+
+    // clear() also turns away fills begun before it
+    epoch = cache.fill_epoch(7);
+    cache.clear();
+    cache.put(7, 70, epoch);
+    ASSERT_FALSE(cache.get(7, value));
+    cache.put(7, 71, cache.fill_epoch(7));
+    ASSERT_TRUE(cache.get(7, value));
+    ASSERT_EQUAL(71, value);
+}
+
+void test_row_cache_unrelated_erase_keeps_fill() {
+    RowCache<int, int> cache(64);
+    // writes to other keys land while the lookup of key 7 runs
+    uint64_t epoch = cache.fill_epoch(7);
+    for (int key = 100; key < 110; key++) {
+        cache.erase(key);
+    }
+    cache.put(7, 70, epoch);
+    int value;
+    ASSERT_TRUE(cache.get(7, value));
+    ASSERT_EQUAL(70, value);
+}
+
+void test_row_cache_evicts_least_recently_used() {
+    RowCache<int, int> cache(ROW_CACHE_SHARDS * 4);
+    for (int i = 0; i < 1000; i++) {
+        cache.put(i, i, cache.fill_epoch(i));
+        // key 0 stays in use
+        int value;
+        cache.get(0, value);
+    }
+    ASSERT_TRUE(cache.size() <= cache.get_capacity());
+    int value;
+    ASSERT_TRUE(cache.get(0, value));
+    ASSERT_TRUE(cache.get(999, value));
+    ASSERT_FALSE(cache.get(1, value));
+}
+
+void test_database_row_cache_follows_writes() {
+    std::filesystem::remove_all("data/test_row_cache_writes");
+    Database<int, int> db("test_row_cache_writes", 50);
+    ASSERT_TRUE(db.set_row_cache_capacity(1000));
+    ASSERT_TRUE(db.open());
+    // the cache is in use without a lock once open
+    ASSERT_FALSE(db.set_row_cache_capacity(0));
+    for (int i = 0; i < 500; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+    db.flush_memtable_to_sst();
+
+    int value;
+    ASSERT_TRUE(db.get(42, value));
+    ASSERT_TRUE(db.get(42, value));
+    ASSERT_EQUAL(42, value);
+    ASSERT_EQUAL(static_cast<size_t>(1), db.get_row_cache_hit_count());
+
+    // new versions reach the SSTs; the cached rows must not outlive them
+    ASSERT_TRUE(db.get(43, value));
+    ASSERT_TRUE(db.put(42, 4200));
+    ASSERT_TRUE(db.remove(43));
+    ASSERT_TRUE((db.write_batch({{44, 4400}})));
+    ASSERT_TRUE(db.get(44, value));
+    db.flush_memtable_to_sst();
+
+    ASSERT_TRUE(db.get(42, value));
+    ASSERT_EQUAL(4200, value);
+    ASSERT_FALSE(db.get(43, value));
+    ASSERT_TRUE(db.get(44, value));
+    ASSERT_EQUAL(4400, value);
+
+    // compactions move and rewrite the SSTs underneath the cached rows
+    for (int round = 0; round < 3; round++) {
+        for (int i = 100; i < 500; i++) {
+            ASSERT_TRUE(db.put(i, i + 1));
+        }
+        db.flush_memtable_to_sst();
+    }
+    ASSERT_TRUE(db.get(42, value));
+    ASSERT_EQUAL(4200, value);
+    ASSERT_FALSE(db.get(43, value));
+    ASSERT_TRUE(db.get(450, value));
+    ASSERT_EQUAL(451, value);
+    ASSERT_TRUE(db.close());
+}
+
+void test_database_row_cache_serves_hot_keys() {
+    std::filesystem::remove_all("data/test_row_cache_hot_keys");
+    Database<int, int> db("test_row_cache_hot_keys", 100);
+    db.set_row_cache_capacity(200);
+    ASSERT_TRUE(db.open());
+    for (int i = 0; i < 5000; i++) {
+        ASSERT_TRUE(db.put(i, i * 3));
+    }
+    db.flush_memtable_to_sst();
+
+    // skewed reads: nine in ten go to 100 hot keys
+    bool all_found = true;
+    for (int i = 0; i < 5000; i++) {
+        int key = i % 10 == 0 ? (i * 7919) % 5000 : (i * 31) % 100 * 50;
+        int value;
+        if (!db.get(key, value) || value != key * 3) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(db.get_row_cache_hit_count() > 4000);
+    ASSERT_TRUE(db.close());
+}
+
+int main() {
+    std::cout << "Running Row Cache Tests" << std::endl;
+
+    RUN_TEST(test_row_cache_get_put_erase);
+    RUN_TEST(test_row_cache_stale_fill_is_dropped);
+    RUN_TEST(test_row_cache_unrelated_erase_keeps_fill);
+    RUN_TEST(test_row_cache_evicts_least_recently_used);
+    RUN_TEST(test_database_row_cache_follows_writes);
+    RUN_TEST(test_database_row_cache_serves_hot_keys);
+
+    TestFramework::print_results();
+
+    return TestFramework::tests_run == TestFramework::tests_passed ? 0 : 1;
+}
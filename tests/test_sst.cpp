@@ -1,8 +1,13 @@
 #include "test_framework.h"
 #include "../src/core/database.h"
 #include "../src/storage/sst.h"
+#include "../src/storage/sst_builder.h"
+#include "../src/storage/sst_iterator.h"
 #include <string>
 #include <filesystem>
+#include <fstream>
+#include <cstddef>
+#include <atomic>
 
 // Set up test directory
 std::string setup_test_directory(const std::string& test_name) {
@@ -447,6 +452,743 @@ void test_sst_deep_tree_binary_search() {
     ASSERT_EQUAL((num_pairs - 1) * 3, value);
 }
 
+void test_sst_header_holds_key_range() {
+    const std::string test_dir = setup_test_directory("test_sst_header_holds_key_range");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    std::vector<std::pair<int, int>> data;
+    const int num_pairs = 3 * LeafNode<int, int>::PAIRS_COUNT + 7;
+    for (int i = 0; i < num_pairs; i++) {
+        data.push_back({i * 2 + 10, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded, &buffer_pool)));
+
+    ASSERT_EQUAL(static_cast<int>(SST_FORMAT_VERSION), static_cast<int>(loaded->get_format_version()));
+    ASSERT_EQUAL(10, loaded->get_min_key());
+    ASSERT_EQUAL((num_pairs - 1) * 2 + 10, loaded->get_max_key());
+    ASSERT_EQUAL(4, static_cast<int>(loaded->get_leaf_count()));
+    // opening does not go through the buffer pool
+    ASSERT_EQUAL(0, static_cast<int>(buffer_pool.get_page_count()));
+
+    int value;
+    ASSERT_TRUE(loaded->get(20, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_EQUAL(5, value);
+}
+
+void test_sst_load_version1_header() {
+    const std::string test_dir = setup_test_directory("test_sst_load_version1_header");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    std::vector<std::pair<int, int>> data;
+    const int num_pairs = 2 * LeafNode<int, int>::PAIRS_COUNT + 1;
+    for (int i = 0; i < num_pairs; i++) {
+        data.push_back({i - 50, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+
+    // version 1 headers end after bloom_filter_num_bits, with garbage behind them
+    {
+        std::fstream file(sst_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(SSTHeaderFields<int>, magic));
+        std::vector<char> garbage(PAGE_SIZE - offsetof(SSTHeaderFields<int>, magic), 0x5a);
+        file.write(garbage.data(), garbage.size());
+    }
+
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded)));
+    ASSERT_EQUAL(1, static_cast<int>(loaded->get_format_version()));
+    ASSERT_EQUAL(-50, loaded->get_min_key());
+    ASSERT_EQUAL(num_pairs - 51, loaded->get_max_key());
+    ASSERT_EQUAL(3, static_cast<int>(loaded->get_leaf_count()));
+
+    int value;
+    ASSERT_TRUE(loaded->get(num_pairs - 51, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_EQUAL(num_pairs - 1, value);
+}
+
+void test_sst_point_lookup_reads_one_page() {
+    const std::string test_dir = setup_test_directory("test_sst_point_lookup_reads_one_page");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    // deep enough for two levels of internal nodes
+    std::vector<std::pair<int, int>> data;
+    const int num_pairs = (InternalNode<int>::MAX_KEYS + 1) * LeafNode<int, int>::PAIRS_COUNT;
+    for (int i = 0; i < num_pairs; i++) {
+        data.push_back({i, i + 1});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded, &buffer_pool)));
+
+    int value;
+    ASSERT_TRUE(loaded->get(num_pairs - 3, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_EQUAL(num_pairs - 2, value);
+    ASSERT_EQUAL(1, static_cast<int>(buffer_pool.get_page_count()));
+
+    // a scan touches only the leaves in its range
+    buffer_pool.clear();
+    auto results = loaded->scan(0, LeafNode<int, int>::PAIRS_COUNT - 1, SearchMode::B_TREE_SEARCH);
+    ASSERT_EQUAL(static_cast<int>(LeafNode<int, int>::PAIRS_COUNT), static_cast<int>(results.size()));
+    ASSERT_EQUAL(1, static_cast<int>(buffer_pool.get_page_count()));
+}
+
+void test_sst_file_table_bounds_open_files() {
+    const std::string test_dir = setup_test_directory("test_sst_file_table_bounds_open_files");
+    FileTable& table = FileTable::instance();
+    size_t previous_capacity = table.get_capacity();
+    table.set_capacity(2);
+
+    std::vector<std::unique_ptr<SST<int, int>>> ssts;
+    for (int f = 0; f < 5; f++) {
+        std::string path = test_dir + "/file" + std::to_string(f) + ".sst";
+        auto sst = std::make_unique<SST<int, int>>(path);
+        std::vector<std::pair<int, int>> data;
+        for (int i = 0; i < 1000; i++) {
+            data.push_back({i, i * 10 + f});
+        }
+        ASSERT_TRUE(sst->create_from_memtable(path, data));
+        ssts.push_back(std::move(sst));
+    }
+    ASSERT_TRUE(table.get_open_count() <= 2);
+
+    // round-robin over more files than the table holds; every read still works
+    bool all_found = true;
+    for (int round = 0; round < 3; round++) {
+        for (int f = 0; f < 5; f++) {
+            int value;
+            if (!ssts[f]->get(500, value, SearchMode::B_TREE_SEARCH) || value != 5000 + f) {
+                all_found = false;
+            }
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(table.get_open_count() <= 2);
+
+    // repeated reads of one file reuse its descriptor
+    size_t opens = table.get_total_opens();
+    int value;
+    for (int i = 0; i < 100; i++) {
+        ssts[0]->get(i, value, SearchMode::BINARY_SEARCH);
+    }
+    ASSERT_TRUE(table.get_total_opens() <= opens + 1);
+
+    ASSERT_TRUE((SST<int, int>::remove_file(test_dir + "/file0.sst")));
+    ASSERT_FALSE(std::filesystem::exists(test_dir + "/file0.sst"));
+    table.set_capacity(previous_capacity);
+}
+
+void test_sst_mmap_read_mode() {
+    const std::string test_dir = setup_test_directory("test_sst_mmap_read_mode");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    std::vector<std::pair<int, int>> data;
+    const int num_pairs = 5 * LeafNode<int, int>::PAIRS_COUNT + 3;
+    for (int i = 0; i < num_pairs; i++) {
+        data.push_back({i * 3, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded, &buffer_pool)));
+    ASSERT_TRUE(loaded->set_read_mode(SSTReadMode::MMAP));
+    ASSERT_TRUE(loaded->is_mapped());
+
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < num_pairs; i += 37) {
+        if (!loaded->get(i * 3, value, SearchMode::B_TREE_SEARCH) || value != i ||
+            !loaded->get(i * 3, value, SearchMode::BINARY_SEARCH) || value != i) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_FALSE(loaded->get(1, value, SearchMode::B_TREE_SEARCH));
+
+    auto results = loaded->scan(30, 3000, SearchMode::B_TREE_SEARCH);
+    ASSERT_EQUAL(991, static_cast<int>(results.size()));
+    ASSERT_EQUAL(10, results.front().second);
+
+    // pages come straight from the mapping
+    ASSERT_EQUAL(0, static_cast<int>(buffer_pool.get_page_count()));
+
+    ASSERT_TRUE(loaded->set_read_mode(SSTReadMode::BUFFER_POOL));
+    ASSERT_FALSE(loaded->is_mapped());
+    ASSERT_TRUE(loaded->get(30, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_EQUAL(1, static_cast<int>(buffer_pool.get_page_count()));
+}
+
+// Follows the on-disk internal nodes from the root, as a reader without fence keys would
+size_t walk_to_leaf(const std::string& path, int key) {
+    std::ifstream file(path, std::ios::binary);
+    SSTHeader<int> header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    size_t offset = header.root_page_offset;
+    std::vector<char> page(PAGE_SIZE);
+    while (true) {
+        file.seekg(offset);
+        file.read(page.data(), PAGE_SIZE);
+        BTreeNode* node = reinterpret_cast<BTreeNode*>(page.data());
+        if (node->is_leaf) {
+            return offset;
+        }
+        InternalNode<int>* internal = reinterpret_cast<InternalNode<int>*>(page.data());
+        size_t i = std::lower_bound(internal->keys, internal->keys + internal->count, key) - internal->keys;
+        offset = internal->children[i];
+    }
+}
+
+void test_sst_builder_streams_large_file() {
+    const std::string test_dir = setup_test_directory("test_sst_builder_streams_large_file");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    // several write-buffer flushes and two internal levels
+    const int num_pairs = static_cast<int>(3 * SST_BUILDER_BUFFER_SIZE / sizeof(std::pair<int, int>)) + 123;
+    ASSERT_TRUE(num_pairs > static_cast<int>(InternalNode<int>::MAX_KEYS * LeafNode<int, int>::PAIRS_COUNT));
+
+    SST<int, int> sst(sst_path);
+    {
+        SSTBuilder<int, int> builder(sst_path, 2, 0.01, num_pairs);
+        ASSERT_TRUE(builder.is_open());
+        bool added = true;
+        for (int i = 0; i < num_pairs; i++) {
+            added = builder.add(i * 2, i) && added;
+        }
+        ASSERT_TRUE(added);
+        ASSERT_TRUE(builder.finish(sst));
+    }
+    ASSERT_EQUAL(num_pairs, static_cast<int>(sst.get_entry_count()));
+    ASSERT_EQUAL(2, static_cast<int>(sst.get_level()));
+
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded)));
+    ASSERT_EQUAL(static_cast<int>(sst.get_leaf_count()), static_cast<int>(loaded->get_leaf_count()));
+    ASSERT_EQUAL((num_pairs - 1) * 2, loaded->get_max_key());
+
+    bool all_found = true;
+    bool tree_matches = true;
+    size_t leaf_pairs = LeafNode<int, int>::PAIRS_COUNT;
+    for (int i = 0; i < num_pairs; i += 4999) {
+        int value;
+        if (!loaded->get(i * 2, value, SearchMode::B_TREE_SEARCH) || value != i ||
+            !loaded->get(i * 2, value, SearchMode::BINARY_SEARCH) || value != i) {
+            all_found = false;
+        }
+        if (walk_to_leaf(sst_path, i * 2) != PAGE_SIZE + (i / leaf_pairs) * PAGE_SIZE) {
+            tree_matches = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(tree_matches);
+}
+
+void test_sst_iterator_reads_all_leaves() {
+    const std::string test_dir = setup_test_directory("test_sst_iterator_reads_all_leaves");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    // enough leaves for several readahead refills, ending in a partial one
+    const int num_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT * (SST_ITERATOR_READAHEAD_PAGES * 3 + 1)) + 7;
+    std::vector<std::pair<int, int>> data;
+    for (int i = 0; i < num_pairs; i++) {
+        data.push_back({i * 3, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+
+    SSTIterator<int, int> it(sst);
+    ASSERT_FALSE(it.valid());
+    it.seek_to_first();
+    int seen = 0;
+    bool in_order = true;
+    for (; it.valid(); it.next()) {
+        if (it.key() != seen * 3 || it.value() != seen) {
+            in_order = false;
+        }
+        seen++;
+    }
+    ASSERT_TRUE(in_order);
+    ASSERT_EQUAL(num_pairs, seen);
+    ASSERT_FALSE(it.has_error());
+}
+
+void test_sst_merge_many_inputs_newest_wins() {
+    const std::string test_dir = setup_test_directory("test_sst_merge_many_inputs_newest_wins");
+
+    // input i holds every key divisible by (i + 1), with value i; inputs are oldest first
+    const int max_key = 20000;
+    std::vector<std::unique_ptr<SST<int, int>>> inputs;
+    std::vector<SST<int, int>*> input_ptrs;
+    for (int i = 0; i < 4; i++) {
+        std::string path = test_dir + "/input" + std::to_string(i) + ".sst";
+        std::vector<std::pair<int, int>> data;
+        for (int key = 0; key < max_key; key += i + 1) {
+            data.push_back({key, i});
+        }
+        inputs.push_back(std::make_unique<SST<int, int>>(path));
+        ASSERT_TRUE(inputs.back()->create_from_memtable(path, data));
+        input_ptrs.push_back(inputs.back().get());
+    }
+
+    std::vector<std::unique_ptr<SST<int, int>>> outputs;
+    auto merged_path = [&test_dir]() { return test_dir + "/merged.sst"; };
+    ASSERT_TRUE((SST<int, int>::create_from_merge(merged_path, input_ptrs, 1, outputs)));
+    ASSERT_EQUAL(1, static_cast<int>(outputs.size()));
+    SST<int, int>* merged = outputs[0].get();
+    ASSERT_EQUAL(max_key, static_cast<int>(merged->get_entry_count()));
+    ASSERT_EQUAL(1, static_cast<int>(merged->get_level()));
+
+    bool newest_wins = true;
+    for (int key = 0; key < max_key; key++) {
+        int expected = 0;
+        for (int i = 3; i >= 0; i--) {
+            if (key % (i + 1) == 0) {
+                expected = i;
+                break;
+            }
+        }
+        int value;
+        if (!merged->get(key, value, SearchMode::B_TREE_SEARCH) || value != expected) {
+            newest_wins = false;
+        }
+    }
+    ASSERT_TRUE(newest_wins);
+}
+
+void test_sst_merge_splits_at_target_file_size() {
+    const std::string test_dir = setup_test_directory("test_sst_merge_splits_at_target_file_size");
+
+    // two interleaved inputs of 40 leaves' worth of keys in total
+    const int leaf_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT);
+    const int total = leaf_pairs * 40;
+    std::vector<std::unique_ptr<SST<int, int>>> inputs;
+    std::vector<SST<int, int>*> input_ptrs;
+    for (int i = 0; i < 2; i++) {
+        std::string path = test_dir + "/input" + std::to_string(i) + ".sst";
+        std::vector<std::pair<int, int>> data;
+        for (int key = i; key < total; key += 2) {
+            data.push_back({key, key});
+        }
+        inputs.push_back(std::make_unique<SST<int, int>>(path));
+        ASSERT_TRUE(inputs.back()->create_from_memtable(path, data));
+        input_ptrs.push_back(inputs.back().get());
+    }
+
+    int file_number = 0;
+    auto next_path = [&]() { return test_dir + "/out" + std::to_string(file_number++) + ".sst"; };
+    std::vector<std::unique_ptr<SST<int, int>>> outputs;
+    SSTMergeOptions options;
+    options.max_file_size = 16 * PAGE_SIZE;
+    ASSERT_TRUE((SST<int, int>::create_from_merge(next_path, input_ptrs, 1, outputs, options)));
+
+    // 16 full leaves per file, the rest in the last one
+    ASSERT_EQUAL(3, static_cast<int>(outputs.size()));
+    ASSERT_EQUAL(16 * leaf_pairs, static_cast<int>(outputs[0]->get_entry_count()));
+    ASSERT_EQUAL(16 * leaf_pairs, static_cast<int>(outputs[1]->get_entry_count()));
+    ASSERT_EQUAL(8 * leaf_pairs, static_cast<int>(outputs[2]->get_entry_count()));
+
+    // the files form one sorted run with no key split between them
+    bool disjoint = true;
+    for (size_t i = 1; i < outputs.size(); i++) {
+        if (!(outputs[i - 1]->get_max_key() < outputs[i]->get_min_key())) {
+            disjoint = false;
+        }
+    }
+    ASSERT_TRUE(disjoint);
+    ASSERT_EQUAL(0, outputs[0]->get_min_key());
+    ASSERT_EQUAL(total - 1, outputs[2]->get_max_key());
+
+    bool all_found = true;
+    for (int key = 0; key < total; key++) {
+        SST<int, int>* owner = outputs[key / (16 * leaf_pairs)].get();
+        int value;
+        if (!owner->get(key, value, SearchMode::B_TREE_SEARCH) || value != key) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+}
+
+void test_sst_iterator_seek_past() {
+    const std::string test_dir = setup_test_directory("test_sst_iterator_seek_past");
+    const std::string sst_path = test_dir + "/seek.sst";
+
+    const int num_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT * 40);
+    std::vector<std::pair<int, int>> data;
+    for (int i = 0; i < num_pairs; i++) {
+        data.push_back({i * 2, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+
+    // a missing key and a present one, past the first readahead; only the
+    // leaves sought to are read and charged to the limiter
+    RateLimiter limiter;
+    SSTIterator<int, int> it(sst, SST_ITERATOR_READAHEAD_PAGES, &limiter);
+    ASSERT_EQUAL(static_cast<size_t>(0), limiter.get_total_bytes());
+    it.seek_past(num_pairs + 1);
+    ASSERT_TRUE(it.valid());
+    ASSERT_EQUAL(num_pairs + 2, it.key());
+    ASSERT_EQUAL(SST_ITERATOR_READAHEAD_PAGES * PAGE_SIZE, limiter.get_total_bytes());
+    it.seek_past(num_pairs + 2);
+    ASSERT_EQUAL(num_pairs + 4, it.key());
+
+    // back to the start, and past the end
+    it.seek_past(-1);
+    ASSERT_EQUAL(0, it.key());
+    it.next();
+    it.seek_to_first();
+    ASSERT_EQUAL(0, it.key());
+    it.seek_past((num_pairs - 1) * 2);
+    ASSERT_FALSE(it.valid());
+    ASSERT_FALSE(it.has_error());
+}
+
+void test_sst_parallel_merge_matches_serial() {
+    const std::string test_dir = setup_test_directory("test_sst_parallel_merge_matches_serial");
+
+    // three overlapping inputs, oldest first; input i holds keys i, i + 2, i + 4, ...
+    const int max_key = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT) * 60;
+    std::vector<std::unique_ptr<SST<int, int>>> inputs;
+    std::vector<SST<int, int>*> input_ptrs;
+    for (int i = 0; i < 3; i++) {
+        std::string path = test_dir + "/input" + std::to_string(i) + ".sst";
+        std::vector<std::pair<int, int>> data;
+        for (int key = i; key < max_key; key += 2) {
+            data.push_back({key, i});
+        }
+        inputs.push_back(std::make_unique<SST<int, int>>(path));
+        ASSERT_TRUE(inputs.back()->create_from_memtable(path, data));
+        input_ptrs.push_back(inputs.back().get());
+    }
+
+    std::atomic<int> file_number{0};
+    auto next_path = [&]() { return test_dir + "/out" + std::to_string(file_number++) + ".sst"; };
+    std::vector<std::unique_ptr<SST<int, int>>> outputs;
+    SSTMergeOptions options;
+    options.max_file_size = 8 * PAGE_SIZE;
+    options.max_subcompactions = 4;
+    ASSERT_TRUE((SST<int, int>::create_from_merge(next_path, input_ptrs, 1, outputs, options)));
+
+    // the parts join into one sorted run holding every key exactly once
+    size_t entries = 0;
+    bool disjoint = true;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        entries += outputs[i]->get_entry_count();
+        if (i > 0 && !(outputs[i - 1]->get_max_key() < outputs[i]->get_min_key())) {
+            disjoint = false;
+        }
+    }
+    ASSERT_TRUE(outputs.size() >= 4);
+    ASSERT_TRUE(disjoint);
+    ASSERT_EQUAL(max_key, static_cast<int>(entries));
+
+    bool newest_wins = true;
+    size_t file = 0;
+    for (int key = 0; key < max_key; key++) {
+        while (outputs[file]->get_max_key() < key) {
+            file++;
+        }
+        int expected = key % 2 == 1 ? 1 : (key == 0 ? 0 : 2);
+        int value;
+        if (!outputs[file]->get(key, value, SearchMode::B_TREE_SEARCH) || value != expected) {
+            newest_wins = false;
+        }
+    }
+    ASSERT_TRUE(newest_wins);
+}
+
+void test_sst_tombstone_count_in_header() {
+    const std::string test_dir = setup_test_directory("test_sst_tombstone_count_in_header");
+    const std::string sst_path = test_dir + "/test.sst";
+
+    // every third key is deleted
+    std::vector<std::pair<int, int>> data;
+    int tombstones = 0;
+    for (int i = 0; i < 1000; i++) {
+        bool deleted = i % 3 == 0;
+        data.push_back({i, deleted ? tombstone_value<int>() : i});
+        tombstones += deleted ? 1 : 0;
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+    ASSERT_EQUAL(tombstones, static_cast<int>(sst.get_tombstone_count()));
+
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded)));
+    ASSERT_EQUAL(tombstones, static_cast<int>(loaded->get_tombstone_count()));
+}
+
+void test_sst_merge_drops_tombstones() {
+    const std::string test_dir = setup_test_directory("test_sst_merge_drops_tombstones");
+
+    // the newer input deletes every even key of the older one
+    const int num_keys = 2000;
+    std::vector<std::pair<int, int>> old_data;
+    std::vector<std::pair<int, int>> new_data;
+    for (int key = 0; key < num_keys; key++) {
+        old_data.push_back({key, key});
+        if (key % 2 == 0) {
+            new_data.push_back({key, tombstone_value<int>()});
+        }
+    }
+    SST<int, int> old_sst(test_dir + "/old.sst");
+    SST<int, int> new_sst(test_dir + "/new.sst");
+    ASSERT_TRUE(old_sst.create_from_memtable(test_dir + "/old.sst", old_data));
+    ASSERT_TRUE(new_sst.create_from_memtable(test_dir + "/new.sst", new_data));
+    std::vector<SST<int, int>*> inputs = {&old_sst, &new_sst};
+
+    // kept above the last level, the tombstones still hide older versions
+    std::vector<std::unique_ptr<SST<int, int>>> kept;
+    auto kept_path = [&test_dir]() { return test_dir + "/kept.sst"; };
+    ASSERT_TRUE((SST<int, int>::create_from_merge(kept_path, inputs, 1, kept)));
+    ASSERT_EQUAL(num_keys, static_cast<int>(kept[0]->get_entry_count()));
+    ASSERT_EQUAL(num_keys / 2, static_cast<int>(kept[0]->get_tombstone_count()));
+
+    // dropped, the deleted keys and the versions they shadowed are both gone
+    std::vector<std::unique_ptr<SST<int, int>>> dropped;
+    auto dropped_path = [&test_dir]() { return test_dir + "/dropped.sst"; };
+    SSTMergeOptions drop;
+    drop.drop_tombstones = true;
+    ASSERT_TRUE((SST<int, int>::create_from_merge(dropped_path, inputs, 1, dropped, drop)));
+    ASSERT_EQUAL(1, static_cast<int>(dropped.size()));
+    ASSERT_EQUAL(num_keys / 2, static_cast<int>(dropped[0]->get_entry_count()));
+    ASSERT_EQUAL(0, static_cast<int>(dropped[0]->get_tombstone_count()));
+    ASSERT_EQUAL(1, dropped[0]->get_min_key());
+
+    int value;
+    ASSERT_FALSE(dropped[0]->get(10, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_TRUE(dropped[0]->get(11, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_EQUAL(11, value);
+
+    // a merge of nothing but tombstones writes no file at all
+    std::vector<std::unique_ptr<SST<int, int>>> none;
+    std::vector<SST<int, int>*> only_tombstones = {&new_sst};
+    auto none_path = [&test_dir]() { return test_dir + "/none.sst"; };
+    ASSERT_TRUE((SST<int, int>::create_from_merge(none_path, only_tombstones, 1, none, drop)));
+    ASSERT_TRUE(none.empty());
+    ASSERT_FALSE(std::filesystem::exists(test_dir + "/none.sst"));
+}
+
+void test_sst_merge_output_uses_options() {
+    const std::string test_dir = setup_test_directory("test_sst_merge_output_uses_options");
+    std::vector<std::pair<int, int>> data;
+    for (int i = 0; i < 1000; i++) {
+        data.push_back({i, i});
+    }
+    SST<int, int> input(test_dir + "/input.sst");
+    ASSERT_TRUE(input.create_from_memtable(test_dir + "/input.sst", data));
+    std::vector<SST<int, int>*> inputs = {&input};
+
+    // the outputs take the merge's filter rate and read through its buffer pool
+    BufferPool buffer_pool(2, 10, 4, 64);
+    SSTMergeOptions options;
+    options.false_positive_rate = 0.2;
+    options.buffer_pool = &buffer_pool;
+    std::vector<std::unique_ptr<SST<int, int>>> outputs;
+    auto output_path = [&test_dir]() { return test_dir + "/output.sst"; };
+    ASSERT_TRUE((SST<int, int>::create_from_merge(output_path, inputs, 2, outputs, options)));
+    ASSERT_EQUAL(0.2, outputs[0]->get_false_positive_rate());
+
+    int value;
+    ASSERT_EQUAL(static_cast<size_t>(0), buffer_pool.get_page_count());
+    ASSERT_TRUE(outputs[0]->get(500, value, SearchMode::B_TREE_SEARCH));
+    ASSERT_TRUE(buffer_pool.get_page_count() > 0);
+
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(test_dir + "/output.sst", loaded)));
+    ASSERT_EQUAL(0.2, loaded->get_false_positive_rate());
+}
+
+void test_sst_leaf_heat_maps_onto_new_sst() {
+    const std::string test_dir = setup_test_directory("test_sst_leaf_heat_maps_onto_new_sst");
+    const int leaf_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT);
+
+    std::vector<std::pair<int, int>> old_data;
+    for (int i = 0; i < 4 * leaf_pairs; i++) {
+        old_data.push_back({i * 2, i});
+    }
+    SST<int, int> old_sst(test_dir + "/old.sst");
+    ASSERT_TRUE(old_sst.create_from_memtable(test_dir + "/old.sst", old_data));
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> cached;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(test_dir + "/old.sst", cached, &buffer_pool)));
+
+    // only the third leaf is read, three times
+    int hot_key = (2 * leaf_pairs + 5) * 2;
+    int value;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(cached->get(hot_key, value, SearchMode::B_TREE_SEARCH));
+    }
+    size_t cached_pages = buffer_pool.get_page_count();
+    ASSERT_TRUE(cached_pages > 0);
+
+    std::vector<LeafHeat<int>> heat = cached->drop_cached_pages();
+    ASSERT_EQUAL(static_cast<size_t>(0), buffer_pool.get_page_count());
+    ASSERT_EQUAL(static_cast<size_t>(1), heat.size());
+    ASSERT_TRUE(heat[0].first_key < hot_key && hot_key <= heat[0].last_key);
+    ASSERT_TRUE(heat[0].hits >= 3);
+
+    // twice as many keys in the new file, so the hot range spans two of its leaves
+    std::vector<std::pair<int, int>> new_data;
+    for (int i = 0; i < 8 * leaf_pairs; i++) {
+        new_data.push_back({i, i});
+    }
+    SST<int, int> new_sst(test_dir + "/new.sst");
+    ASSERT_TRUE(new_sst.create_from_memtable(test_dir + "/new.sst", new_data));
+    std::unique_ptr<SST<int, int>> replacement;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(test_dir + "/new.sst", replacement, &buffer_pool)));
+    auto leaves = replacement->map_leaf_heat(heat);
+    ASSERT_TRUE(leaves.size() >= 2 && leaves.size() <= 3);
+    for (const auto& leaf : leaves) {
+        ASSERT_EQUAL(heat[0].hits, leaf.second);
+        ASSERT_TRUE(replacement->preload_page(leaf.first));
+    }
+    ASSERT_EQUAL(leaves.size(), buffer_pool.get_page_count());
+}
+
+void test_sst_cursor_reads_only_visited_leaves() {
+    const std::string test_dir = setup_test_directory("test_sst_cursor_reads_only_visited_leaves");
+    const std::string sst_path = test_dir + "/test.sst";
+    const int leaf_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT);
+
+    std::vector<std::pair<int, int>> data;
+    for (int i = 0; i < 4 * leaf_pairs; i++) {
+        data.push_back({i * 2, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded, &buffer_pool)));
+
+    // the last key of the second leaf, then on into the third
+    SSTCursor<int, int> cursor;
+    cursor.reset(loaded.get());
+    cursor.seek(4 * leaf_pairs - 3);
+    ASSERT_TRUE(cursor.valid());
+    ASSERT_EQUAL(4 * leaf_pairs - 2, cursor.key());
+    for (int i = 0; i < 10; i++) {
+        cursor.next();
+    }
+    ASSERT_TRUE(cursor.valid());
+    ASSERT_EQUAL(4 * leaf_pairs + 18, cursor.key());
+    ASSERT_EQUAL(2 * leaf_pairs + 9, cursor.value());
+    ASSERT_EQUAL(static_cast<size_t>(2), buffer_pool.get_page_count());
+
+    cursor.seek(8 * leaf_pairs);
+    ASSERT_FALSE(cursor.valid());
+
+    cursor.seek_to_first();
+    int count = 0;
+    bool in_order = true;
+    for (; cursor.valid(); cursor.next()) {
+        if (cursor.key() != count * 2) {
+            in_order = false;
+        }
+        count++;
+    }
+    ASSERT_TRUE(in_order);
+    ASSERT_EQUAL(4 * leaf_pairs, count);
+    ASSERT_FALSE(cursor.has_error());
+}
+
+void test_sst_multi_get_shares_leaf_reads() {
+    const std::string test_dir = setup_test_directory("test_sst_multi_get_shares_leaf_reads");
+    const std::string sst_path = test_dir + "/test.sst";
+    const int leaf_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT);
+
+    std::vector<std::pair<int, int>> data;
+    for (int i = 0; i < 4 * leaf_pairs; i++) {
+        data.push_back({i * 2, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded, &buffer_pool)));
+
+    // twenty keys of the first leaf, two of the last, odd keys that are missing,
+    // a duplicate and keys outside the file
+    std::vector<int> keys = {-4};
+    for (int i = 0; i < 20; i++) {
+        keys.push_back(i * 2);
+        keys.push_back(i * 2 + 1);
+    }
+    keys.push_back(38);
+    keys.push_back(8 * leaf_pairs - 4);
+    keys.push_back(8 * leaf_pairs - 2);
+    keys.push_back(8 * leaf_pairs);
+
+    std::vector<int> values;
+    std::vector<bool> found;
+    ASSERT_EQUAL(static_cast<size_t>(23), loaded->multi_get(keys, values, found));
+    bool all_match = true;
+    for (size_t i = 0; i < keys.size(); i++) {
+        bool present = keys[i] >= 0 && keys[i] < 8 * leaf_pairs && keys[i] % 2 == 0;
+        if (found[i] != present || (present && values[i] != keys[i] / 2)) {
+            all_match = false;
+        }
+    }
+    ASSERT_TRUE(all_match);
+    // only the first and last leaves were read
+    ASSERT_EQUAL(static_cast<size_t>(2), buffer_pool.get_page_count());
+}
+
+void test_sst_cursor_walks_leaves_backwards() {
+    const std::string test_dir = setup_test_directory("test_sst_cursor_walks_leaves_backwards");
+    const std::string sst_path = test_dir + "/test.sst";
+    const int leaf_pairs = static_cast<int>(LeafNode<int, int>::PAIRS_COUNT);
+
+    std::vector<std::pair<int, int>> data;
+    for (int i = 0; i < 4 * leaf_pairs; i++) {
+        data.push_back({i * 2, i});
+    }
+    SST<int, int> sst(sst_path);
+    ASSERT_TRUE(sst.create_from_memtable(sst_path, data));
+    BufferPool buffer_pool(2, 10, 4, 64);
+    std::unique_ptr<SST<int, int>> loaded;
+    ASSERT_TRUE((SST<int, int>::load_existing_sst(sst_path, loaded, &buffer_pool)));
+
+    // the first key of the fourth leaf, then back into the third
+    SSTCursor<int, int> cursor;
+    cursor.reset(loaded.get());
+    cursor.seek_for_prev(6 * leaf_pairs + 1);
+    ASSERT_TRUE(cursor.valid());
+    ASSERT_EQUAL(6 * leaf_pairs, cursor.key());
+    cursor.prev();
+    ASSERT_EQUAL(6 * leaf_pairs - 2, cursor.key());
+    ASSERT_EQUAL(static_cast<size_t>(2), buffer_pool.get_page_count());
+
+    // past either end
+    cursor.seek_for_prev(1000000);
+    ASSERT_EQUAL(8 * leaf_pairs - 2, cursor.key());
+    cursor.seek_for_prev(-1);
+    ASSERT_FALSE(cursor.valid());
+
+    cursor.seek_to_last();
+    int expected = 4 * leaf_pairs - 1;
+    bool in_order = true;
+    for (; cursor.valid(); cursor.prev()) {
+        if (cursor.key() != expected * 2 || cursor.value() != expected) {
+            in_order = false;
+        }
+        expected--;
+    }
+    ASSERT_TRUE(in_order);
+    ASSERT_EQUAL(-1, expected);
+}
+
 int main() {
     std::cout << "Running SST Tests" << std::endl;
 
@@ -466,6 +1208,24 @@ int main() {
     RUN_TEST(test_sst_leaf_node_boundaries_binary_search);
     RUN_TEST(test_sst_deep_tree_b_tree);
     RUN_TEST(test_sst_deep_tree_binary_search);
+    RUN_TEST(test_sst_header_holds_key_range);
+    RUN_TEST(test_sst_load_version1_header);
+    RUN_TEST(test_sst_point_lookup_reads_one_page);
+    RUN_TEST(test_sst_file_table_bounds_open_files);
+    RUN_TEST(test_sst_mmap_read_mode);
+    RUN_TEST(test_sst_builder_streams_large_file);
+    RUN_TEST(test_sst_iterator_reads_all_leaves);
+    RUN_TEST(test_sst_merge_many_inputs_newest_wins);
+    RUN_TEST(test_sst_merge_splits_at_target_file_size);
+    RUN_TEST(test_sst_iterator_seek_past);
+    RUN_TEST(test_sst_parallel_merge_matches_serial);
+    RUN_TEST(test_sst_tombstone_count_in_header);
+    RUN_TEST(test_sst_merge_drops_tombstones);
+    RUN_TEST(test_sst_merge_output_uses_options);
+    RUN_TEST(test_sst_leaf_heat_maps_onto_new_sst);
+    RUN_TEST(test_sst_cursor_reads_only_visited_leaves);
+    RUN_TEST(test_sst_cursor_walks_leaves_backwards);
+    RUN_TEST(test_sst_multi_get_shares_leaf_reads);
 
     TestFramework::print_results();
 
@@ -1,6 +1,8 @@
 #include "test_framework.h"
 #include "../src/core/database.h"
 #include <string>
+#include <csignal>
+#include <sys/resource.h>
 
 void test_memtable_flush_to_sst() {
     // Clear SSTs from previous run
@@ -72,7 +74,9 @@ void test_multiple_sst_files() {
     ASSERT_TRUE(db.put(3, 3));
     ASSERT_TRUE(db.put(4, 4));
     db.flush_memtable_to_sst();
-    ASSERT_EQUAL(1, static_cast<int>(db.get_sst_count()));
+    // disjoint SSTs move to level 1 side by side instead of being merged
+    ASSERT_EQUAL(2, static_cast<int>(db.get_sst_count()));
+    ASSERT_EQUAL(0, static_cast<int>(db.get_level_sst_count(0)));
 
     ASSERT_TRUE(db.close());
 }
@@ -112,6 +116,93 @@ void test_database_close_flushes_memtable() {
     ASSERT_TRUE(db.close());
 }
 
+void test_background_flush_keeps_data_visible() {
+    std::filesystem::remove_all("data/test_background_flush");
+    Database<int, int> db("test_background_flush", 50);
+
+    ASSERT_TRUE(db.open());
+
+    // Fill several memtables without flushing explicitly; reads must find every
+    // key whether it is in the memtable, the immutable memtable or an SST
+    for (int i = 0; i < 175; i++) {
+        ASSERT_TRUE(db.put(i, i * 10));
+    }
+
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < 175; i++) {
+        if (!db.get(i, value) || value != i * 10) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+
+    size_t result_size = 0;
+    auto results = db.scan(0, 174, result_size);
+    ASSERT_EQUAL(175, static_cast<int>(result_size));
+    delete[] results;
+
+    // Explicit flush waits for the background work to finish
+    db.flush_memtable_to_sst();
+    ASSERT_EQUAL(0, static_cast<int>(db.get_memtable_size()));
+    ASSERT_TRUE(db.get(174, value));
+    ASSERT_EQUAL(1740, value);
+
+    ASSERT_TRUE(db.close());
+}
+
+void test_failed_flush_keeps_keys() {
+    std::filesystem::remove_all("data/test_failed_flush");
+    Database<int, int> db("test_failed_flush", 100);
+    ASSERT_TRUE(db.open());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+
+    // no file may grow past one page, so the SST cannot be written; the
+    // WAL segment of the new memtable stays below that. Nothing is printed
+    // meanwhile, in case the output goes to a file.
+    std::signal(SIGXFSZ, SIG_IGN);
+    struct rlimit unlimited;
+    getrlimit(RLIMIT_FSIZE, &unlimited);
+    struct rlimit one_page = unlimited;
+    one_page.rlim_cur = PAGE_SIZE;
+    setrlimit(RLIMIT_FSIZE, &one_page);
+    bool flushed = db.flush_memtable_to_sst();
+    bool put_after_failure = db.put(100, 100);
+    setrlimit(RLIMIT_FSIZE, &unlimited);
+    std::cout.clear();
+    std::cerr.clear();
+    ASSERT_FALSE(flushed);
+    ASSERT_TRUE(put_after_failure);
+
+    // the memtable that failed to flush is still read
+    int value;
+    ASSERT_TRUE(db.get(42, value));
+    ASSERT_EQUAL(42, value);
+
+    // once the new memtable is full too, writes are refused
+    for (int i = 101; i < 200; i++) {
+        ASSERT_TRUE(db.put(i, i));
+    }
+    ASSERT_FALSE(db.put(200, 200));
+    ASSERT_FALSE(db.flush_memtable_to_sst());
+    ASSERT_FALSE(db.close());
+
+    // every acknowledged key comes back from the WAL
+    Database<int, int> reopened("test_failed_flush", 100);
+    ASSERT_TRUE(reopened.open());
+    bool all_found = true;
+    for (int i = 0; i < 200; i++) {
+        if (!reopened.get(i, value) || value != i) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_FALSE(reopened.get(200, value));
+    ASSERT_TRUE(reopened.close());
+}
+
 int main() {
     std::cout << "Running SST Flush Tests" << std::endl;
 
@@ -120,6 +211,8 @@ int main() {
     RUN_TEST(test_multiple_sst_files);
     RUN_TEST(test_flush_empty_memtable);
     RUN_TEST(test_database_close_flushes_memtable);
+    RUN_TEST(test_background_flush_keeps_data_visible);
+    RUN_TEST(test_failed_flush_keeps_keys);
 
     TestFramework::print_results();
 
@@ -0,0 +1,340 @@
+#include "test_framework.h"
+#include "../src/wal/wal.h"
+#include "../src/core/database.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+// Read every valid record of a segment in file order
+std::vector<std::pair<int, int>> read_segment_records(const std::string& path) {
+    std::vector<std::pair<int, int>> records;
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> buffer(WALRecord<int, int>::SIZE);
+    while (file.read(buffer.data(), buffer.size())) {
+        uint64_t sequence;
+        int key, value;
+        if (!WALRecord<int, int>::decode(buffer.data(), sequence, key, value)) {
+            break;
+        }
+        records.push_back({key, value});
+    }
+    return records;
+}
+
+void test_wal_record_checksum() {
+    char record[WALRecord<int, int>::SIZE];
+    WALRecord<int, int>::encode(record, 7, 42, 4200);
+
+    uint64_t sequence;
+    int key, value;
+    ASSERT_TRUE((WALRecord<int, int>::decode(record, sequence, key, value)));
+    ASSERT_EQUAL(7, static_cast<int>(sequence));
+    ASSERT_EQUAL(42, key);
+    ASSERT_EQUAL(4200, value);
+
+    // flip one bit of the value
+    record[WALRecord<int, int>::VALUE_OFFSET] ^= 0x01;
+    ASSERT_FALSE((WALRecord<int, int>::decode(record, sequence, key, value)));
+}
+
+void test_wal_append_and_read_back() {
+    std::filesystem::remove_all("data/test_wal_append");
+    std::filesystem::create_directories("data/test_wal_append");
+
+    {
+        WriteAheadLog<int, int> wal("data/test_wal_append", WalSyncPolicy::NEVER);
+        ASSERT_TRUE(wal.open(1));
+        for (int i = 0; i < 100; i++) {
+            ASSERT_TRUE(wal.append(i, i * 10));
+        }
+        ASSERT_EQUAL(100, static_cast<int>(wal.get_last_sequence()));
+    }
+
+    auto records = read_segment_records(WriteAheadLog<int, int>::segment_path("data/test_wal_append", 1));
+    ASSERT_EQUAL(100, static_cast<int>(records.size()));
+    ASSERT_EQUAL(0, records.front().first);
+    ASSERT_EQUAL(990, records.back().second);
+}
+
+void test_wal_batch_is_one_commit_group() {
+    std::filesystem::remove_all("data/test_wal_batch");
+    std::filesystem::create_directories("data/test_wal_batch");
+
+    WriteAheadLog<int, int> wal("data/test_wal_batch", WalSyncPolicy::ALWAYS);
+    ASSERT_TRUE(wal.open(1));
+
+    std::vector<std::pair<int, int>> batch;
+    for (int i = 0; i < 500; i++) {
+        batch.push_back({i, i});
+    }
+    ASSERT_TRUE(wal.append_batch(batch));
+    ASSERT_EQUAL(500, static_cast<int>(wal.get_records_appended()));
+    ASSERT_EQUAL(1, static_cast<int>(wal.get_commit_groups()));
+
+    auto records = read_segment_records(WriteAheadLog<int, int>::segment_path("data/test_wal_batch", 1));
+    ASSERT_EQUAL(500, static_cast<int>(records.size()));
+}
+
+void test_wal_concurrent_group_commit() {
+    std::filesystem::remove_all("data/test_wal_group_commit");
+    std::filesystem::create_directories("data/test_wal_group_commit");
+
+    WriteAheadLog<int, int> wal("data/test_wal_group_commit", WalSyncPolicy::ALWAYS);
+    ASSERT_TRUE(wal.open(1));
+
+    const int num_threads = 8;
+    const int per_thread = 200;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; t++) {
+        writers.emplace_back([&wal, t] {
+            for (int i = 0; i < per_thread; i++) {
+                wal.append(t * per_thread + i, i);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    // every record made it, and concurrent writers shared fsyncs
+    ASSERT_EQUAL(num_threads * per_thread, static_cast<int>(wal.get_records_appended()));
+    ASSERT_TRUE(wal.get_commit_groups() <= wal.get_records_appended());
+    auto records = read_segment_records(WriteAheadLog<int, int>::segment_path("data/test_wal_group_commit", 1));
+    ASSERT_EQUAL(num_threads * per_thread, static_cast<int>(records.size()));
+}
+
+void test_wal_rotate_starts_new_segment() {
+    std::filesystem::remove_all("data/test_wal_rotate");
+    std::filesystem::create_directories("data/test_wal_rotate");
+
+    WriteAheadLog<int, int> wal("data/test_wal_rotate", WalSyncPolicy::INTERVAL);
+    ASSERT_TRUE(wal.open(3));
+    wal.append(1, 1);
+    ASSERT_EQUAL(3, static_cast<int>(wal.rotate()));
+    wal.append(2, 2);
+    wal.close();
+
+    auto segments = WriteAheadLog<int, int>::list_segments("data/test_wal_rotate");
+    ASSERT_EQUAL(2, static_cast<int>(segments.size()));
+    ASSERT_EQUAL(3, static_cast<int>(segments[0]));
+    ASSERT_EQUAL(4, static_cast<int>(segments[1]));
+    ASSERT_EQUAL(1, static_cast<int>(read_segment_records(WriteAheadLog<int, int>::segment_path("data/test_wal_rotate", 4)).size()));
+}
+
+void test_wal_interval_syncs_without_later_appends() {
+    std::filesystem::remove_all("data/test_wal_interval");
+    std::filesystem::create_directories("data/test_wal_interval");
+
+    WriteAheadLog<int, int> wal("data/test_wal_interval", WalSyncPolicy::INTERVAL, 50);
+    ASSERT_TRUE(wal.open(1));
+    ASSERT_TRUE(wal.append(7, 70));
+    std::string path = WriteAheadLog<int, int>::segment_path("data/test_wal_interval", 1);
+
+    // no further append comes, so the background sync has to write the record
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_EQUAL(static_cast<uintmax_t>(WALRecord<int, int>::SIZE), std::filesystem::file_size(path));
+    auto records = read_segment_records(path);
+    ASSERT_EQUAL(1, static_cast<int>(records.size()));
+    ASSERT_EQUAL(70, records.front().second);
+    wal.close();
+}
+
+void test_database_logs_unflushed_writes() {
+    std::filesystem::remove_all("data/test_wal_database");
+    Database<int, int> db("test_wal_database", 10);
+    db.set_wal_options(true, WalSyncPolicy::ALWAYS);
+    ASSERT_TRUE(db.open());
+
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(db.put(i, i * 100));
+    }
+    ASSERT_TRUE(db.remove(3));
+
+    auto segments = WriteAheadLog<int, int>::list_segments("data/test_wal_database");
+    ASSERT_EQUAL(1, static_cast<int>(segments.size()));
+    auto records = read_segment_records(WriteAheadLog<int, int>::segment_path("data/test_wal_database", segments[0]));
+    ASSERT_EQUAL(6, static_cast<int>(records.size()));
+
+    // once flushed, the memtable's segment is no longer needed
+    db.flush_memtable_to_sst();
+    segments = WriteAheadLog<int, int>::list_segments("data/test_wal_database");
+    ASSERT_EQUAL(1, static_cast<int>(segments.size()));
+    records = read_segment_records(WriteAheadLog<int, int>::segment_path("data/test_wal_database", segments[0]));
+    ASSERT_EQUAL(0, static_cast<int>(records.size()));
+
+    ASSERT_TRUE(db.close());
+    ASSERT_EQUAL(0, static_cast<int>(WriteAheadLog<int, int>::list_segments("data/test_wal_database").size()));
+}
+
+void test_database_write_batch() {
+    std::filesystem::remove_all("data/test_wal_write_batch");
+    Database<int, int> db("test_wal_write_batch", 16);
+    db.set_wal_options(true, WalSyncPolicy::ALWAYS);
+    ASSERT_TRUE(db.open());
+
+    // spans several memtables
+    std::vector<std::pair<int, int>> batch;
+    for (int i = 0; i < 50; i++) {
+        batch.push_back({i, i + 1});
+    }
+    ASSERT_TRUE(db.write_batch(batch));
+
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < 50; i++) {
+        if (!db.get(i, value) || value != i + 1) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+
+    ASSERT_TRUE(db.close());
+}
+
+// Writes a segment by hand, as a crashed process would have left it
+void write_segment(const std::string& dir, uint64_t number, const std::vector<std::pair<int, int>>& records,
+                   uint64_t first_sequence) {
+    std::filesystem::create_directories(dir);
+    std::ofstream file(WriteAheadLog<int, int>::segment_path(dir, number), std::ios::binary);
+    char record[WALRecord<int, int>::SIZE];
+    uint64_t sequence = first_sequence;
+    for (const auto& [key, value] : records) {
+        WALRecord<int, int>::encode(record, sequence++, key, value);
+        file.write(record, sizeof(record));
+    }
+}
+
+void test_replay_newest_value_wins() {
+    std::filesystem::remove_all("data/test_wal_replay");
+    write_segment("data/test_wal_replay", 1, {{1, 10}, {2, 20}, {1, 11}}, 1);
+    write_segment("data/test_wal_replay", 2, {{2, 21}, {3, 30}}, 4);
+
+    std::vector<std::pair<int, int>> records;
+    uint64_t last_sequence = 0;
+    ASSERT_TRUE((WriteAheadLog<int, int>::replay_segments("data/test_wal_replay", {1, 2}, records, last_sequence)));
+    ASSERT_EQUAL(3, static_cast<int>(records.size()));
+    ASSERT_EQUAL(11, records[0].second);
+    ASSERT_EQUAL(21, records[1].second);
+    ASSERT_EQUAL(30, records[2].second);
+    ASSERT_EQUAL(5, static_cast<int>(last_sequence));
+
+    Database<int, int> db("test_wal_replay", 100);
+    ASSERT_TRUE(db.open());
+    int value;
+    ASSERT_TRUE(db.get(1, value));
+    ASSERT_EQUAL(11, value);
+    ASSERT_TRUE(db.get(2, value));
+    ASSERT_EQUAL(21, value);
+    ASSERT_EQUAL(3, static_cast<int>(db.get_memtable_size()));
+
+    // new writes continue the sequence in a fresh segment
+    ASSERT_TRUE(db.put(4, 40));
+    ASSERT_TRUE(db.sync_wal());
+    auto segments = WriteAheadLog<int, int>::list_segments("data/test_wal_replay");
+    ASSERT_EQUAL(3, static_cast<int>(segments.size()));
+
+    // the flush covers the replayed segments too
+    ASSERT_TRUE(db.close());
+    ASSERT_EQUAL(0, static_cast<int>(WriteAheadLog<int, int>::list_segments("data/test_wal_replay").size()));
+
+    Database<int, int> reopened("test_wal_replay", 100);
+    ASSERT_TRUE(reopened.open());
+    ASSERT_TRUE(reopened.get(4, value));
+    ASSERT_EQUAL(40, value);
+    ASSERT_TRUE(reopened.close());
+}
+
+void test_replay_stops_at_torn_tail() {
+    std::filesystem::remove_all("data/test_wal_torn");
+    std::vector<std::pair<int, int>> records;
+    for (int i = 0; i < 50; i++) {
+        records.push_back({i, i});
+    }
+    write_segment("data/test_wal_torn", 1, records, 1);
+
+    // corrupt record 40, then append half a record
+    {
+        std::fstream file(WriteAheadLog<int, int>::segment_path("data/test_wal_torn", 1),
+                          std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(40 * WALRecord<int, int>::SIZE + WALRecord<int, int>::VALUE_OFFSET);
+        file.put(0x7f);
+        file.seekp(0, std::ios::end);
+        file.write("garbage", 7);
+    }
+
+    std::vector<std::pair<int, int>> replayed;
+    uint64_t last_sequence = 0;
+    ASSERT_TRUE((WriteAheadLog<int, int>::replay_segments("data/test_wal_torn", {1}, replayed, last_sequence)));
+    ASSERT_EQUAL(40, static_cast<int>(replayed.size()));
+    ASSERT_EQUAL(39, replayed.back().first);
+    ASSERT_EQUAL(40, static_cast<int>(last_sequence));
+}
+
+void test_replay_large_log_spills_to_sst() {
+    std::filesystem::remove_all("data/test_wal_replay_large");
+    // several chunks per segment so the parallel path and merge are exercised
+    const int per_segment = 3 * static_cast<int>(WAL_REPLAY_MIN_RECORDS_PER_CHUNK);
+    std::vector<std::pair<int, int>> older, newer;
+    for (int i = 0; i < per_segment; i++) {
+        older.push_back({i, i});
+        newer.push_back({i + per_segment / 2, -i});
+    }
+    write_segment("data/test_wal_replay_large", 1, older, 1);
+    write_segment("data/test_wal_replay_large", 2, newer, per_segment + 1);
+
+    std::vector<std::pair<int, int>> replayed;
+    uint64_t last_sequence = 0;
+    ASSERT_TRUE((WriteAheadLog<int, int>::replay_segments("data/test_wal_replay_large", {1, 2}, replayed,
+                                                          last_sequence, 4)));
+    ASSERT_EQUAL(per_segment + per_segment / 2, static_cast<int>(replayed.size()));
+    bool sorted = std::is_sorted(replayed.begin(), replayed.end(),
+                                 [](const auto& a, const auto& b) { return a.first < b.first; });
+    ASSERT_TRUE(sorted);
+
+    // does not fit in one memtable, so the oldest keys go to SSTs
+    Database<int, int> db("test_wal_replay_large", 20000);
+    ASSERT_TRUE(db.open());
+    ASSERT_TRUE(db.get_sst_count() > 0);
+    ASSERT_EQUAL(20000, static_cast<int>(db.get_memtable_size()));
+
+    // the replayed segments are gone and the memtable's keys moved to a new
+    // one, so reopening after another crash would not spill the same keys again
+    auto segments = WriteAheadLog<int, int>::list_segments("data/test_wal_replay_large");
+    ASSERT_TRUE(segments.front() > 2);
+    ASSERT_EQUAL(20000, static_cast<int>(read_segment_records(
+        WriteAheadLog<int, int>::segment_path("data/test_wal_replay_large", 3)).size()));
+
+    int value;
+    bool all_found = true;
+    for (int i = 0; i < per_segment + per_segment / 2; i += 97) {
+        int expected = i < per_segment / 2 ? i : -(i - per_segment / 2);
+        if (!db.get(i, value) || value != expected) {
+            all_found = false;
+        }
+    }
+    ASSERT_TRUE(all_found);
+    ASSERT_TRUE(db.close());
+}
+
+int main() {
+    std::cout << "Running Write-Ahead Log Tests" << std::endl;
+
+    RUN_TEST(test_wal_record_checksum);
+    RUN_TEST(test_wal_append_and_read_back);
+    RUN_TEST(test_wal_batch_is_one_commit_group);
+    RUN_TEST(test_wal_concurrent_group_commit);
+    RUN_TEST(test_wal_rotate_starts_new_segment);
+    RUN_TEST(test_wal_interval_syncs_without_later_appends);
+    RUN_TEST(test_database_logs_unflushed_writes);
+    RUN_TEST(test_database_write_batch);
+    RUN_TEST(test_replay_newest_value_wins);
+    RUN_TEST(test_replay_stops_at_torn_tail);
+    RUN_TEST(test_replay_large_log_spills_to_sst);
+
+    TestFramework::print_results();
+
+    return TestFramework::tests_run == TestFramework::tests_passed ? 0 : 1;
+}